@@ -0,0 +1,225 @@
+#include <QMutexLocker>
+
+#include "autosavewriter.h"
+#include "tracer.h"
+
+AutosaveWriter::AutosaveWriter(QObject *parent) : QObject(parent)
+{
+    IsSessionWritten = false;
+    QueuedJobs       = 0;
+    WritesCount      = 0;
+    TilesCount       = 0;
+
+    WriterPool.setMaxThreadCount(1);
+
+    AutosaveTimer.setSingleShot(true);
+
+    QObject::connect(&AutosaveTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+AutosaveWriter::~AutosaveWriter()
+{
+    stop();
+}
+
+int AutosaveWriter::writes() const
+{
+    QMutexLocker locker(&WriterMutex);
+
+    return WritesCount;
+}
+
+int AutosaveWriter::tilesWritten() const
+{
+    QMutexLocker locker(&WriterMutex);
+
+    return TilesCount;
+}
+
+void AutosaveWriter::start(const QString &file_name, const EditSession &session)
+{
+    stop();
+
+    IsSessionWritten = false;
+    FileName         = file_name;
+    Session          = session;
+
+    Written.clear();
+    Pending.clear();
+
+    QStringList names = session.imageNames();
+
+    for (int i = 0; i < names.size(); i++) {
+        Written.insert(names.at(i), session.image(names.at(i)));
+    }
+}
+
+void AutosaveWriter::update(const QString &name, const TiledImage &image)
+{
+    if (!FileName.isEmpty()) {
+        Pending.insert(name, image);
+
+        if (!AutosaveTimer.isActive()) {
+            AutosaveTimer.start(AUTOSAVE_INTERVAL);
+        }
+    }
+}
+
+void AutosaveWriter::finish()
+{
+    TRACE_SCOPE("AutosaveWriter::finish");
+
+    AutosaveTimer.stop();
+
+    WriterPool.waitForDone();
+
+    flush();
+
+    stop();
+}
+
+void AutosaveWriter::stop()
+{
+    AutosaveTimer.stop();
+
+    WriterPool.waitForDone();
+
+    FileName = QString();
+}
+
+void AutosaveWriter::flush()
+{
+    TRACE_SCOPE("AutosaveWriter::flush");
+
+    if (FileName.isEmpty() || Pending.isEmpty()) {
+        return;
+    }
+
+    // A write still in progress postpones this one
+
+    {
+        QMutexLocker locker(&WriterMutex);
+
+        if (QueuedJobs != 0) {
+            AutosaveTimer.start(AUTOSAVE_INTERVAL);
+
+            return;
+        }
+    }
+
+    WriteJob *job   = new WriteJob(this, FileName);
+    int       tiles = 0;
+
+    QMapIterator<QString, TiledImage> pending(Pending);
+
+    while (pending.hasNext()) {
+        pending.next();
+
+        const TiledImage &image   = pending.value();
+        const TiledImage &written = Written[pending.key()];
+
+        if (!IsSessionWritten) {
+            Session.setImage(pending.key(), image);
+        } else if (image.size() == written.size()) {
+            QVector<qint32> dirty_tiles;
+
+            for (int tile_y = 0; tile_y < image.tileRows(); tile_y++) {
+                for (int tile_x = 0; tile_x < image.tileColumns(); tile_x++) {
+                    if (image.tile(tile_x, tile_y).cacheKey() != written.tile(tile_x, tile_y).cacheKey()) {
+                        dirty_tiles.append(tile_y * image.tileColumns() + tile_x);
+                    }
+                }
+            }
+
+            if (!dirty_tiles.isEmpty()) {
+                job->addImage(pending.key(), image, dirty_tiles);
+
+                tiles += dirty_tiles.size();
+            }
+        }
+
+        Written.insert(pending.key(), image);
+    }
+
+    Pending.clear();
+
+    if (!IsSessionWritten) {
+        job->setSession(Session);
+
+        IsSessionWritten = true;
+
+        Session.clear();
+    } else if (tiles == 0) {
+        delete job;
+
+        return;
+    }
+
+    Tracer::Counter("autosave tiles", tiles);
+
+    {
+        QMutexLocker locker(&WriterMutex);
+
+        QueuedJobs++;
+    }
+
+    WriterPool.start(job);
+}
+
+AutosaveWriter::WriteJob::WriteJob(AutosaveWriter *writer, const QString &file_name) : QRunnable()
+{
+    IsSessionWrite = false;
+    Writer         = writer;
+    FileName       = file_name;
+}
+
+void AutosaveWriter::WriteJob::setSession(const EditSession &session)
+{
+    IsSessionWrite = true;
+    Session        = session;
+}
+
+void AutosaveWriter::WriteJob::addImage(const QString &name, const TiledImage &image, const QVector<qint32> &tiles)
+{
+    Images.insert(name, image);
+    Tiles.insert(name, tiles);
+}
+
+void AutosaveWriter::WriteJob::run()
+{
+    TRACE_SCOPE("AutosaveWriter::WriteJob::run");
+
+    bool success = true;
+    int  tiles   = 0;
+
+    if (IsSessionWrite) {
+        success = Session.save(FileName);
+    } else {
+        QMapIterator<QString, TiledImage> image(Images);
+
+        while (image.hasNext() && success) {
+            image.next();
+
+            success = EditSession::AppendJournal(FileName, image.key(), image.value(), Tiles.value(image.key()));
+            tiles  += Tiles.value(image.key()).size();
+        }
+    }
+
+    if (!success) {
+        qWarning("AutosaveWriter: could not write %s", qPrintable(FileName));
+    }
+
+    Writer->WriteFinished(success, tiles);
+}
+
+void AutosaveWriter::WriteFinished(bool success, int tiles)
+{
+    QMutexLocker locker(&WriterMutex);
+
+    QueuedJobs--;
+
+    if (success) {
+        WritesCount++;
+        TilesCount += tiles;
+    }
+}
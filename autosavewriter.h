@@ -0,0 +1,74 @@
+#ifndef AUTOSAVEWRITER_H
+#define AUTOSAVEWRITER_H
+
+#include <QObject>
+#include <QString>
+#include <QMap>
+#include <QVector>
+#include <QTimer>
+#include <QMutex>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include "tiledimage.h"
+#include "editsession.h"
+
+// Periodic crash-safe copy of an editor's work. Every AUTOSAVE_INTERVAL the
+// tiles changed since the last write are appended to the session journal on a
+// writer thread; the first write after start() stores the whole session.
+// finish() writes what is still pending and waits for it.
+
+class AutosaveWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AutosaveWriter(QObject *parent = 0);
+    virtual ~AutosaveWriter();
+
+    static const int AUTOSAVE_INTERVAL = 3000;
+
+    int writes() const;
+    int tilesWritten() const;
+
+    void start(const QString &file_name, const EditSession &session);
+    void update(const QString &name, const TiledImage &image);
+    void finish();
+    void stop();
+
+public slots:
+    void flush();
+
+private:
+    class WriteJob : public QRunnable
+    {
+    public:
+        WriteJob(AutosaveWriter *writer, const QString &file_name);
+
+        void setSession(const EditSession &session);
+        void addImage(const QString &name, const TiledImage &image, const QVector<qint32> &tiles);
+
+        virtual void run();
+
+    private:
+        bool                            IsSessionWrite;
+        AutosaveWriter                 *Writer;
+        QString                         FileName;
+        EditSession                     Session;
+        QMap<QString, TiledImage>       Images;
+        QMap<QString, QVector<qint32> > Tiles;
+    };
+
+    void WriteFinished(bool success, int tiles);
+
+    bool                      IsSessionWritten;
+    int                       QueuedJobs, WritesCount, TilesCount;
+    QString                   FileName;
+    EditSession               Session;
+    QMap<QString, TiledImage> Written, Pending;
+    QTimer                    AutosaveTimer;
+    mutable QMutex            WriterMutex;
+    QThreadPool               WriterPool;
+};
+
+#endif // AUTOSAVEWRITER_H
@@ -0,0 +1,410 @@
+#include <QDir>
+#include <QFile>
+#include <QVariantMap>
+#include <QElapsedTimer>
+
+#include "benchmark.h"
+#include "syntheticimage.h"
+#include "batchprocessor.h"
+#include "editordriver.h"
+#include "editstack.h"
+#include "editsession.h"
+#include "autosavewriter.h"
+#include "imagekernels.h"
+#include "decolorizeeditor.h"
+#include "sketcheditor.h"
+#include "cartooneditor.h"
+#include "blureditor.h"
+#include "pixelateeditor.h"
+#include "recoloreditor.h"
+#include "retoucheditor.h"
+
+EffectBenchmark::EffectBenchmark(QObject *parent) : QObject(parent), Out(stdout)
+{
+    Sizes << 0.2 << 1.0 << 4.0 << 16.0;
+}
+
+EffectBenchmark::~EffectBenchmark()
+{
+}
+
+QList<qreal> EffectBenchmark::sizes() const
+{
+    return Sizes;
+}
+
+void EffectBenchmark::setSizes(const QList<qreal> &sizes)
+{
+    Sizes = sizes;
+}
+
+QString EffectBenchmark::filter() const
+{
+    return Filter;
+}
+
+void EffectBenchmark::setFilter(const QString &filter)
+{
+    Filter = filter;
+}
+
+void EffectBenchmark::run()
+{
+    Out << "case,mpix,width,height,iterations,msecs_per_iteration" << endl;
+
+    for (int i = 0; i < Sizes.size(); i++) {
+        qreal mpix = Sizes.at(i);
+
+        BenchmarkGenerator("grayscale", mpix);
+        BenchmarkGenerator("sketch",    mpix);
+        BenchmarkGenerator("sketch",    mpix, "sobel");
+        BenchmarkGenerator("sketch",    mpix, "dog");
+        BenchmarkGenerator("cartoon",   mpix);
+        BenchmarkGenerator("cartoon",   mpix, "bilateral");
+        BenchmarkGenerator("blur",      mpix);
+        BenchmarkGenerator("pixelate",  mpix);
+        BenchmarkGenerator("pixelate",  mpix, "hexagon");
+        BenchmarkGenerator("pixelate",  mpix, "circle");
+        BenchmarkGenerator("pixelate",  mpix, "triangle");
+
+        BenchmarkAdjustHue(mpix);
+
+        BenchmarkStroke("decolorize", DecolorizeEditor::ModeEffected, mpix);
+        BenchmarkStroke("sketch",     SketchEditor::ModeEffected,     mpix);
+        BenchmarkStroke("cartoon",    CartoonEditor::ModeEffected,    mpix);
+        BenchmarkStroke("blur",       BlurEditor::ModeEffected,       mpix);
+        BenchmarkStroke("pixelate",   PixelateEditor::ModeEffected,   mpix);
+        BenchmarkStroke("recolor",    RecolorEditor::ModeEffected,    mpix);
+        BenchmarkStroke("retouch",    RetouchEditor::ModeClone,       mpix);
+        BenchmarkStroke("retouch",    RetouchEditor::ModeBlur,        mpix);
+
+        BenchmarkStack(mpix);
+        BenchmarkSession(mpix);
+        BenchmarkAutosave(mpix);
+    }
+}
+
+bool EffectBenchmark::Matches(const QString &case_name) const
+{
+    return Filter.isEmpty() || case_name.contains(Filter, Qt::CaseInsensitive);
+}
+
+void EffectBenchmark::Report(const QString &case_name, const qreal &mpix, const QSize &size, int iterations, qint64 elapsed)
+{
+    Out << case_name << ","
+        << mpix << ","
+        << size.width() << ","
+        << size.height() << ","
+        << iterations << ","
+        << (iterations > 0 ? (qreal)elapsed / iterations : 0.0) << endl;
+}
+
+void EffectBenchmark::BenchmarkGenerator(const QString &effect_name, const qreal &mpix, const QString &variant)
+{
+    // A variant names a sketch style, a cartoon smoothing or a pixelate shape
+
+    QString case_name = QString("generator.%1").arg(effect_name);
+
+    if (!variant.isEmpty()) {
+        case_name += "-" + variant;
+    }
+
+    if (Matches(case_name)) {
+        BatchProcessor processor;
+        QImage         input_image = SyntheticImage::Make(SyntheticImage::SizeForMpix(mpix), 1);
+        QElapsedTimer  timer;
+        int            iterations  = 0;
+
+        processor.setEffect(BatchProcessor::EffectFromName(effect_name));
+
+        if (BatchProcessor::StyleFromName(variant) != -1) {
+            processor.setSketchStyle(BatchProcessor::StyleFromName(variant));
+        } else if (BatchProcessor::SmoothingFromName(variant) != -1) {
+            processor.setSmoothing(BatchProcessor::SmoothingFromName(variant));
+        } else if (BatchProcessor::ShapeFromName(variant) != -1) {
+            processor.setPixShape(BatchProcessor::ShapeFromName(variant));
+        }
+
+        timer.start();
+
+        do {
+            processor.ApplyEffect(input_image);
+
+            iterations++;
+        } while (timer.elapsed() < MIN_ELAPSED && iterations < MAX_ITERATIONS);
+
+        Report(case_name, mpix, input_image.size(), iterations, timer.elapsed());
+    }
+}
+
+void EffectBenchmark::BenchmarkAdjustHue(const qreal &mpix)
+{
+    QString case_name = "recolor.adjusthue";
+
+    if (Matches(case_name)) {
+        QImage        input_image = SyntheticImage::Make(SyntheticImage::SizeForMpix(mpix), 2);
+        QElapsedTimer timer;
+        int           iterations  = 0;
+
+        // Recoloring keeps saturation and value, so every iteration does the same work
+
+        timer.start();
+
+        do {
+            ImageKernels::AdjustHue(input_image, iterations % 2 == 0 ? 180 : 90);
+
+            iterations++;
+        } while (timer.elapsed() < MIN_ELAPSED && iterations < MAX_ITERATIONS);
+
+        Report(case_name, mpix, input_image.size(), iterations, timer.elapsed());
+    }
+}
+
+void EffectBenchmark::BenchmarkStroke(const QString &editor_name, int mode, const qreal &mpix)
+{
+    QString case_name = QString("stroke.%1").arg(editor_name);
+
+    if (editor_name == "retouch") {
+        case_name += (mode == RetouchEditor::ModeClone ? "-clone" : "-blur");
+    }
+
+    if (Matches(case_name)) {
+        QString image_file = QDir::temp().filePath("magicphotos-benchmark.bmp");
+
+        if (!SyntheticImage::Make(SyntheticImage::SizeForMpix(mpix), 3).save(image_file)) {
+            qWarning("%s: could not write %s", qPrintable(case_name), qPrintable(image_file));
+
+            return;
+        }
+
+        EditorDriver driver;
+        QVariantMap  properties;
+
+        properties["radius"]    = 11;
+        properties["threshold"] = 80;
+        properties["pixDenom"]  = 112;
+        properties["hue"]       = 180;
+
+        if (driver.open(editor_name, image_file, properties)) {
+            QSize size(driver.editor()->width(), driver.editor()->height());
+
+            qreal width  = size.width();
+            qreal height = size.height();
+
+            if (editor_name == "retouch" && mode == RetouchEditor::ModeClone) {
+                driver.setMode(RetouchEditor::ModeSamplingPoint);
+
+                driver.sendMouseEvent(QEvent::GraphicsSceneMousePress,   QPointF(width / 4, height / 4));
+                driver.sendMouseEvent(QEvent::GraphicsSceneMouseRelease, QPointF(width / 4, height / 4));
+            }
+
+            driver.setMode(mode);
+
+            QElapsedTimer timer;
+            int           strokes       = 0;
+            qint64        press_elapsed = 0;
+            qint64        move_elapsed  = 0;
+
+            do {
+                timer.start();
+
+                driver.sendMouseEvent(QEvent::GraphicsSceneMousePress, QPointF(width / 4, height / 2));
+
+                press_elapsed += timer.restart();
+
+                for (int i = 0; i < STROKE_EVENTS; i++) {
+                    driver.sendMouseEvent(QEvent::GraphicsSceneMouseMove, QPointF(width / 4 + i * width / 2 / STROKE_EVENTS,
+                                                                                   height / 2 + (i % 16 - 8) * 2));
+                }
+
+                move_elapsed += timer.elapsed();
+
+                driver.sendMouseEvent(QEvent::GraphicsSceneMouseRelease, QPointF(width * 3 / 4, height / 2));
+
+                strokes++;
+            } while (press_elapsed + move_elapsed < MIN_ELAPSED && strokes < MAX_ITERATIONS);
+
+            Report(case_name + ".press", mpix, size, strokes,                 press_elapsed);
+            Report(case_name + ".move",  mpix, size, strokes * STROKE_EVENTS, move_elapsed);
+        } else {
+            qWarning("%s: could not open image", qPrintable(case_name));
+        }
+
+        QFile::remove(image_file);
+    }
+}
+
+void EffectBenchmark::BenchmarkStack(const qreal &mpix)
+{
+    QString case_name = "stack.retune-last";
+
+    if (Matches(case_name)) {
+        EditStack     stack;
+        QImage        input_image = SyntheticImage::Make(SyntheticImage::SizeForMpix(mpix), 4);
+        QElapsedTimer timer;
+        int           iterations  = 0;
+
+        stack.setImage(input_image);
+        stack.addStage(EditStack::EffectSketch);
+        stack.addStage(EditStack::EffectBlur);
+        stack.addStage(EditStack::EffectPixelate);
+        stack.render();
+
+        // Only the last stage is recomputed
+
+        timer.start();
+
+        do {
+            stack.setParameter(2, EditStack::ParameterPixDenom, iterations % 2 == 0 ? 100 : 112);
+            stack.render();
+
+            iterations++;
+        } while (timer.elapsed() < MIN_ELAPSED && iterations < MAX_ITERATIONS);
+
+        Report(case_name, mpix, input_image.size(), iterations, timer.elapsed());
+    }
+}
+
+void EffectBenchmark::BenchmarkSession(const qreal &mpix)
+{
+    QString case_name = "session.sketch";
+
+    if (Matches(case_name)) {
+        QString image_file   = QDir::temp().filePath("magicphotos-benchmark.jpg");
+        QString session_file = QDir::temp().filePath("magicphotos-benchmark.session");
+        QImage  input_image  = SyntheticImage::Make(SyntheticImage::SizeForMpix(mpix), 5);
+
+        if (!input_image.save(image_file)) {
+            qWarning("%s: could not write %s", qPrintable(case_name), qPrintable(image_file));
+
+            return;
+        }
+
+        QImage            effected_image = input_image;
+        EffectMask        mask(input_image.size());
+        QList<TiledImage> journal;
+
+        ImageKernels::Sketch(effected_image, 11);
+
+        // Four strokes, each leaving the mask before it in the undo journal
+
+        for (int i = 0; i < 4; i++) {
+            journal.append(mask.weights());
+
+            mask.stamp(BrushMask::Cached(32, 0.5), QPoint(input_image.width() * (i + 1) / 5, input_image.height() / 2), 0);
+        }
+
+        EditSession   session;
+        QElapsedTimer timer;
+        int           iterations;
+
+        session.setEditor("sketch");
+        session.setSourceFile(image_file);
+        session.setParameter("radius", 11);
+        session.setImage("mask",     mask.weights());
+        session.setImage("original", TiledImage(input_image));
+        session.setImage("effected", TiledImage(effected_image));
+        session.setJournal(journal);
+
+        iterations = 0;
+
+        timer.start();
+
+        do {
+            session.save(session_file);
+
+            iterations++;
+        } while (timer.elapsed() < MIN_ELAPSED && iterations < MAX_ITERATIONS);
+
+        Report(case_name + ".save", mpix, input_image.size(), iterations, timer.elapsed());
+
+        iterations = 0;
+
+        timer.start();
+
+        do {
+            EditSession resumed;
+
+            resumed.load(session_file);
+            resumed.image("original").toImage();
+            resumed.image("effected").toImage();
+
+            iterations++;
+        } while (timer.elapsed() < MIN_ELAPSED && iterations < MAX_ITERATIONS);
+
+        Report(case_name + ".resume", mpix, input_image.size(), iterations, timer.elapsed());
+
+        iterations = 0;
+
+        timer.start();
+
+        do {
+            QImage image = ImageKernels::ToRGB16(QImage(image_file));
+
+            ImageKernels::Sketch(image, 11);
+
+            iterations++;
+        } while (timer.elapsed() < MIN_ELAPSED && iterations < MAX_ITERATIONS);
+
+        Report(case_name + ".regenerate", mpix, input_image.size(), iterations, timer.elapsed());
+
+        QFile::remove(image_file);
+        QFile::remove(session_file);
+    }
+}
+
+void EffectBenchmark::BenchmarkAutosave(const qreal &mpix)
+{
+    QString case_name = "autosave.mask";
+
+    if (Matches(case_name)) {
+        QString        session_file = QDir::temp().filePath("magicphotos-benchmark-autosave.session");
+        QSize          size         = SyntheticImage::SizeForMpix(mpix);
+        EffectMask     mask(size);
+        EditSession    session;
+        AutosaveWriter writer;
+        QElapsedTimer  timer;
+        int            strokes       = 0;
+        qint64         flush_elapsed = 0;
+        qint64         write_elapsed = 0;
+
+        session.setEditor("benchmark");
+        session.setImage("mask", mask.weights());
+
+        writer.start(session_file, session);
+
+        // The first write stores the whole session; timed ones append one stroke each
+
+        writer.update("mask", mask.weights());
+        writer.flush();
+        writer.stop();
+
+        do {
+            for (int i = 0; i < STROKE_EVENTS; i++) {
+                mask.stamp(BrushMask::Cached(16, 1.0), QPoint(size.width() / 4 + i * size.width() / 2 / STROKE_EVENTS,
+                                                              size.height() * (strokes % 8 + 1) / 9),
+                           strokes % 16 < 8 ? BrushMask::MAX_WEIGHT : 0);
+
+                writer.update("mask", mask.weights());
+            }
+
+            timer.start();
+
+            writer.flush();
+
+            flush_elapsed += timer.restart();
+
+            writer.stop();
+
+            write_elapsed += timer.elapsed();
+
+            strokes++;
+        } while (flush_elapsed + write_elapsed < MIN_ELAPSED && strokes < MAX_ITERATIONS);
+
+        Report(case_name + ".flush", mpix, size, strokes, flush_elapsed);
+        Report(case_name + ".write", mpix, size, strokes, write_elapsed);
+
+        QFile::remove(session_file);
+        QFile::remove(session_file + ".journal");
+    }
+}
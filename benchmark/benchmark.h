@@ -0,0 +1,46 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QSize>
+#include <QTextStream>
+
+class EffectBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EffectBenchmark(QObject *parent = 0);
+    virtual ~EffectBenchmark();
+
+    QList<qreal> sizes() const;
+    void         setSizes(const QList<qreal> &sizes);
+
+    QString filter() const;
+    void    setFilter(const QString &filter);
+
+    void run();
+
+private:
+    bool Matches(const QString &case_name) const;
+    void Report(const QString &case_name, const qreal &mpix, const QSize &size, int iterations, qint64 elapsed);
+
+    void BenchmarkGenerator(const QString &effect_name, const qreal &mpix, const QString &variant = QString());
+    void BenchmarkAdjustHue(const qreal &mpix);
+    void BenchmarkStroke(const QString &editor_name, int mode, const qreal &mpix);
+    void BenchmarkStack(const qreal &mpix);
+    void BenchmarkSession(const qreal &mpix);
+    void BenchmarkAutosave(const qreal &mpix);
+
+    static const int MIN_ELAPSED    = 500,
+                     MAX_ITERATIONS = 1000,
+                     STROKE_EVENTS  = 100;
+
+    QList<qreal> Sizes;
+    QString      Filter;
+    QTextStream  Out;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,70 @@
+TARGET = magicphotos-benchmark
+VERSION = 2.0.1
+
+TEMPLATE = app
+QT += core gui declarative
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += .. ../cli
+
+SOURCES += main.cpp \
+    benchmark.cpp \
+    editordriver.cpp \
+    tracereplayer.cpp \
+    ../cli/batchprocessor.cpp \
+    ../cli/syntheticimage.cpp \
+    ../tracer.cpp \
+    ../imagekernels.cpp \
+    ../effectpipeline.cpp \
+    ../effectscheduler.cpp \
+    ../cellmap.cpp \
+    ../tiledimage.cpp \
+    ../brushmask.cpp \
+    ../effectmask.cpp \
+    ../editstack.cpp \
+    ../editsession.cpp \
+    ../autosavewriter.cpp \
+    ../blurlayer.cpp \
+    ../repaintcoalescer.cpp \
+    ../tilepyramid.cpp \
+    ../exifthumbnail.cpp \
+    ../previewsource.cpp \
+    ../decolorizeeditor.cpp \
+    ../sketcheditor.cpp \
+    ../cartooneditor.cpp \
+    ../blureditor.cpp \
+    ../pixelateeditor.cpp \
+    ../recoloreditor.cpp \
+    ../retoucheditor.cpp
+HEADERS += \
+    benchmark.h \
+    editordriver.h \
+    tracereplayer.h \
+    ../cli/batchprocessor.h \
+    ../cli/syntheticimage.h \
+    ../tracer.h \
+    ../imagekernels.h \
+    ../effectpipeline.h \
+    ../effectscheduler.h \
+    ../cellmap.h \
+    ../tiledimage.h \
+    ../brushmask.h \
+    ../effectmask.h \
+    ../editstack.h \
+    ../editsession.h \
+    ../autosavewriter.h \
+    ../blurlayer.h \
+    ../repaintcoalescer.h \
+    ../tilepyramid.h \
+    ../exifthumbnail.h \
+    ../previewsource.h \
+    ../decolorizeeditor.h \
+    ../sketcheditor.h \
+    ../cartooneditor.h \
+    ../blureditor.h \
+    ../pixelateeditor.h \
+    ../recoloreditor.h \
+    ../retoucheditor.h
+
+RESOURCES += traces.qrc
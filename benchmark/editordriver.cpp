@@ -0,0 +1,166 @@
+#include <QUrl>
+#include <QTimer>
+#include <QEventLoop>
+#include <QPainter>
+#include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
+
+#include "editordriver.h"
+#include "decolorizeeditor.h"
+#include "sketcheditor.h"
+#include "cartooneditor.h"
+#include "blureditor.h"
+#include "pixelateeditor.h"
+#include "recoloreditor.h"
+#include "retoucheditor.h"
+#include "editsession.h"
+
+EditorDriver::EditorDriver(QObject *parent) : QObject(parent)
+{
+    IsOpenFinished  = false;
+    IsOpenSucceeded = false;
+    Editor          = 0;
+}
+
+EditorDriver::~EditorDriver()
+{
+    close();
+}
+
+QStringList EditorDriver::EditorNames()
+{
+    return QStringList() << "decolorize" << "sketch" << "cartoon" << "blur" << "pixelate" << "recolor" << "retouch";
+}
+
+bool EditorDriver::open(const QString &editor_name, const QString &image_file, const QVariantMap &properties)
+{
+    close();
+
+    if (editor_name == "decolorize") {
+        Editor = new DecolorizeEditor();
+    } else if (editor_name == "sketch") {
+        Editor = new SketchEditor();
+    } else if (editor_name == "cartoon") {
+        Editor = new CartoonEditor();
+    } else if (editor_name == "blur") {
+        Editor = new BlurEditor();
+    } else if (editor_name == "pixelate") {
+        Editor = new PixelateEditor();
+    } else if (editor_name == "recolor") {
+        Editor = new RecolorEditor();
+    } else if (editor_name == "retouch") {
+        Editor = new RetouchEditor();
+    } else {
+        return false;
+    }
+
+    Scene.addItem(Editor);
+
+    Editor->setProperty("helperSize", HELPER_SIZE);
+
+    for (QVariantMap::const_iterator iter = properties.constBegin(); iter != properties.constEnd(); ++iter) {
+        Editor->setProperty(iter.key().toLatin1().constData(), iter.value());
+    }
+
+    QObject::connect(Editor, SIGNAL(imageOpened()),     this, SLOT(imageOpened()));
+    QObject::connect(Editor, SIGNAL(imageOpenFailed()), this, SLOT(imageOpenFailed()));
+
+    IsOpenFinished  = false;
+    IsOpenSucceeded = false;
+    ImageFile       = image_file;
+
+    // A saved session of the same file would skip the work being measured
+
+    EditSession::Remove(ImageFile);
+
+    QMetaObject::invokeMethod(Editor, "openImage", Qt::DirectConnection, Q_ARG(QString, QUrl::fromLocalFile(image_file).toString()));
+
+    if (!IsOpenFinished) {
+        QEventLoop loop;
+
+        QObject::connect(this, SIGNAL(openFinished()), &loop, SLOT(quit()));
+
+        QTimer::singleShot(OPEN_TIMEOUT, &loop, SLOT(quit()));
+
+        loop.exec();
+    }
+
+    if (IsOpenSucceeded) {
+        Editor->setWidth(Editor->implicitWidth());
+        Editor->setHeight(Editor->implicitHeight());
+
+        PaintTarget = QImage(Editor->implicitWidth(), Editor->implicitHeight(), QImage::Format_RGB16);
+    }
+
+    return IsOpenSucceeded;
+}
+
+void EditorDriver::close()
+{
+    if (Editor != 0) {
+        Scene.removeItem(Editor);
+
+        delete Editor;
+
+        Editor = 0;
+
+        EditSession::Remove(ImageFile);
+    }
+
+    PaintTarget = QImage();
+}
+
+QDeclarativeItem *EditorDriver::editor() const
+{
+    return Editor;
+}
+
+void EditorDriver::setMode(const int &mode)
+{
+    if (Editor != 0) {
+        Editor->setProperty("mode", mode);
+    }
+}
+
+void EditorDriver::sendMouseEvent(QEvent::Type type, const QPointF &pos)
+{
+    if (Editor != 0) {
+        QGraphicsSceneMouseEvent event(type);
+
+        event.setPos(pos);
+        event.setScenePos(Editor->mapToScene(pos));
+        event.setButton(Qt::LeftButton);
+        event.setButtons(type == QEvent::GraphicsSceneMouseRelease ? Qt::NoButton : Qt::LeftButton);
+
+        Scene.sendEvent(Editor, &event);
+    }
+}
+
+void EditorDriver::paintEditor()
+{
+    if (Editor != 0 && !PaintTarget.isNull()) {
+        QPainter                 painter(&PaintTarget);
+        QStyleOptionGraphicsItem option;
+
+        option.rect        = PaintTarget.rect();
+        option.exposedRect = PaintTarget.rect();
+
+        Editor->paint(&painter, &option, 0);
+    }
+}
+
+void EditorDriver::imageOpened()
+{
+    IsOpenFinished  = true;
+    IsOpenSucceeded = true;
+
+    emit openFinished();
+}
+
+void EditorDriver::imageOpenFailed()
+{
+    IsOpenFinished  = true;
+    IsOpenSucceeded = false;
+
+    emit openFinished();
+}
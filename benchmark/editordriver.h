@@ -0,0 +1,52 @@
+#ifndef EDITORDRIVER_H
+#define EDITORDRIVER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <QPointF>
+#include <QEvent>
+#include <QImage>
+#include <QGraphicsScene>
+#include <QDeclarativeItem>
+
+class EditorDriver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditorDriver(QObject *parent = 0);
+    virtual ~EditorDriver();
+
+    static QStringList EditorNames();
+
+    bool open(const QString &editor_name, const QString &image_file, const QVariantMap &properties);
+    void close();
+
+    QDeclarativeItem *editor() const;
+
+    void setMode(const int &mode);
+
+    void sendMouseEvent(QEvent::Type type, const QPointF &pos);
+    void paintEditor();
+
+public slots:
+    void imageOpened();
+    void imageOpenFailed();
+
+signals:
+    void openFinished();
+
+private:
+    static const int OPEN_TIMEOUT = 60000,
+                     HELPER_SIZE  = 128;
+
+    bool              IsOpenFinished, IsOpenSucceeded;
+    QString           ImageFile;
+    QGraphicsScene    Scene;
+    QDeclarativeItem *Editor;
+    QImage            PaintTarget;
+};
+
+#endif // EDITORDRIVER_H
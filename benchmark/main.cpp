@@ -0,0 +1,102 @@
+#include <QApplication>
+#include <QStringList>
+#include <QTextStream>
+
+#include "tracer.h"
+#include "benchmark.h"
+#include "tracereplayer.h"
+
+static void PrintUsage()
+{
+    QTextStream err(stderr);
+
+    err << "Usage: magicphotos-benchmark [--sizes MPIX,...] [--filter CASE]" << endl
+        << "       magicphotos-benchmark --replay [--sizes MPIX,...] [--filter CASE] [TRACE_FILE...]" << endl
+        << endl
+        << "Times every image generator and brush path on synthetic images and prints" << endl
+        << "one CSV row per case; --replay replays touch traces through the editors" << endl
+        << endl
+        << "Options:" << endl
+        << "  --sizes LIST     comma-separated synthetic image sizes in megapixels" << endl
+        << "                   (default 0.2,1,4,16, or 1,4 with --replay)" << endl
+        << "  --filter CASE    run only cases whose name contains CASE" << endl
+        << "  TRACE_FILE       touch trace to replay instead of the canned ones (fast-scribble," << endl
+        << "                   slow-fill, clone-drag)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv, false);
+
+    Tracer::Initialize();
+
+    EffectBenchmark benchmark;
+    TraceReplayer   replayer;
+    QStringList     args        = app.arguments();
+    QStringList     inputs;
+    bool            valid       = true;
+    bool            replay_mode = false;
+
+    for (int i = 1; i < args.size() && valid; i++) {
+        QString arg = args.at(i);
+
+        if (arg == "--replay") {
+            replay_mode = true;
+        } else if (arg.startsWith("--")) {
+            if (i + 1 >= args.size()) {
+                valid = false;
+
+                break;
+            }
+
+            QString value = args.at(++i);
+            bool    ok    = true;
+
+            if (arg == "--sizes") {
+                QList<qreal> sizes;
+
+                foreach (const QString &size, value.split(",", QString::SkipEmptyParts)) {
+                    sizes.append(size.toDouble(&ok));
+
+                    if (!ok || sizes.last() <= 0.0) {
+                        ok = false;
+
+                        break;
+                    }
+                }
+
+                benchmark.setSizes(sizes);
+                replayer.setSizes(sizes);
+            } else if (arg == "--filter") {
+                benchmark.setFilter(value);
+                replayer.setFilter(value);
+            } else {
+                ok = false;
+            }
+
+            if (!ok) {
+                qWarning("invalid option: %s %s", qPrintable(arg), qPrintable(value));
+
+                valid = false;
+            }
+        } else {
+            inputs.append(arg);
+        }
+    }
+
+    if (!valid || (!replay_mode && !inputs.isEmpty())) {
+        PrintUsage();
+
+        return 2;
+    }
+
+    if (replay_mode) {
+        replayer.setTraceFiles(inputs);
+
+        return replayer.run() ? 0 : 1;
+    }
+
+    benchmark.run();
+
+    return 0;
+}
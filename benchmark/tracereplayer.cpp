@@ -0,0 +1,354 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QPointF>
+#include <QVariantMap>
+#include <QMetaObject>
+#include <QMetaEnum>
+#include <QDeclarativeItem>
+
+#include "tracereplayer.h"
+#include "syntheticimage.h"
+#include "editordriver.h"
+
+TraceReplayer::TraceReplayer(QObject *parent) : QObject(parent), Out(stdout)
+{
+    Sizes << 1.0 << 4.0;
+}
+
+TraceReplayer::~TraceReplayer()
+{
+}
+
+QList<qreal> TraceReplayer::sizes() const
+{
+    return Sizes;
+}
+
+void TraceReplayer::setSizes(const QList<qreal> &sizes)
+{
+    Sizes = sizes;
+}
+
+QString TraceReplayer::filter() const
+{
+    return Filter;
+}
+
+void TraceReplayer::setFilter(const QString &filter)
+{
+    Filter = filter;
+}
+
+QStringList TraceReplayer::traceFiles() const
+{
+    return TraceFiles;
+}
+
+void TraceReplayer::setTraceFiles(const QStringList &file_names)
+{
+    TraceFiles = file_names;
+}
+
+QStringList TraceReplayer::CannedTraceFiles()
+{
+    QDir        dir(":/traces");
+    QStringList file_names;
+
+    foreach (const QString &name, dir.entryList(QStringList() << "*.trace", QDir::Files, QDir::Name)) {
+        file_names.append(dir.filePath(name));
+    }
+
+    return file_names;
+}
+
+bool TraceReplayer::run()
+{
+    QStringList file_names = TraceFiles.isEmpty() ? CannedTraceFiles() : TraceFiles;
+    bool        result     = true;
+
+    Out << "case,mpix,width,height,events,event_p50,event_p90,event_p99,event_max,"
+           "latency_p50,latency_p90,latency_p99,latency_max,paints,paint_msecs" << endl;
+
+    foreach (const QString &file_name, file_names) {
+        Trace trace;
+
+        if (!LoadTrace(file_name, &trace)) {
+            result = false;
+
+            continue;
+        }
+
+        QStringList editor_names = trace.Editors.isEmpty() ? EditorDriver::EditorNames() : trace.Editors;
+
+        for (int i = 0; i < Sizes.size(); i++) {
+            foreach (const QString &editor_name, editor_names) {
+                result = Replay(trace, editor_name, Sizes.at(i)) && result;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool TraceReplayer::LoadTrace(const QString &file_name, Trace *trace)
+{
+    QFile file(file_name);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning("%s: could not read trace", qPrintable(file_name));
+
+        return false;
+    }
+
+    QTextStream in(&file);
+    int         line_number = 0;
+    qint64      last_time   = 0;
+
+    trace->Name = QFileInfo(file_name).completeBaseName();
+
+    while (!in.atEnd()) {
+        QString     line   = in.readLine().section('#', 0, 0);
+        QStringList fields = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        bool        ok     = true;
+
+        line_number++;
+
+        if (fields.isEmpty()) {
+            continue;
+        }
+
+        if (fields.at(0) == "editors" && fields.size() == 2) {
+            trace->Editors = fields.at(1).split(",", QString::SkipEmptyParts);
+
+            foreach (const QString &editor_name, trace->Editors) {
+                ok = ok && EditorDriver::EditorNames().contains(editor_name);
+            }
+        } else if (fields.at(0) == "mode" && fields.size() == 2) {
+            Step step;
+
+            step.Type = StepMode;
+            step.Time = last_time;
+            step.X    = 0.0;
+            step.Y    = 0.0;
+            step.Mode = fields.at(1);
+
+            trace->Steps.append(step);
+        } else if ((fields.at(0) == "press" || fields.at(0) == "move" || fields.at(0) == "release") && fields.size() == 4) {
+            Step step;
+            bool time_ok, x_ok, y_ok;
+
+            if (fields.at(0) == "press") {
+                step.Type = StepPress;
+            } else if (fields.at(0) == "move") {
+                step.Type = StepMove;
+            } else {
+                step.Type = StepRelease;
+            }
+
+            step.Time = fields.at(1).toLongLong(&time_ok);
+            step.X    = fields.at(2).toDouble(&x_ok);
+            step.Y    = fields.at(3).toDouble(&y_ok);
+
+            ok = time_ok && x_ok && y_ok && step.Time >= last_time &&
+                 step.X >= 0.0 && step.X <= 1.0 && step.Y >= 0.0 && step.Y <= 1.0;
+
+            last_time = step.Time;
+
+            trace->Steps.append(step);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            qWarning("%s:%d: invalid trace step", qPrintable(file_name), line_number);
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+qint64 TraceReplayer::Microseconds(const QElapsedTimer &timer)
+{
+#if QT_VERSION >= 0x040800
+    return timer.nsecsElapsed() / 1000;
+#else
+    return timer.elapsed() * 1000;
+#endif
+}
+
+qreal TraceReplayer::Percentile(const QVector<qint64> &sorted_values, int percent)
+{
+    // Nearest rank, in msecs
+
+    if (sorted_values.isEmpty()) {
+        return 0.0;
+    }
+
+    int rank = qBound(1, (sorted_values.size() * percent + 99) / 100, sorted_values.size());
+
+    return sorted_values.at(rank - 1) / 1000.0;
+}
+
+bool TraceReplayer::Matches(const QString &case_name) const
+{
+    return Filter.isEmpty() || case_name.contains(Filter, Qt::CaseInsensitive);
+}
+
+bool TraceReplayer::Replay(const Trace &trace, const QString &editor_name, const qreal &mpix)
+{
+    QString case_name = QString("replay.%1.%2").arg(trace.Name).arg(editor_name);
+
+    if (!Matches(case_name)) {
+        return true;
+    }
+
+    QString image_file = QDir::temp().filePath("magicphotos-replay.bmp");
+
+    if (!SyntheticImage::Make(SyntheticImage::SizeForMpix(mpix), 6).save(image_file)) {
+        qWarning("%s: could not write %s", qPrintable(case_name), qPrintable(image_file));
+
+        return false;
+    }
+
+    EditorDriver driver;
+    QVariantMap  properties;
+
+    properties["radius"]    = 11;
+    properties["threshold"] = 80;
+    properties["pixDenom"]  = 112;
+    properties["hue"]       = 180;
+
+    if (!driver.open(editor_name, image_file, properties)) {
+        qWarning("%s: could not open image", qPrintable(case_name));
+
+        QFile::remove(image_file);
+
+        return false;
+    }
+
+    QSize           size(driver.editor()->width(), driver.editor()->height());
+    QVector<qint64> event_times, latencies, frame_times;
+    QElapsedTimer   timer;
+    qint64          frame_end   = 0;
+    qint64          paint_total = 0;
+    int             paints      = 0;
+    bool            result      = true;
+
+    for (int i = 0; i < trace.Steps.size() && result; i++) {
+        const Step &step = trace.Steps.at(i);
+
+        if (step.Type == StepMode) {
+            if (!SetMode(&driver, step.Mode)) {
+                qWarning("%s: no mode %s", qPrintable(case_name), qPrintable(step.Mode));
+
+                result = false;
+            }
+
+            continue;
+        }
+
+        QEvent::Type type;
+
+        if (step.Type == StepPress) {
+            type = QEvent::GraphicsSceneMousePress;
+        } else if (step.Type == StepMove) {
+            type = QEvent::GraphicsSceneMouseMove;
+        } else {
+            type = QEvent::GraphicsSceneMouseRelease;
+        }
+
+        if (frame_times.isEmpty()) {
+            frame_end = (step.Time / FRAME_INTERVAL + 1) * FRAME_INTERVAL;
+        }
+
+        timer.start();
+
+        driver.sendMouseEvent(type, QPointF(step.X * size.width(), step.Y * size.height()));
+
+        qint64 elapsed = Microseconds(timer);
+
+        event_times.append(elapsed);
+        frame_times.append(elapsed);
+
+        // The frame is painted once no later event falls inside it
+
+        int next = i + 1;
+
+        while (next < trace.Steps.size() && trace.Steps.at(next).Type == StepMode) {
+            next++;
+        }
+
+        if (next == trace.Steps.size() || trace.Steps.at(next).Time >= frame_end) {
+            timer.start();
+
+            driver.paintEditor();
+
+            qint64 waiting = Microseconds(timer);
+
+            paint_total += waiting;
+            paints++;
+
+            // Each event waits for the rest of its frame and the paint
+
+            for (int j = frame_times.size() - 1; j >= 0; j--) {
+                waiting += frame_times.at(j);
+
+                latencies.append(waiting);
+            }
+
+            frame_times.clear();
+        }
+    }
+
+    if (result) {
+        qSort(event_times);
+        qSort(latencies);
+
+        Out << case_name << ","
+            << mpix << ","
+            << size.width() << ","
+            << size.height() << ","
+            << event_times.size() << ","
+            << Percentile(event_times, 50) << ","
+            << Percentile(event_times, 90) << ","
+            << Percentile(event_times, 99) << ","
+            << Percentile(event_times, 100) << ","
+            << Percentile(latencies, 50) << ","
+            << Percentile(latencies, 90) << ","
+            << Percentile(latencies, 99) << ","
+            << Percentile(latencies, 100) << ","
+            << paints << ","
+            << paint_total / 1000.0 << endl;
+    }
+
+    driver.close();
+
+    QFile::remove(image_file);
+
+    return result;
+}
+
+bool TraceReplayer::SetMode(EditorDriver *driver, const QString &mode_name)
+{
+    // Trace modes are the editor's Mode enum keys without their prefix
+
+    const QMetaObject *meta_object = driver->editor()->metaObject();
+    int                index       = meta_object->indexOfEnumerator("Mode");
+    int                mode        = -1;
+
+    if (index != -1) {
+        mode = meta_object->enumerator(index).keyToValue(QString("Mode%1").arg(mode_name).toLatin1().constData());
+    }
+
+    if (mode != -1) {
+        driver->setMode(mode);
+
+        return true;
+    } else {
+        return false;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef TRACEREPLAYER_H
+#define TRACEREPLAYER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+class EditorDriver;
+
+// Replays touch traces through the mouse handlers of offscreen editors and
+// reports how long each event takes to reach the pixels. A trace has one step
+// per line; '#' starts a comment:
+//
+//   editors sketch,blur       editors to replay on (default: all of them)
+//   mode Effected             switch to the editor's ModeEffected
+//   press T X Y               mouse press at T msecs, at X and Y given as
+//   move T X Y                fractions of the image width and height
+//   release T X Y
+//
+// The editor is painted once after the last event of each frame; latency runs
+// from an event's dispatch to the end of that paint.
+
+class TraceReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TraceReplayer(QObject *parent = 0);
+    virtual ~TraceReplayer();
+
+    QList<qreal> sizes() const;
+    void         setSizes(const QList<qreal> &sizes);
+
+    QString filter() const;
+    void    setFilter(const QString &filter);
+
+    QStringList traceFiles() const;
+    void        setTraceFiles(const QStringList &file_names);
+
+    static QStringList CannedTraceFiles();
+
+    bool run();
+
+private:
+    enum StepType {
+        StepMode,
+        StepPress,
+        StepMove,
+        StepRelease
+    };
+
+    struct Step
+    {
+        StepType Type;
+        qint64   Time;
+        qreal    X, Y;
+        QString  Mode;
+    };
+
+    struct Trace
+    {
+        QString     Name;
+        QStringList Editors;
+        QList<Step> Steps;
+    };
+
+    static bool   LoadTrace(const QString &file_name, Trace *trace);
+    static qint64 Microseconds(const QElapsedTimer &timer);
+    static qreal  Percentile(const QVector<qint64> &sorted_values, int percent);
+
+    bool Matches(const QString &case_name) const;
+    bool Replay(const Trace &trace, const QString &editor_name, const qreal &mpix);
+    bool SetMode(EditorDriver *driver, const QString &mode_name);
+
+    static const int FRAME_INTERVAL = 16;
+
+    QList<qreal> Sizes;
+    QString      Filter;
+    QStringList  TraceFiles;
+    QTextStream  Out;
+};
+
+#endif // TRACEREPLAYER_H
@@ -1,18 +1,26 @@
 #include <qmath.h>
 #include <QFileInfo>
-#include <QThread>
 #include <QImageReader>
 #include <QPainter>
 
 #include "blureditor.h"
+#include "imagekernels.h"
+#include "exifthumbnail.h"
+#include "effectscheduler.h"
+#include "tracer.h"
 
 BlurEditor::BlurEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 {
     IsChanged      = false;
     CurrentMode    = ModeScroll;
     HelperSize     = 0;
+    BrushSize      = DEFAULT_BRUSH_SIZE;
+    BrushHardness  = DEFAULT_BRUSH_HARDNESS;
     GaussianRadius = 0;
 
+    Repainter = new RepaintCoalescer(this, this);
+    Autosaver = new AutosaveWriter(this);
+
     setAcceptedMouseButtons(Qt::LeftButton | Qt::RightButton | Qt::MiddleButton);
 
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
@@ -21,6 +29,9 @@ BlurEditor::BlurEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 
 BlurEditor::~BlurEditor()
 {
+    EffectScheduler::Instance()->cancel(this);
+
+    SaveSession();
 }
 
 int BlurEditor::mode() const
@@ -43,6 +54,26 @@ void BlurEditor::setHelperSize(const int &size)
     HelperSize = size;
 }
 
+int BlurEditor::brushSize() const
+{
+    return BrushSize;
+}
+
+void BlurEditor::setBrushSize(const int &size)
+{
+    BrushSize = qMax(size, 1);
+}
+
+qreal BlurEditor::brushHardness() const
+{
+    return BrushHardness;
+}
+
+void BlurEditor::setBrushHardness(const qreal &hardness)
+{
+    BrushHardness = qBound((qreal)0.0, hardness, (qreal)1.0);
+}
+
 int BlurEditor::radius() const
 {
     return GaussianRadius;
@@ -60,8 +91,14 @@ bool BlurEditor::changed() const
 
 void BlurEditor::openImage(const QString &image_url)
 {
+    TRACE_SCOPE("BlurEditor::openImage");
+
     QString image_file = QUrl(image_url).toLocalFile();
 
+    if (!image_file.isNull() && ResumeSession(image_file)) {
+        return;
+    }
+
     if (!image_file.isNull()) {
         QImageReader reader(image_file);
 
@@ -77,27 +114,28 @@ void BlurEditor::openImage(const QString &image_url)
                 reader.setScaledSize(size);
             }
 
-            LoadedImage = reader.read();
+            {
+                TRACE_SCOPE("QImageReader::read");
+
+                LoadedImage = reader.read();
+            }
 
             if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+                LoadedImage = ImageKernels::ConvertToFormat(LoadedImage, QImage::Format_RGB16);
 
                 if (!LoadedImage.isNull()) {
-                    QThread            *thread    = new QThread();
-                    BlurImageGenerator *generator = new BlurImageGenerator();
+                    SourceFile = image_file;
 
-                    generator->moveToThread(thread);
+                    BlurImageGenerator *generator = new BlurImageGenerator();
 
-                    QObject::connect(thread,    SIGNAL(started()),                  generator, SLOT(start()));
-                    QObject::connect(thread,    SIGNAL(finished()),                 thread,    SLOT(deleteLater()));
                     QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this,      SLOT(effectedImageReady(const QImage &)));
-                    QObject::connect(generator, SIGNAL(finished()),                 thread,    SLOT(quit()));
                     QObject::connect(generator, SIGNAL(finished()),                 generator, SLOT(deleteLater()));
 
                     generator->setGaussianRadius(GaussianRadius);
                     generator->setInput(LoadedImage);
 
-                    thread->start(QThread::LowPriority);
+                    EffectScheduler::Instance()->cancel(this);
+                    EffectScheduler::Instance()->schedule(generator, EffectScheduler::PriorityBackground, this);
                 } else {
                     emit imageOpenFailed();
                 }
@@ -114,17 +152,19 @@ void BlurEditor::openImage(const QString &image_url)
 
 void BlurEditor::saveImage(const QString &image_url)
 {
+    TRACE_SCOPE("BlurEditor::saveImage");
+
     QString file_name = QUrl(image_url).toLocalFile();
 
     if (!file_name.isNull()) {
-        if (!CurrentImage.isNull()) {
+        if (!CurrentMask.isNull()) {
             if (QFileInfo(file_name).suffix().compare("png", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("jpg", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("bmp", Qt::CaseInsensitive) != 0) {
                 file_name = file_name + ".jpg";
             }
 
-            if (CurrentImage.convertToFormat(QImage::Format_ARGB32).save(file_name)) {
+            if (CurrentMask.composite(OriginalImage, EffectedImage, OriginalImage.rect()).save(file_name)) {
                 IsChanged = false;
 
                 emit imageSaved();
@@ -142,7 +182,9 @@ void BlurEditor::saveImage(const QString &image_url)
 void BlurEditor::undo()
 {
     if (UndoStack.size() > 0) {
-        CurrentImage = UndoStack.pop();
+        CurrentMask = UndoStack.pop();
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         if (UndoStack.size() == 0) {
             emit undoAvailabilityChanged(false);
@@ -150,17 +192,32 @@ void BlurEditor::undo()
 
         IsChanged = true;
 
+        Autosaver->update("mask", CurrentMask.weights());
+
         update();
     }
 }
 
+void BlurEditor::discard()
+{
+    Autosaver->stop();
+
+    IsChanged = false;
+
+    if (!SourceFile.isEmpty()) {
+        EditSession::Remove(SourceFile);
+    }
+}
+
 void BlurEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*)
 {
+    TRACE_SCOPE("BlurEditor::paint");
+
     qreal scale = 1.0;
 
-    if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-        scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                width() / CurrentImage.width() : height() / CurrentImage.height();
+    if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+        scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                width() / OriginalImage.width() : height() / OriginalImage.height();
     }
 
     bool antialiasing = painter->testRenderHint(QPainter::Antialiasing);
@@ -169,21 +226,22 @@ void BlurEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *option
         painter->setRenderHint(QPainter::Antialiasing, true);
     }
 
-    QRectF src_rect(option->exposedRect.left()   / scale,
-                    option->exposedRect.top()    / scale,
-                    option->exposedRect.width()  / scale,
-                    option->exposedRect.height() / scale);
-
-    painter->drawImage(option->exposedRect, CurrentImage.copy(src_rect.toRect()));
+    DisplayPyramid.draw(painter, option->exposedRect, scale);
 
     painter->setRenderHint(QPainter::Antialiasing, antialiasing);
 }
 
 void BlurEditor::effectedImageReady(const QImage &effected_image)
 {
+    Tracer::AsyncEnd("imageReady delivery", sender());
+
+    TRACE_SCOPE("BlurEditor::effectedImageReady");
+
     OriginalImage = LoadedImage;
     EffectedImage = effected_image;
-    CurrentImage  = EffectedImage;
+    CurrentMask   = EffectMask(EffectedImage.size());
+
+    DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
     LoadedImage = QImage();
 
@@ -191,8 +249,10 @@ void BlurEditor::effectedImageReady(const QImage &effected_image)
 
     IsChanged = true;
 
-    setImplicitWidth(CurrentImage.width());
-    setImplicitHeight(CurrentImage.height());
+    Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+    setImplicitWidth(EffectedImage.width());
+    setImplicitHeight(EffectedImage.height());
 
     update();
 
@@ -225,9 +285,85 @@ void BlurEditor::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     }
 }
 
+EditSession BlurEditor::MakeSession() const
+{
+    EditSession       session;
+    QList<TiledImage> journal;
+
+    for (int i = 0; i < UndoStack.size(); i++) {
+        journal.append(UndoStack.at(i).weights());
+    }
+
+    session.setEditor("blur");
+    session.setSourceFile(SourceFile);
+    session.setParameter("radius", GaussianRadius);
+    session.setImage("mask",     CurrentMask.weights());
+    session.setImage("original", TiledImage(OriginalImage));
+    session.setImage("effected", TiledImage(EffectedImage));
+    session.setJournal(journal);
+
+    return session;
+}
+
+bool BlurEditor::ResumeSession(const QString &image_file)
+{
+    TRACE_SCOPE("BlurEditor::ResumeSession");
+
+    EditSession session;
+
+    if (session.load(EditSession::FileFor(image_file)) && session.editor() == "blur" && session.sourceUnchanged() &&
+        session.parameter("radius") == GaussianRadius &&
+        session.image("original").size() == session.image("mask").size() &&
+        session.image("effected").size() == session.image("mask").size() && !session.image("mask").isNull()) {
+        QList<TiledImage> journal = session.journal();
+
+        SourceFile    = image_file;
+        OriginalImage = session.image("original").toImage();
+        EffectedImage = session.image("effected").toImage();
+        CurrentMask   = EffectMask(session.image("mask"));
+
+        UndoStack.clear();
+
+        for (int i = 0; i < journal.size(); i++) {
+            UndoStack.push(EffectMask(journal.at(i)));
+        }
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
+
+        IsChanged = true;
+
+        Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+        setImplicitWidth(OriginalImage.width());
+        setImplicitHeight(OriginalImage.height());
+
+        update();
+
+        emit undoAvailabilityChanged(!UndoStack.isEmpty());
+        emit imageOpened();
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void BlurEditor::SaveSession()
+{
+    if (IsChanged) {
+        Autosaver->finish();
+    } else {
+        Autosaver->stop();
+
+        if (!SourceFile.isEmpty() && !CurrentMask.isNull()) {
+            EditSession::Remove(SourceFile);
+        }
+    }
+}
+
 void BlurEditor::SaveUndoImage()
 {
-    UndoStack.push(CurrentImage);
+    UndoStack.push(CurrentMask);
 
     if (UndoStack.size() > UNDO_DEPTH) {
         for (int i = 0; i < UndoStack.size() - UNDO_DEPTH; i++) {
@@ -240,6 +376,8 @@ void BlurEditor::SaveUndoImage()
 
 void BlurEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 {
+    TRACE_SCOPE("BlurEditor::ChangeImageAt");
+
     if (CurrentMode != ModeScroll) {
         if (save_undo) {
             SaveUndoImage();
@@ -247,35 +385,31 @@ void BlurEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 
         qreal scale = 1.0;
 
-        if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-            scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                    width() / CurrentImage.width() : height() / CurrentImage.height();
+        if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+            scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                    width() / OriginalImage.width() : height() / OriginalImage.height();
         }
 
         int img_center_x = center_x   / scale;
         int img_center_y = center_y   / scale;
-        int radius       = BRUSH_SIZE / scale;
-
-        for (int x = img_center_x - radius; x <= img_center_x + radius; x++) {
-            for (int y = img_center_y - radius; y <= img_center_y + radius; y++) {
-                if (x >= 0 && x < CurrentImage.width() && y >= 0 && y < CurrentImage.height() && qSqrt(qPow(x - img_center_x, 2) + qPow(y - img_center_y, 2)) <= radius) {
-                    if (CurrentMode == ModeOriginal) {
-                        CurrentImage.setPixel(x, y, OriginalImage.pixel(x, y));
-                    } else {
-                        CurrentImage.setPixel(x, y, EffectedImage.pixel(x, y));
-                    }
-                }
-            }
-        }
+        int radius       = BrushSize  / scale;
+
+        CurrentMask.stamp(BrushMask::Cached(radius, BrushHardness), QPoint(img_center_x, img_center_y), CurrentMode == ModeOriginal ? 0 : BrushMask::MAX_WEIGHT);
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         IsChanged = true;
 
-        update(center_x - BRUSH_SIZE, center_y - BRUSH_SIZE, BRUSH_SIZE * 2, BRUSH_SIZE * 2);
+        Autosaver->update("mask", CurrentMask.weights());
+
+        Repainter->update(QRectF(center_x - BrushSize, center_y - BrushSize, BrushSize * 2, BrushSize * 2));
+
+        QRect helper_rect(img_center_x - (HelperSize / scale) / 2,
+                          img_center_y - (HelperSize / scale) / 2,
+                          HelperSize / scale,
+                          HelperSize / scale);
 
-        QImage helper_image = CurrentImage.copy(img_center_x - (HelperSize / scale) / 2,
-                                                img_center_y - (HelperSize / scale) / 2,
-                                                HelperSize / scale,
-                                                HelperSize / scale).scaledToWidth(HelperSize);
+        QImage helper_image = CurrentMask.composite(OriginalImage, EffectedImage, helper_rect).scaledToWidth(HelperSize);
 
         emit helperImageReady(helper_image);
     }
@@ -287,11 +421,17 @@ BlurPreviewGenerator::BlurPreviewGenerator(QDeclarativeItem *parent) : QDeclarat
     RestartBlurGenerator = false;
     GaussianRadius       = 0;
 
+    Source = new PreviewSource(this, IMAGE_MPIX_LIMIT, this);
+
+    QObject::connect(Source, SIGNAL(retargeted()),     this, SLOT(reloadImage()));
+    QObject::connect(Source, SIGNAL(generationDue()), this, SLOT(generate()));
+
     setFlag(QGraphicsItem::ItemHasNoContents, false);
 }
 
 BlurPreviewGenerator::~BlurPreviewGenerator()
 {
+    EffectScheduler::Instance()->cancel(this);
 }
 
 int BlurPreviewGenerator::radius() const
@@ -304,55 +444,20 @@ void BlurPreviewGenerator::setRadius(const int &radius)
     GaussianRadius = radius;
 
     if (!LoadedImage.isNull()) {
-        if (BlurGeneratorRunning) {
-            RestartBlurGenerator = true;
-        } else {
-            StartBlurGenerator();
-        }
+        Source->requestGeneration();
     }
 }
 
 void BlurPreviewGenerator::openImage(const QString &image_url)
 {
-    QString image_file = QUrl(image_url).toLocalFile();
+    TRACE_SCOPE("BlurPreviewGenerator::openImage");
 
-    if (!image_file.isNull()) {
-        QImageReader reader(image_file);
+    LoadedImage = Source->load(QUrl(image_url).toLocalFile());
 
-        if (reader.canRead()) {
-            QSize size = reader.size();
-
-            if (size.width() * size.height() > IMAGE_MPIX_LIMIT * 1000000.0) {
-                qreal factor = qSqrt((size.width() * size.height()) / (IMAGE_MPIX_LIMIT * 1000000.0));
-
-                size.setWidth(size.width()   / factor);
-                size.setHeight(size.height() / factor);
-
-                reader.setScaledSize(size);
-            }
-
-            LoadedImage = reader.read();
-
-            if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
-
-                if (!LoadedImage.isNull()) {
-                    emit imageOpened();
+    if (!LoadedImage.isNull()) {
+        emit imageOpened();
 
-                    if (BlurGeneratorRunning) {
-                        RestartBlurGenerator = true;
-                    } else {
-                        StartBlurGenerator();
-                    }
-                } else {
-                    emit imageOpenFailed();
-                }
-            } else {
-                emit imageOpenFailed();
-            }
-        } else {
-            emit imageOpenFailed();
-        }
+        Source->requestGeneration();
     } else {
         emit imageOpenFailed();
     }
@@ -360,6 +465,8 @@ void BlurPreviewGenerator::openImage(const QString &image_url)
 
 void BlurPreviewGenerator::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
+    TRACE_SCOPE("BlurPreviewGenerator::paint");
+
     qreal scale = 1.0;
 
     if (BlurImage.width() != 0 && BlurImage.height() != 0) {
@@ -388,6 +495,10 @@ void BlurPreviewGenerator::paint(QPainter *painter, const QStyleOptionGraphicsIt
 
 void BlurPreviewGenerator::blurImageReady(const QImage &blur_image)
 {
+    Tracer::AsyncEnd("imageReady delivery", sender());
+
+    TRACE_SCOPE("BlurPreviewGenerator::blurImageReady");
+
     BlurGeneratorRunning = false;
     BlurImage            = blur_image;
 
@@ -405,23 +516,48 @@ void BlurPreviewGenerator::blurImageReady(const QImage &blur_image)
     }
 }
 
+void BlurPreviewGenerator::reloadImage()
+{
+    TRACE_SCOPE("BlurPreviewGenerator::reloadImage");
+
+    QImage image = Source->reload();
+
+    if (!image.isNull()) {
+        LoadedImage = image;
+
+        Source->requestGeneration();
+    }
+}
+
+void BlurPreviewGenerator::generate()
+{
+    if (BlurGeneratorRunning) {
+        RestartBlurGenerator = true;
+    } else {
+        StartBlurGenerator();
+    }
+}
+
+void BlurPreviewGenerator::geometryChanged(const QRectF &new_geometry, const QRectF &old_geometry)
+{
+    QDeclarativeItem::geometryChanged(new_geometry, old_geometry);
+
+    if (new_geometry.size() != old_geometry.size()) {
+        Source->itemResized();
+    }
+}
+
 void BlurPreviewGenerator::StartBlurGenerator()
 {
-    QThread            *thread    = new QThread();
     BlurImageGenerator *generator = new BlurImageGenerator();
 
-    generator->moveToThread(thread);
-
-    QObject::connect(thread,    SIGNAL(started()),                  generator, SLOT(start()));
-    QObject::connect(thread,    SIGNAL(finished()),                 thread,    SLOT(deleteLater()));
     QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this,      SLOT(blurImageReady(const QImage &)));
-    QObject::connect(generator, SIGNAL(finished()),                 thread,    SLOT(quit()));
     QObject::connect(generator, SIGNAL(finished()),                 generator, SLOT(deleteLater()));
 
     generator->setGaussianRadius(GaussianRadius);
     generator->setInput(LoadedImage);
 
-    thread->start(QThread::LowPriority);
+    EffectScheduler::Instance()->schedule(generator, EffectScheduler::PriorityInteractive, this);
 
     BlurGeneratorRunning = true;
 
@@ -449,90 +585,13 @@ void BlurImageGenerator::setInput(const QImage &input_image)
 
 void BlurImageGenerator::start()
 {
-    QImage blur_image = InputImage;
-
-    QImage::Format format = blur_image.format();
-
-    blur_image = blur_image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-
-    int tab[] = { 14, 10, 8, 6, 5, 5, 4, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2 };
-    int alpha = (GaussianRadius < 1) ? 16 : (GaussianRadius > 17) ? 1 : tab[GaussianRadius - 1];
-
-    int r1 = blur_image.rect().top();
-    int r2 = blur_image.rect().bottom();
-    int c1 = blur_image.rect().left();
-    int c2 = blur_image.rect().right();
-
-    int bpl = blur_image.bytesPerLine();
-
-    int           rgba[4];
-    unsigned char *p;
-
-    for (int col = c1; col <= c2; col++) {
-        p = blur_image.scanLine(r1) + col * 4;
-
-        for (int i = 0; i < 4; i++) {
-            rgba[i] = p[i] << 4;
-        }
-
-        p += bpl;
-
-        for (int j = r1; j < r2; j++, p += bpl) {
-            for (int i = 0; i < 4; i++) {
-                p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-            }
-        }
-    }
-
-    for (int row = r1; row <= r2; row++) {
-        p = blur_image.scanLine(row) + c1 * 4;
+    TRACE_SCOPE("BlurImageGenerator::start");
 
-        for (int i = 0; i < 4; i++) {
-            rgba[i] = p[i] << 4;
-        }
-
-        p += 4;
-
-        for (int j = c1; j < c2; j++, p += 4) {
-            for (int i = 0; i < 4; i++) {
-                p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-            }
-        }
-    }
+    QImage blur_image = ImageKernels::ToRGB16(InputImage);
 
-    for (int col = c1; col <= c2; col++) {
-        p = blur_image.scanLine(r2) + col * 4;
-
-        for (int i = 0; i < 4; i++) {
-            rgba[i] = p[i] << 4;
-        }
-
-        p -= bpl;
-
-        for (int j = r1; j < r2; j++, p -= bpl) {
-            for (int i = 0; i < 4; i++) {
-                p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-            }
-        }
-    }
-
-    for (int row = r1; row <= r2; row++) {
-        p = blur_image.scanLine(row) + c2 * 4;
-
-        for (int i = 0; i < 4; i++) {
-            rgba[i] = p[i] << 4;
-        }
-
-        p -= 4;
-
-        for (int j = c1; j < c2; j++, p -= 4) {
-            for (int i = 0; i < 4; i++) {
-                p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-            }
-        }
-    }
+    ImageKernels::Blur(blur_image, GaussianRadius);
 
-    blur_image = blur_image.convertToFormat(format);
+    Tracer::AsyncBegin("imageReady delivery", this);
 
     emit imageReady(blur_image);
     emit finished();
@@ -0,0 +1,94 @@
+#include <QRect>
+
+#include "blurlayer.h"
+#include "imagekernels.h"
+
+BlurLayer::BlurLayer()
+{
+    GaussianRadius = 0;
+    TilesX         = 0;
+    TilesY         = 0;
+}
+
+void BlurLayer::setSource(const TiledImage &source_image, int gaussian_radius)
+{
+    SourceImage    = source_image;
+    GaussianRadius = gaussian_radius;
+    TilesX         = (SourceImage.width()  + TiledImage::TILE_SIZE - 1) / TiledImage::TILE_SIZE;
+    TilesY         = (SourceImage.height() + TiledImage::TILE_SIZE - 1) / TiledImage::TILE_SIZE;
+
+    Tiles.clear();
+    Tiles.resize(TilesX * TilesY);
+}
+
+void BlurLayer::clear()
+{
+    SourceImage = TiledImage();
+    TilesX      = 0;
+    TilesY      = 0;
+
+    Tiles.clear();
+}
+
+bool BlurLayer::isNull() const
+{
+    return SourceImage.isNull();
+}
+
+void BlurLayer::stamp(TiledImage &image, const BrushMask &mask, const QPoint &center)
+{
+    if (isNull() || mask.isNull() || image.size() != SourceImage.size() || image.format() != QImage::Format_RGB16) {
+        return;
+    }
+
+    const int tile_size = TiledImage::TILE_SIZE;
+
+    for (int dy = -mask.radius(); dy <= mask.radius(); dy++) {
+        int y = center.y() + dy;
+
+        if (y >= 0 && y < image.height()) {
+            int from_x = qMax(center.x() - mask.halfWidth(dy), 0);
+            int to_x   = qMin(center.x() + mask.halfWidth(dy), image.width() - 1);
+
+            const quint8 *weight = mask.weights(dy);
+
+            while (from_x <= to_x) {
+                int tile_x    = from_x / tile_size;
+                int tile_left = tile_x * tile_size;
+                int span_end  = qMin(to_x, tile_left + tile_size - 1);
+
+                quint16       *dst = (quint16 *)image.scanLine(tile_x, y);
+                const quint16 *src = (const quint16 *)Tile(tile_x, y / tile_size).constScanLine(y % tile_size);
+
+                for (int x = from_x; x <= span_end; x++) {
+                    dst[x - tile_left] = BrushMask::Blend(src[x - tile_left], dst[x - tile_left], weight[x - center.x()]);
+                }
+
+                from_x = span_end + 1;
+            }
+        }
+    }
+}
+
+const QImage &BlurLayer::Tile(int tile_x, int tile_y)
+{
+    QImage &tile = Tiles[tile_y * TilesX + tile_x];
+
+    if (tile.isNull()) {
+        // Blur a margin past the filter support, so tiles join without seams
+
+        int   margin = GaussianRadius * 2;
+        QRect tile_rect(tile_x * TiledImage::TILE_SIZE, tile_y * TiledImage::TILE_SIZE, TiledImage::TILE_SIZE, TiledImage::TILE_SIZE);
+
+        tile_rect = tile_rect.intersected(SourceImage.rect());
+
+        QRect  blur_rect  = tile_rect.adjusted(-margin, -margin, margin, margin).intersected(SourceImage.rect());
+        QImage blur_image = SourceImage.copy(blur_rect);
+
+        ImageKernels::Blur(blur_image, GaussianRadius);
+
+        tile = blur_image.copy(tile_rect.translated(-blur_rect.topLeft()));
+    }
+
+    return tile;
+}
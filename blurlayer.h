@@ -0,0 +1,35 @@
+#ifndef BLURLAYER_H
+#define BLURLAYER_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QPoint>
+#include <QImage>
+
+#include "tiledimage.h"
+#include "brushmask.h"
+
+// Blurred copy of an RGB16 source image, computed a tile at a time the first
+// time a brush stamp touches that tile.
+
+class BlurLayer
+{
+public:
+    BlurLayer();
+
+    void setSource(const TiledImage &source_image, int gaussian_radius);
+    void clear();
+
+    bool isNull() const;
+
+    void stamp(TiledImage &image, const BrushMask &mask, const QPoint &center);
+
+private:
+    const QImage &Tile(int tile_x, int tile_y);
+
+    int             GaussianRadius, TilesX, TilesY;
+    TiledImage      SourceImage;
+    QVector<QImage> Tiles;
+};
+
+#endif // BLURLAYER_H
@@ -0,0 +1,139 @@
+#include <qmath.h>
+
+#include "brushmask.h"
+
+BrushMask::BrushMask()
+{
+    Radius  = -1;
+    Feather = 0;
+}
+
+BrushMask::BrushMask(int radius, int feather)
+{
+    Radius  = qMax(radius, 0);
+    Feather = qBound(0, feather, Radius);
+
+    int size = Radius * 2 + 1;
+
+    HalfWidths.fill(0, size);
+    Weights.fill(0, size * size);
+
+    for (int dy = -Radius; dy <= Radius; dy++) {
+        int half_width = 0;
+
+        while ((half_width + 1) * (half_width + 1) + dy * dy <= Radius * Radius) {
+            half_width++;
+        }
+
+        HalfWidths[dy + Radius] = half_width;
+
+        quint8 *line = Weights.data() + (dy + Radius) * size + Radius;
+
+        for (int dx = -half_width; dx <= half_width; dx++) {
+            qreal distance = qSqrt(dx * dx + dy * dy);
+
+            if (Feather == 0 || distance <= Radius - Feather) {
+                line[dx] = MAX_WEIGHT;
+            } else {
+                line[dx] = qBound(0, qRound(MAX_WEIGHT * (Radius + 1 - distance) / (Feather + 1)), (int)MAX_WEIGHT);
+            }
+        }
+    }
+}
+
+int BrushMask::radius() const
+{
+    return Radius;
+}
+
+int BrushMask::feather() const
+{
+    return Feather;
+}
+
+bool BrushMask::isNull() const
+{
+    return Radius < 0;
+}
+
+BrushMask BrushMask::Cached(int radius, qreal hardness)
+{
+    static QHash<quint32, BrushMask> cache;
+
+    radius = qMax(radius, 0);
+
+    int     feather = qRound(radius * (1.0 - qBound((qreal)0.0, hardness, (qreal)1.0)));
+    quint32 key     = ((quint32)radius << 16) | feather;
+
+    QHash<quint32, BrushMask>::const_iterator cached = cache.constFind(key);
+
+    if (cached != cache.constEnd()) {
+        return cached.value();
+    } else {
+        if (cache.size() >= MAX_CACHED_MASKS) {
+            cache.clear();
+        }
+
+        BrushMask mask(radius, feather);
+
+        cache.insert(key, mask);
+
+        return mask;
+    }
+}
+
+void BrushMask::clone(TiledImage &image, const QPoint &source, const QPoint &target) const
+{
+    if (isNull() || image.format() != QImage::Format_RGB16) {
+        return;
+    }
+
+    // Rows are visited in memmove order, so overlapping stamps read the source
+
+    const int tile_size = TiledImage::TILE_SIZE;
+
+    int  offset_x = target.x() - source.x();
+    int  offset_y = target.y() - source.y();
+    int  step     = offset_y > 0 ? -1 : 1;
+    bool backward = offset_y == 0 && offset_x > 0;
+
+    for (int dy = offset_y > 0 ? Radius : -Radius; dy >= -Radius && dy <= Radius; dy += step) {
+        int src_y = source.y() + dy;
+        int dst_y = target.y() + dy;
+
+        if (src_y >= 0 && src_y < image.height() && dst_y >= 0 && dst_y < image.height()) {
+            int from_dx = qMax(-HalfWidths[dy + Radius], qMax(-source.x(), -target.x()));
+            int to_dx   = qMin(HalfWidths[dy + Radius], qMin(image.width() - 1 - source.x(), image.width() - 1 - target.x()));
+            int dx      = backward ? to_dx : from_dx;
+
+            const quint8 *weight = weights(dy);
+
+            // Split the span where the source or the target crosses a tile boundary
+
+            while (backward ? dx >= from_dx : dx <= to_dx) {
+                int src_x = source.x() + dx;
+                int dst_x = target.x() + dx;
+                int count = backward ? qMin(dx - from_dx, qMin(src_x % tile_size, dst_x % tile_size)) + 1 :
+                                       qMin(to_dx - dx, qMin(tile_size - 1 - src_x % tile_size, tile_size - 1 - dst_x % tile_size)) + 1;
+
+                quint16       *dst = (quint16 *)image.scanLine(dst_x / tile_size, dst_y) + dst_x % tile_size;
+                const quint16 *src = (const quint16 *)image.constScanLine(src_x / tile_size, src_y) + src_x % tile_size;
+                const quint8  *w   = weight + dx;
+
+                if (backward) {
+                    for (int i = 0; i > -count; i--) {
+                        dst[i] = Blend(src[i], dst[i], w[i]);
+                    }
+
+                    dx -= count;
+                } else {
+                    for (int i = 0; i < count; i++) {
+                        dst[i] = Blend(src[i], dst[i], w[i]);
+                    }
+
+                    dx += count;
+                }
+            }
+        }
+    }
+}
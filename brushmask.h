@@ -0,0 +1,65 @@
+#ifndef BRUSHMASK_H
+#define BRUSHMASK_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QHash>
+#include <QPoint>
+#include <QImage>
+
+#include "tiledimage.h"
+
+// Circular brush footprint with an 8-bit weight per pixel that falls off
+// linearly across the feather. Stamps work directly on RGB16 tile scanlines.
+
+class BrushMask
+{
+public:
+    BrushMask();
+    BrushMask(int radius, int feather);
+
+    int  radius() const;
+    int  feather() const;
+    bool isNull() const;
+
+    inline int halfWidth(int dy) const
+    {
+        return HalfWidths[dy + Radius];
+    }
+
+    // Weights of row dy, indexed by dx in [-halfWidth(dy), halfWidth(dy)]
+    inline const quint8 *weights(int dy) const
+    {
+        return Weights.constData() + (dy + Radius) * (Radius * 2 + 1) + Radius;
+    }
+
+    void clone(TiledImage &image, const QPoint &source, const QPoint &target) const;
+
+    // Shared per radius and feather; hardness 1.0 gives a hard edge
+    static BrushMask Cached(int radius, qreal hardness);
+
+    // Blends two RGB565 pixels with all three channels in one 32-bit word
+    static inline quint16 Blend(quint16 src, quint16 dst, int weight)
+    {
+        if (weight == MAX_WEIGHT) {
+            return src;
+        } else {
+            quint32 s = (src | (src << 16)) & 0x07E0F81F;
+            quint32 d = (dst | (dst << 16)) & 0x07E0F81F;
+            quint32 r = ((s * weight + d * (MAX_WEIGHT - weight)) >> 5) & 0x07E0F81F;
+
+            return r | (r >> 16);
+        }
+    }
+
+    static const int MAX_WEIGHT = 32;
+
+private:
+    static const int MAX_CACHED_MASKS = 32;
+
+    int             Radius, Feather;
+    QVector<int>    HalfWidths;
+    QVector<quint8> Weights;
+};
+
+#endif // BRUSHMASK_H
@@ -1,18 +1,27 @@
 #include <qmath.h>
 #include <QFileInfo>
-#include <QThread>
 #include <QImageReader>
 #include <QPainter>
 
 #include "cartooneditor.h"
+#include "imagekernels.h"
+#include "exifthumbnail.h"
+#include "effectscheduler.h"
+#include "tracer.h"
 
 CartoonEditor::CartoonEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 {
     IsChanged        = false;
     CurrentMode      = ModeScroll;
     HelperSize       = 0;
+    BrushSize        = DEFAULT_BRUSH_SIZE;
+    BrushHardness    = DEFAULT_BRUSH_HARDNESS;
     GaussianRadius   = 0;
     CartoonThreshold = 0;
+    CartoonSmoothing = SmoothingGaussian;
+
+    Repainter = new RepaintCoalescer(this, this);
+    Autosaver = new AutosaveWriter(this);
 
     setAcceptedMouseButtons(Qt::LeftButton | Qt::RightButton | Qt::MiddleButton);
 
@@ -22,6 +31,9 @@ CartoonEditor::CartoonEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent
 
 CartoonEditor::~CartoonEditor()
 {
+    EffectScheduler::Instance()->cancel(this);
+
+    SaveSession();
 }
 
 int CartoonEditor::mode() const
@@ -44,6 +56,26 @@ void CartoonEditor::setHelperSize(const int &size)
     HelperSize = size;
 }
 
+int CartoonEditor::brushSize() const
+{
+    return BrushSize;
+}
+
+void CartoonEditor::setBrushSize(const int &size)
+{
+    BrushSize = qMax(size, 1);
+}
+
+qreal CartoonEditor::brushHardness() const
+{
+    return BrushHardness;
+}
+
+void CartoonEditor::setBrushHardness(const qreal &hardness)
+{
+    BrushHardness = qBound((qreal)0.0, hardness, (qreal)1.0);
+}
+
 int CartoonEditor::radius() const
 {
     return GaussianRadius;
@@ -64,6 +96,16 @@ void CartoonEditor::setThreshold(const int &threshold)
     CartoonThreshold = threshold;
 }
 
+int CartoonEditor::smoothing() const
+{
+    return CartoonSmoothing;
+}
+
+void CartoonEditor::setSmoothing(const int &smoothing)
+{
+    CartoonSmoothing = smoothing;
+}
+
 bool CartoonEditor::changed() const
 {
     return IsChanged;
@@ -71,8 +113,14 @@ bool CartoonEditor::changed() const
 
 void CartoonEditor::openImage(const QString &image_url)
 {
+    TRACE_SCOPE("CartoonEditor::openImage");
+
     QString image_file = QUrl(image_url).toLocalFile();
 
+    if (!image_file.isNull() && ResumeSession(image_file)) {
+        return;
+    }
+
     if (!image_file.isNull()) {
         QImageReader reader(image_file);
 
@@ -88,28 +136,30 @@ void CartoonEditor::openImage(const QString &image_url)
                 reader.setScaledSize(size);
             }
 
-            LoadedImage = reader.read();
+            {
+                TRACE_SCOPE("QImageReader::read");
+
+                LoadedImage = reader.read();
+            }
 
             if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+                LoadedImage = ImageKernels::ConvertToFormat(LoadedImage, QImage::Format_RGB16);
 
                 if (!LoadedImage.isNull()) {
-                    QThread               *thread    = new QThread();
-                    CartoonImageGenerator *generator = new CartoonImageGenerator();
+                    SourceFile = image_file;
 
-                    generator->moveToThread(thread);
+                    CartoonImageGenerator *generator = new CartoonImageGenerator();
 
-                    QObject::connect(thread,    SIGNAL(started()),                  generator, SLOT(start()));
-                    QObject::connect(thread,    SIGNAL(finished()),                 thread,    SLOT(deleteLater()));
                     QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this,      SLOT(effectedImageReady(const QImage &)));
-                    QObject::connect(generator, SIGNAL(finished()),                 thread,    SLOT(quit()));
                     QObject::connect(generator, SIGNAL(finished()),                 generator, SLOT(deleteLater()));
 
                     generator->setGaussianRadius(GaussianRadius);
                     generator->setCartoonThreshold(CartoonThreshold);
+                    generator->setCartoonSmoothing(CartoonSmoothing);
                     generator->setInput(LoadedImage);
 
-                    thread->start(QThread::LowPriority);
+                    EffectScheduler::Instance()->cancel(this);
+                    EffectScheduler::Instance()->schedule(generator, EffectScheduler::PriorityBackground, this);
                 } else {
                     emit imageOpenFailed();
                 }
@@ -126,17 +176,19 @@ void CartoonEditor::openImage(const QString &image_url)
 
 void CartoonEditor::saveImage(const QString &image_url)
 {
+    TRACE_SCOPE("CartoonEditor::saveImage");
+
     QString file_name = QUrl(image_url).toLocalFile();
 
     if (!file_name.isNull()) {
-        if (!CurrentImage.isNull()) {
+        if (!CurrentMask.isNull()) {
             if (QFileInfo(file_name).suffix().compare("png", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("jpg", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("bmp", Qt::CaseInsensitive) != 0) {
                 file_name = file_name + ".jpg";
             }
 
-            if (CurrentImage.convertToFormat(QImage::Format_ARGB32).save(file_name)) {
+            if (CurrentMask.composite(OriginalImage, EffectedImage, OriginalImage.rect()).save(file_name)) {
                 IsChanged = false;
 
                 emit imageSaved();
@@ -154,7 +206,9 @@ void CartoonEditor::saveImage(const QString &image_url)
 void CartoonEditor::undo()
 {
     if (UndoStack.size() > 0) {
-        CurrentImage = UndoStack.pop();
+        CurrentMask = UndoStack.pop();
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         if (UndoStack.size() == 0) {
             emit undoAvailabilityChanged(false);
@@ -162,17 +216,32 @@ void CartoonEditor::undo()
 
         IsChanged = true;
 
+        Autosaver->update("mask", CurrentMask.weights());
+
         update();
     }
 }
 
+void CartoonEditor::discard()
+{
+    Autosaver->stop();
+
+    IsChanged = false;
+
+    if (!SourceFile.isEmpty()) {
+        EditSession::Remove(SourceFile);
+    }
+}
+
 void CartoonEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*)
 {
+    TRACE_SCOPE("CartoonEditor::paint");
+
     qreal scale = 1.0;
 
-    if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-        scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                width() / CurrentImage.width() : height() / CurrentImage.height();
+    if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+        scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                width() / OriginalImage.width() : height() / OriginalImage.height();
     }
 
     bool antialiasing = painter->testRenderHint(QPainter::Antialiasing);
@@ -181,21 +250,22 @@ void CartoonEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *opt
         painter->setRenderHint(QPainter::Antialiasing, true);
     }
 
-    QRectF src_rect(option->exposedRect.left()   / scale,
-                    option->exposedRect.top()    / scale,
-                    option->exposedRect.width()  / scale,
-                    option->exposedRect.height() / scale);
-
-    painter->drawImage(option->exposedRect, CurrentImage.copy(src_rect.toRect()));
+    DisplayPyramid.draw(painter, option->exposedRect, scale);
 
     painter->setRenderHint(QPainter::Antialiasing, antialiasing);
 }
 
 void CartoonEditor::effectedImageReady(const QImage &effected_image)
 {
+    Tracer::AsyncEnd("imageReady delivery", sender());
+
+    TRACE_SCOPE("CartoonEditor::effectedImageReady");
+
     OriginalImage = LoadedImage;
     EffectedImage = effected_image;
-    CurrentImage  = EffectedImage;
+    CurrentMask   = EffectMask(EffectedImage.size());
+
+    DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
     LoadedImage = QImage();
 
@@ -203,8 +273,10 @@ void CartoonEditor::effectedImageReady(const QImage &effected_image)
 
     IsChanged = true;
 
-    setImplicitWidth(CurrentImage.width());
-    setImplicitHeight(CurrentImage.height());
+    Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+    setImplicitWidth(EffectedImage.width());
+    setImplicitHeight(EffectedImage.height());
 
     update();
 
@@ -237,9 +309,88 @@ void CartoonEditor::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     }
 }
 
+EditSession CartoonEditor::MakeSession() const
+{
+    EditSession       session;
+    QList<TiledImage> journal;
+
+    for (int i = 0; i < UndoStack.size(); i++) {
+        journal.append(UndoStack.at(i).weights());
+    }
+
+    session.setEditor("cartoon");
+    session.setSourceFile(SourceFile);
+    session.setParameter("radius",    GaussianRadius);
+    session.setParameter("threshold", CartoonThreshold);
+    session.setParameter("smoothing", CartoonSmoothing);
+    session.setImage("mask",     CurrentMask.weights());
+    session.setImage("original", TiledImage(OriginalImage));
+    session.setImage("effected", TiledImage(EffectedImage));
+    session.setJournal(journal);
+
+    return session;
+}
+
+bool CartoonEditor::ResumeSession(const QString &image_file)
+{
+    TRACE_SCOPE("CartoonEditor::ResumeSession");
+
+    EditSession session;
+
+    if (session.load(EditSession::FileFor(image_file)) && session.editor() == "cartoon" && session.sourceUnchanged() &&
+        session.parameter("radius") == GaussianRadius && session.parameter("threshold") == CartoonThreshold &&
+        session.parameter("smoothing") == CartoonSmoothing &&
+        session.image("original").size() == session.image("mask").size() &&
+        session.image("effected").size() == session.image("mask").size() && !session.image("mask").isNull()) {
+        QList<TiledImage> journal = session.journal();
+
+        SourceFile    = image_file;
+        OriginalImage = session.image("original").toImage();
+        EffectedImage = session.image("effected").toImage();
+        CurrentMask   = EffectMask(session.image("mask"));
+
+        UndoStack.clear();
+
+        for (int i = 0; i < journal.size(); i++) {
+            UndoStack.push(EffectMask(journal.at(i)));
+        }
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
+
+        IsChanged = true;
+
+        Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+        setImplicitWidth(OriginalImage.width());
+        setImplicitHeight(OriginalImage.height());
+
+        update();
+
+        emit undoAvailabilityChanged(!UndoStack.isEmpty());
+        emit imageOpened();
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void CartoonEditor::SaveSession()
+{
+    if (IsChanged) {
+        Autosaver->finish();
+    } else {
+        Autosaver->stop();
+
+        if (!SourceFile.isEmpty() && !CurrentMask.isNull()) {
+            EditSession::Remove(SourceFile);
+        }
+    }
+}
+
 void CartoonEditor::SaveUndoImage()
 {
-    UndoStack.push(CurrentImage);
+    UndoStack.push(CurrentMask);
 
     if (UndoStack.size() > UNDO_DEPTH) {
         for (int i = 0; i < UndoStack.size() - UNDO_DEPTH; i++) {
@@ -252,6 +403,8 @@ void CartoonEditor::SaveUndoImage()
 
 void CartoonEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 {
+    TRACE_SCOPE("CartoonEditor::ChangeImageAt");
+
     if (CurrentMode != ModeScroll) {
         if (save_undo) {
             SaveUndoImage();
@@ -259,35 +412,31 @@ void CartoonEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 
         qreal scale = 1.0;
 
-        if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-            scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                    width() / CurrentImage.width() : height() / CurrentImage.height();
+        if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+            scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                    width() / OriginalImage.width() : height() / OriginalImage.height();
         }
 
         int img_center_x = center_x   / scale;
         int img_center_y = center_y   / scale;
-        int radius       = BRUSH_SIZE / scale;
-
-        for (int x = img_center_x - radius; x <= img_center_x + radius; x++) {
-            for (int y = img_center_y - radius; y <= img_center_y + radius; y++) {
-                if (x >= 0 && x < CurrentImage.width() && y >= 0 && y < CurrentImage.height() && qSqrt(qPow(x - img_center_x, 2) + qPow(y - img_center_y, 2)) <= radius) {
-                    if (CurrentMode == ModeOriginal) {
-                        CurrentImage.setPixel(x, y, OriginalImage.pixel(x, y));
-                    } else {
-                        CurrentImage.setPixel(x, y, EffectedImage.pixel(x, y));
-                    }
-                }
-            }
-        }
+        int radius       = BrushSize  / scale;
+
+        CurrentMask.stamp(BrushMask::Cached(radius, BrushHardness), QPoint(img_center_x, img_center_y), CurrentMode == ModeOriginal ? 0 : BrushMask::MAX_WEIGHT);
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         IsChanged = true;
 
-        update(center_x - BRUSH_SIZE, center_y - BRUSH_SIZE, BRUSH_SIZE * 2, BRUSH_SIZE * 2);
+        Autosaver->update("mask", CurrentMask.weights());
 
-        QImage helper_image = CurrentImage.copy(img_center_x - (HelperSize / scale) / 2,
-                                                img_center_y - (HelperSize / scale) / 2,
-                                                HelperSize / scale,
-                                                HelperSize / scale).scaledToWidth(HelperSize);
+        Repainter->update(QRectF(center_x - BrushSize, center_y - BrushSize, BrushSize * 2, BrushSize * 2));
+
+        QRect helper_rect(img_center_x - (HelperSize / scale) / 2,
+                          img_center_y - (HelperSize / scale) / 2,
+                          HelperSize / scale,
+                          HelperSize / scale);
+
+        QImage helper_image = CurrentMask.composite(OriginalImage, EffectedImage, helper_rect).scaledToWidth(HelperSize);
 
         emit helperImageReady(helper_image);
     }
@@ -299,12 +448,19 @@ CartoonPreviewGenerator::CartoonPreviewGenerator(QDeclarativeItem *parent) : QDe
     RestartCartoonGenerator = false;
     GaussianRadius          = 0;
     CartoonThreshold        = 0;
+    CartoonSmoothing        = CartoonEditor::SmoothingGaussian;
+
+    Source = new PreviewSource(this, IMAGE_MPIX_LIMIT, this);
+
+    QObject::connect(Source, SIGNAL(retargeted()),     this, SLOT(reloadImage()));
+    QObject::connect(Source, SIGNAL(generationDue()), this, SLOT(generate()));
 
     setFlag(QGraphicsItem::ItemHasNoContents, false);
 }
 
 CartoonPreviewGenerator::~CartoonPreviewGenerator()
 {
+    EffectScheduler::Instance()->cancel(this);
 }
 
 int CartoonPreviewGenerator::radius() const
@@ -317,11 +473,7 @@ void CartoonPreviewGenerator::setRadius(const int &radius)
     GaussianRadius = radius;
 
     if (!LoadedImage.isNull()) {
-        if (CartoonGeneratorRunning) {
-            RestartCartoonGenerator = true;
-        } else {
-            StartCartoonGenerator();
-        }
+        Source->requestGeneration();
     }
 }
 
@@ -335,55 +487,34 @@ void CartoonPreviewGenerator::setThreshold(const int &threshold)
     CartoonThreshold = threshold;
 
     if (!LoadedImage.isNull()) {
-        if (CartoonGeneratorRunning) {
-            RestartCartoonGenerator = true;
-        } else {
-            StartCartoonGenerator();
-        }
+        Source->requestGeneration();
     }
 }
 
-void CartoonPreviewGenerator::openImage(const QString &image_url)
+int CartoonPreviewGenerator::smoothing() const
 {
-    QString image_file = QUrl(image_url).toLocalFile();
-
-    if (!image_file.isNull()) {
-        QImageReader reader(image_file);
-
-        if (reader.canRead()) {
-            QSize size = reader.size();
-
-            if (size.width() * size.height() > IMAGE_MPIX_LIMIT * 1000000.0) {
-                qreal factor = qSqrt((size.width() * size.height()) / (IMAGE_MPIX_LIMIT * 1000000.0));
+    return CartoonSmoothing;
+}
 
-                size.setWidth(size.width()   / factor);
-                size.setHeight(size.height() / factor);
+void CartoonPreviewGenerator::setSmoothing(const int &smoothing)
+{
+    CartoonSmoothing = smoothing;
 
-                reader.setScaledSize(size);
-            }
+    if (!LoadedImage.isNull()) {
+        Source->requestGeneration();
+    }
+}
 
-            LoadedImage = reader.read();
+void CartoonPreviewGenerator::openImage(const QString &image_url)
+{
+    TRACE_SCOPE("CartoonPreviewGenerator::openImage");
 
-            if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+    LoadedImage = Source->load(QUrl(image_url).toLocalFile());
 
-                if (!LoadedImage.isNull()) {
-                    emit imageOpened();
+    if (!LoadedImage.isNull()) {
+        emit imageOpened();
 
-                    if (CartoonGeneratorRunning) {
-                        RestartCartoonGenerator = true;
-                    } else {
-                        StartCartoonGenerator();
-                    }
-                } else {
-                    emit imageOpenFailed();
-                }
-            } else {
-                emit imageOpenFailed();
-            }
-        } else {
-            emit imageOpenFailed();
-        }
+        Source->requestGeneration();
     } else {
         emit imageOpenFailed();
     }
@@ -391,6 +522,8 @@ void CartoonPreviewGenerator::openImage(const QString &image_url)
 
 void CartoonPreviewGenerator::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
+    TRACE_SCOPE("CartoonPreviewGenerator::paint");
+
     qreal scale = 1.0;
 
     if (CartoonImage.width() != 0 && CartoonImage.height() != 0) {
@@ -419,6 +552,10 @@ void CartoonPreviewGenerator::paint(QPainter *painter, const QStyleOptionGraphic
 
 void CartoonPreviewGenerator::cartoonImageReady(const QImage &cartoon_image)
 {
+    Tracer::AsyncEnd("imageReady delivery", sender());
+
+    TRACE_SCOPE("CartoonPreviewGenerator::cartoonImageReady");
+
     CartoonGeneratorRunning = false;
     CartoonImage            = cartoon_image;
 
@@ -436,24 +573,50 @@ void CartoonPreviewGenerator::cartoonImageReady(const QImage &cartoon_image)
     }
 }
 
+void CartoonPreviewGenerator::reloadImage()
+{
+    TRACE_SCOPE("CartoonPreviewGenerator::reloadImage");
+
+    QImage image = Source->reload();
+
+    if (!image.isNull()) {
+        LoadedImage = image;
+
+        Source->requestGeneration();
+    }
+}
+
+void CartoonPreviewGenerator::generate()
+{
+    if (CartoonGeneratorRunning) {
+        RestartCartoonGenerator = true;
+    } else {
+        StartCartoonGenerator();
+    }
+}
+
+void CartoonPreviewGenerator::geometryChanged(const QRectF &new_geometry, const QRectF &old_geometry)
+{
+    QDeclarativeItem::geometryChanged(new_geometry, old_geometry);
+
+    if (new_geometry.size() != old_geometry.size()) {
+        Source->itemResized();
+    }
+}
+
 void CartoonPreviewGenerator::StartCartoonGenerator()
 {
-    QThread               *thread    = new QThread();
     CartoonImageGenerator *generator = new CartoonImageGenerator();
 
-    generator->moveToThread(thread);
-
-    QObject::connect(thread,    SIGNAL(started()),                  generator, SLOT(start()));
-    QObject::connect(thread,    SIGNAL(finished()),                 thread,    SLOT(deleteLater()));
     QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this,      SLOT(cartoonImageReady(const QImage &)));
-    QObject::connect(generator, SIGNAL(finished()),                 thread,    SLOT(quit()));
     QObject::connect(generator, SIGNAL(finished()),                 generator, SLOT(deleteLater()));
 
     generator->setGaussianRadius(GaussianRadius);
     generator->setCartoonThreshold(CartoonThreshold);
+    generator->setCartoonSmoothing(CartoonSmoothing);
     generator->setInput(LoadedImage);
 
-    thread->start(QThread::LowPriority);
+    EffectScheduler::Instance()->schedule(generator, EffectScheduler::PriorityInteractive, this);
 
     CartoonGeneratorRunning = true;
 
@@ -464,6 +627,7 @@ CartoonImageGenerator::CartoonImageGenerator(QObject *parent) : QObject(parent)
 {
     GaussianRadius   = 0;
     CartoonThreshold = 0;
+    CartoonSmoothing = ImageKernels::SmoothingGaussian;
 }
 
 CartoonImageGenerator::~CartoonImageGenerator()
@@ -480,6 +644,11 @@ void CartoonImageGenerator::setCartoonThreshold(const int &threshold)
     CartoonThreshold = threshold;
 }
 
+void CartoonImageGenerator::setCartoonSmoothing(const int &smoothing)
+{
+    CartoonSmoothing = smoothing;
+}
+
 void CartoonImageGenerator::setInput(const QImage &input_image)
 {
     InputImage = input_image;
@@ -487,237 +656,13 @@ void CartoonImageGenerator::setInput(const QImage &input_image)
 
 void CartoonImageGenerator::start()
 {
-    QImage blur_image    = InputImage;
-    QImage cartoon_image = InputImage;
+    TRACE_SCOPE("CartoonImageGenerator::start");
 
-    // Make Gaussian blur of original image, if applicable
-
-    if (GaussianRadius != 0) {
-        QImage::Format format = blur_image.format();
-
-        blur_image = blur_image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-
-        int tab[] = { 14, 10, 8, 6, 5, 5, 4, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2 };
-        int alpha = (GaussianRadius < 1) ? 16 : (GaussianRadius > 17) ? 1 : tab[GaussianRadius - 1];
-
-        int r1 = blur_image.rect().top();
-        int r2 = blur_image.rect().bottom();
-        int c1 = blur_image.rect().left();
-        int c2 = blur_image.rect().right();
-
-        int bpl = blur_image.bytesPerLine();
-
-        int           rgba[4];
-        unsigned char *p;
-
-        for (int col = c1; col <= c2; col++) {
-            p = blur_image.scanLine(r1) + col * 4;
-
-            for (int i = 0; i < 4; i++) {
-                rgba[i] = p[i] << 4;
-            }
-
-            p += bpl;
-
-            for (int j = r1; j < r2; j++, p += bpl) {
-                for (int i = 0; i < 4; i++) {
-                    p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-                }
-            }
-        }
-
-        for (int row = r1; row <= r2; row++) {
-            p = blur_image.scanLine(row) + c1 * 4;
-
-            for (int i = 0; i < 4; i++) {
-                rgba[i] = p[i] << 4;
-            }
-
-            p += 4;
-
-            for (int j = c1; j < c2; j++, p += 4) {
-                for (int i = 0; i < 4; i++) {
-                    p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-                }
-            }
-        }
-
-        for (int col = c1; col <= c2; col++) {
-            p = blur_image.scanLine(r2) + col * 4;
-
-            for (int i = 0; i < 4; i++) {
-                rgba[i] = p[i] << 4;
-            }
-
-            p -= bpl;
-
-            for (int j = r1; j < r2; j++, p -= bpl) {
-                for (int i = 0; i < 4; i++) {
-                    p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-                }
-            }
-        }
+    QImage cartoon_image = ImageKernels::ToRGB16(InputImage);
 
-        for (int row = r1; row <= r2; row++) {
-            p = blur_image.scanLine(row) + c2 * 4;
+    ImageKernels::Cartoon(cartoon_image, GaussianRadius, CartoonThreshold, CartoonSmoothing);
 
-            for (int i = 0; i < 4; i++) {
-                rgba[i] = p[i] << 4;
-            }
-
-            p -= 4;
-
-            for (int j = c1; j < c2; j++, p -= 4) {
-                for (int i = 0; i < 4; i++) {
-                    p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-                }
-            }
-        }
-
-        blur_image = blur_image.convertToFormat(format);
-    }
-
-    // Apply Cartoon filter
-
-    QVector<int> src_buf(blur_image.width() * blur_image.height() * 4, 0);
-    QVector<int> dst_buf(blur_image.width() * blur_image.height() * 4, 0);
-
-    for (int y = 0; y < blur_image.height(); y++) {
-        for (int x = 0; x < blur_image.width(); x++) {
-            QRgb color = blur_image.pixel(x, y);
-
-            src_buf[(y * blur_image.width() + x) * 4]     = qBlue(color);
-            src_buf[(y * blur_image.width() + x) * 4 + 1] = qGreen(color);
-            src_buf[(y * blur_image.width() + x) * 4 + 2] = qRed(color);
-            src_buf[(y * blur_image.width() + x) * 4 + 3] = qAlpha(color);
-        }
-    }
-
-    int  offset;
-    int  blue_g, green_g, red_g;
-    int  blue, green, red;
-    bool exceeds_threshold;
-
-    for (int y = 1; y < blur_image.height() - 1; y++)
-    {
-        for (int x = 1; x < blur_image.width() - 1; x++)
-        {
-            offset = y * blur_image.width() * 4 + x * 4;
-
-            blue_g  = abs(src_buf[offset - 4]                      - src_buf[offset + 4]);
-            blue_g += abs(src_buf[offset - blur_image.width() * 4] - src_buf[offset + blur_image.width() * 4]);
-
-            offset++;
-
-            green_g  = abs(src_buf[offset - 4]                      - src_buf[offset + 4]);
-            green_g += abs(src_buf[offset - blur_image.width() * 4] - src_buf[offset + blur_image.width() * 4]);
-
-            offset++;
-
-            red_g  = abs(src_buf[offset - 4]                      - src_buf[offset + 4]);
-            red_g += abs(src_buf[offset - blur_image.width() * 4] - src_buf[offset + blur_image.width() * 4]);
-
-            if (blue_g + green_g + red_g > CartoonThreshold)
-            {
-                exceeds_threshold = true;
-            }
-            else
-            {
-                offset -= 2;
-
-                blue_g = abs(src_buf[offset - 4] - src_buf[offset + 4]);
-
-                offset++;
-
-                green_g = abs(src_buf[offset - 4] - src_buf[offset + 4]);
-
-                offset++;
-
-                red_g = abs(src_buf[offset - 4] - src_buf[offset + 4]);
-
-                if (blue_g + green_g + red_g > CartoonThreshold)
-                {
-                    exceeds_threshold = true;
-                }
-                else
-                {
-                    offset -= 2;
-
-                    blue_g = abs(src_buf[offset - blur_image.width() * 4] - src_buf[offset + blur_image.width() * 4]);
-
-                    offset++;
-
-                    green_g = abs(src_buf[offset - blur_image.width() * 4] - src_buf[offset + blur_image.width() * 4]);
-
-                    offset++;
-
-                    red_g = abs(src_buf[offset - blur_image.width() * 4] - src_buf[offset + blur_image.width() * 4]);
-
-                    if (blue_g + green_g + red_g > CartoonThreshold)
-                    {
-                        exceeds_threshold = true;
-                    }
-                    else
-                    {
-                        offset -= 2;
-
-                        blue_g  = abs(src_buf[offset - 4 - blur_image.width() * 4] - src_buf[offset + 4 + blur_image.width() * 4]);
-                        blue_g += abs(src_buf[offset + 4 - blur_image.width() * 4] - src_buf[offset - 4 + blur_image.width() * 4]);
-
-                        offset++;
-
-                        green_g  = abs(src_buf[offset - 4 - blur_image.width() * 4] - src_buf[offset + 4 + blur_image.width() * 4]);
-                        green_g += abs(src_buf[offset + 4 - blur_image.width() * 4] - src_buf[offset - 4 + blur_image.width() * 4]);
-
-                        offset++;
-
-                        red_g  = abs(src_buf[offset - 4 - blur_image.width() * 4] - src_buf[offset + 4 + blur_image.width() * 4]);
-                        red_g += abs(src_buf[offset + 4 - blur_image.width() * 4] - src_buf[offset - 4 + blur_image.width() * 4]);
-
-                        if (blue_g + green_g + red_g > CartoonThreshold)
-                        {
-                            exceeds_threshold = true;
-                        }
-                        else
-                        {
-                            exceeds_threshold = false;
-                        }
-                    }
-                }
-            }
-
-            offset -= 2;
-
-            if (exceeds_threshold)
-            {
-                blue  = 0;
-                green = 0;
-                red   = 0;
-            }
-            else
-            {
-                blue  = src_buf[offset];
-                green = src_buf[offset + 1];
-                red   = src_buf[offset + 2];
-            }
-
-            blue  = (blue  > 255 ? 255 : (blue  < 0 ? 0 : blue));
-            green = (green > 255 ? 255 : (green < 0 ? 0 : green));
-            red   = (red   > 255 ? 255 : (red   < 0 ? 0 : red));
-
-            dst_buf[offset]     = blue;
-            dst_buf[offset + 1] = green;
-            dst_buf[offset + 2] = red;
-            dst_buf[offset + 3] = src_buf[offset + 3];
-        }
-    }
-
-    for (int y = 0; y < cartoon_image.height(); y++) {
-        for (int x = 0; x < cartoon_image.width(); x++) {
-            cartoon_image.setPixel(x, y, qRgba(dst_buf[(y * cartoon_image.width() + x) * 4 + 2], dst_buf[(y * cartoon_image.width() + x) * 4 + 1],
-                                               dst_buf[(y * cartoon_image.width() + x) * 4],     dst_buf[(y * cartoon_image.width() + x) * 4 + 3]));
-        }
-    }
+    Tracer::AsyncBegin("imageReady delivery", this);
 
     emit imageReady(cartoon_image);
     emit finished();
@@ -9,18 +9,31 @@
 #include <QStyleOptionGraphicsItem>
 #include <QDeclarativeItem>
 
+#include "repaintcoalescer.h"
+#include "tilepyramid.h"
+#include "brushmask.h"
+#include "effectmask.h"
+#include "editsession.h"
+#include "autosavewriter.h"
+#include "previewsource.h"
+#include "imagekernels.h"
+
 class CartoonEditor : public QDeclarativeItem
 {
     Q_OBJECT
 
-    Q_PROPERTY(int  mode       READ mode       WRITE setMode)
-    Q_PROPERTY(int  helperSize READ helperSize WRITE setHelperSize)
-    Q_PROPERTY(int  radius     READ radius     WRITE setRadius)
-    Q_PROPERTY(int  threshold  READ threshold  WRITE setThreshold)
-    Q_PROPERTY(bool changed    READ changed)
+    Q_PROPERTY(int   mode          READ mode          WRITE setMode)
+    Q_PROPERTY(int   helperSize    READ helperSize    WRITE setHelperSize)
+    Q_PROPERTY(int   brushSize     READ brushSize     WRITE setBrushSize)
+    Q_PROPERTY(qreal brushHardness READ brushHardness WRITE setBrushHardness)
+    Q_PROPERTY(int   radius        READ radius        WRITE setRadius)
+    Q_PROPERTY(int   threshold     READ threshold     WRITE setThreshold)
+    Q_PROPERTY(int   smoothing     READ smoothing     WRITE setSmoothing)
+    Q_PROPERTY(bool  changed       READ changed)
 
     Q_ENUMS(Mode)
     Q_ENUMS(MouseState)
+    Q_ENUMS(Smoothing)
 
 public:
     explicit CartoonEditor(QDeclarativeItem *parent = 0);
@@ -32,18 +45,28 @@ public:
     int  helperSize() const;
     void setHelperSize(const int &size);
 
+    int  brushSize() const;
+    void setBrushSize(const int &size);
+
+    qreal brushHardness() const;
+    void  setBrushHardness(const qreal &hardness);
+
     int  radius() const;
     void setRadius(const int &radius);
 
     int  threshold() const;
     void setThreshold(const int &threshold);
 
+    int  smoothing() const;
+    void setSmoothing(const int &smoothing);
+
     bool changed() const;
 
     Q_INVOKABLE void openImage(const QString &image_url);
     Q_INVOKABLE void saveImage(const QString &image_url);
 
     Q_INVOKABLE void undo();
+    Q_INVOKABLE void discard();
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*);
 
@@ -59,6 +82,11 @@ public:
         MouseReleased
     };
 
+    enum Smoothing {
+        SmoothingGaussian  = ImageKernels::SmoothingGaussian,
+        SmoothingBilateral = ImageKernels::SmoothingBilateral
+    };
+
 public slots:
     void effectedImageReady(const QImage &effected_image);
 
@@ -81,18 +109,29 @@ protected:
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
 
 private:
+    EditSession MakeSession() const;
+
+    bool ResumeSession(const QString &image_file);
+    void SaveSession();
     void SaveUndoImage();
     void ChangeImageAt(bool save_undo, int center_x, int center_y);
 
-    static const int UNDO_DEPTH  = 4,
-                     BRUSH_SIZE  = 16;
-
-    static const qreal IMAGE_MPIX_LIMIT = 1.0;
-
-    bool           IsChanged;
-    int            CurrentMode, HelperSize, GaussianRadius, CartoonThreshold;
-    QImage         LoadedImage, OriginalImage, EffectedImage, CurrentImage;
-    QStack<QImage> UndoStack;
+    static const int UNDO_DEPTH         = 4,
+                     DEFAULT_BRUSH_SIZE = 16;
+
+    static const qreal IMAGE_MPIX_LIMIT       = 1.0,
+                       DEFAULT_BRUSH_HARDNESS = 1.0;
+
+    bool               IsChanged;
+    int                CurrentMode, HelperSize, BrushSize, GaussianRadius, CartoonThreshold, CartoonSmoothing;
+    qreal              BrushHardness;
+    QString            SourceFile;
+    QImage             LoadedImage, OriginalImage, EffectedImage;
+    EffectMask         CurrentMask;
+    QStack<EffectMask> UndoStack;
+    TilePyramid        DisplayPyramid;
+    RepaintCoalescer   *Repainter;
+    AutosaveWriter     *Autosaver;
 };
 
 class CartoonPreviewGenerator : public QDeclarativeItem
@@ -101,6 +140,7 @@ class CartoonPreviewGenerator : public QDeclarativeItem
 
     Q_PROPERTY(int radius    READ radius    WRITE setRadius)
     Q_PROPERTY(int threshold READ threshold WRITE setThreshold)
+    Q_PROPERTY(int smoothing READ smoothing WRITE setSmoothing)
 
 public:
     explicit CartoonPreviewGenerator(QDeclarativeItem *parent = 0);
@@ -112,12 +152,17 @@ public:
     int  threshold() const;
     void setThreshold(const int &threshold);
 
+    int  smoothing() const;
+    void setSmoothing(const int &smoothing);
+
     Q_INVOKABLE void openImage(const QString &image_url);
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*);
 
 public slots:
     void cartoonImageReady(const QImage &cartoon_image);
+    void reloadImage();
+    void generate();
 
 signals:
     void imageOpened();
@@ -126,14 +171,18 @@ signals:
     void generationStarted();
     void generationFinished();
 
+protected:
+    virtual void geometryChanged(const QRectF &new_geometry, const QRectF &old_geometry);
+
 private:
     void StartCartoonGenerator();
 
     static const qreal IMAGE_MPIX_LIMIT = 0.2;
 
-    bool   CartoonGeneratorRunning, RestartCartoonGenerator;
-    int    GaussianRadius, CartoonThreshold;
-    QImage LoadedImage, CartoonImage;
+    bool           CartoonGeneratorRunning, RestartCartoonGenerator;
+    int            GaussianRadius, CartoonThreshold, CartoonSmoothing;
+    QImage         LoadedImage, CartoonImage;
+    PreviewSource *Source;
 };
 
 class CartoonImageGenerator : public QObject
@@ -146,6 +195,7 @@ public:
 
     void setGaussianRadius(const int &radius);
     void setCartoonThreshold(const int &threshold);
+    void setCartoonSmoothing(const int &smoothing);
     void setInput(const QImage &input_image);
 
 public slots:
@@ -156,7 +206,7 @@ signals:
     void finished();
 
 private:
-    int    GaussianRadius, CartoonThreshold;
+    int    GaussianRadius, CartoonThreshold, CartoonSmoothing;
     QImage InputImage;
 };
 
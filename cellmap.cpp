@@ -0,0 +1,187 @@
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <qmath.h>
+
+#include "cellmap.h"
+#include "tracer.h"
+
+CellMap::CellMap()
+{
+    CellShape = ShapeSquare;
+    CellSize  = 0;
+    CellCount = 0;
+}
+
+CellMap::CellMap(int shape, int cell_size, const QRect &area)
+{
+    TRACE_SCOPE("CellMap::CellMap");
+
+    CellShape = shape;
+    CellSize  = cell_size;
+    CellCount = 0;
+
+    if (cell_size <= 0 || area.isEmpty()) {
+        return;
+    }
+
+    Area = area;
+
+    // Cells are numbered row by row over the grid positions the area touches
+
+    int  min_column = 0, max_column = 0, min_row = 0, max_row = 0;
+    bool first      = true;
+
+    for (int y = area.top(); y <= area.bottom(); y++) {
+        for (int x = area.left(); x <= area.right(); x++) {
+            int  column, row;
+            bool inside;
+
+            CellOf(shape, cell_size, x, y, &column, &row, &inside);
+
+            if (first) {
+                min_column = max_column = column;
+                min_row    = max_row    = row;
+                first      = false;
+            } else {
+                min_column = qMin(min_column, column);
+                max_column = qMax(max_column, column);
+                min_row    = qMin(min_row,    row);
+                max_row    = qMax(max_row,    row);
+            }
+        }
+    }
+
+    int columns = max_column - min_column + 1;
+
+    CellCount = columns * (max_row - min_row + 1);
+    Indices.resize(area.width() * area.height());
+
+    qint32 *index = Indices.data();
+
+    for (int y = area.top(); y <= area.bottom(); y++) {
+        for (int x = area.left(); x <= area.right(); x++, index++) {
+            int  column, row;
+            bool inside;
+
+            CellOf(shape, cell_size, x, y, &column, &row, &inside);
+
+            int cell = (row - min_row) * columns + (column - min_column);
+
+            *index = inside ? cell : -(cell + 1);
+        }
+    }
+}
+
+bool CellMap::isNull() const
+{
+    return CellCount == 0;
+}
+
+QRect CellMap::area() const
+{
+    return Area;
+}
+
+int CellMap::cellCount() const
+{
+    return CellCount;
+}
+
+CellMap CellMap::Cached(int shape, int cell_size, const QRect &area)
+{
+    // Generators run in threads of their own, so this cache is locked
+
+    static QMutex         mutex;
+    static QList<CellMap> cache;
+
+    QMutexLocker locker(&mutex);
+
+    for (int i = 0; i < cache.size(); i++) {
+        const CellMap &cached = cache.at(i);
+
+        if (cached.CellShape == shape && cached.CellSize == cell_size && cached.Area == area) {
+            return cached;
+        }
+    }
+
+    if (cache.size() >= MAX_CACHED_MAPS) {
+        cache.clear();
+    }
+
+    CellMap map(shape, cell_size, area);
+
+    cache.append(map);
+
+    return map;
+}
+
+int CellMap::Reach(int shape, int cell_size)
+{
+    // Hexagons are 2 / sqrt(3) of the cell size tall
+
+    return shape == ShapeHexagon ? qCeil(cell_size * 2 / qSqrt(3.0)) : cell_size;
+}
+
+void CellMap::CellOf(int shape, int cell_size, int x, int y, int *column, int *row, bool *inside)
+{
+    qreal px = x + 0.5,
+          py = y + 0.5;
+
+    *inside = true;
+
+    if (shape == ShapeHexagon) {
+        // Pointy-top hexagons through cube coordinates, odd rows shifted right
+
+        qreal size = cell_size / qSqrt(3.0);
+        qreal q    = (qSqrt(3.0) / 3.0 * px - py / 3.0) / size;
+        qreal r    = (2.0 / 3.0 * py) / size;
+        qreal s    = -q - r;
+
+        int round_q = qRound(q),
+            round_r = qRound(r),
+            round_s = qRound(s);
+
+        qreal diff_q = qAbs(round_q - q),
+              diff_r = qAbs(round_r - r),
+              diff_s = qAbs(round_s - s);
+
+        if (diff_q > diff_r && diff_q > diff_s) {
+            round_q = -round_r - round_s;
+        } else if (diff_r > diff_s) {
+            round_r = -round_q - round_s;
+        }
+
+        *column = round_q + (round_r - (round_r & 1)) / 2;
+        *row    = round_r;
+    } else if (shape == ShapeTriangle) {
+        // Rows of triangles pointing up and down in turn
+
+        qreal height = cell_size * qSqrt(3.0) / 2.0;
+        qreal ty     = py / height;
+        qreal tx     = px / (cell_size / 2.0);
+
+        int half_column = qFloor(tx);
+
+        *row = qFloor(ty);
+
+        qreal fx = tx - half_column,
+              fy = ty - *row;
+
+        if ((half_column + *row) % 2 == 0) {
+            *column = fx + fy > 1.0 ? half_column : half_column - 1;
+        } else {
+            *column = fx > fy ? half_column : half_column - 1;
+        }
+    } else {
+        *column = x / cell_size;
+        *row    = y / cell_size;
+
+        if (shape == ShapeCircle) {
+            qreal dx = px - (*column + 0.5) * cell_size,
+                  dy = py - (*row    + 0.5) * cell_size;
+
+            *inside = dx * dx + dy * dy <= cell_size * cell_size / 4.0;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef CELLMAP_H
+#define CELLMAP_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QRect>
+
+// Assignment of every pixel of an image area to a pixelation cell, on a grid
+// anchored at the image origin so a crop matches the whole image. A negative
+// index -(cell + 1) marks a background pixel, as between circle dots.
+
+class CellMap
+{
+public:
+    CellMap();
+    CellMap(int shape, int cell_size, const QRect &area);
+
+    enum Shape {
+        ShapeSquare,
+        ShapeHexagon,
+        ShapeCircle,
+        ShapeTriangle
+    };
+
+    bool  isNull() const;
+    QRect area() const;
+    int   cellCount() const;
+
+    inline const qint32 *indices(int y) const
+    {
+        return Indices.constData() + y * Area.width();
+    }
+
+    // Shared per shape, cell size and area, across threads as well
+    static CellMap Cached(int shape, int cell_size, const QRect &area);
+
+    // Farthest a pixel of a cell can lie from any other pixel of it
+    static int Reach(int shape, int cell_size);
+
+private:
+    static void CellOf(int shape, int cell_size, int x, int y, int *column, int *row, bool *inside);
+
+    static const int MAX_CACHED_MAPS = 4;
+
+    int             CellShape, CellSize, CellCount;
+    QRect           Area;
+    QVector<qint32> Indices;
+};
+
+#endif // CELLMAP_H
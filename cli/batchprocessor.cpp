@@ -0,0 +1,516 @@
+#include <qmath.h>
+#include <QDir>
+#include <QSet>
+#include <QFileInfo>
+#include <QThread>
+#include <QMetaObject>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QImageReader>
+#include <QTextStream>
+
+#include "batchprocessor.h"
+#include "imagekernels.h"
+#include "editstack.h"
+#include "decolorizeeditor.h"
+#include "sketcheditor.h"
+#include "cartooneditor.h"
+#include "blureditor.h"
+#include "pixelateeditor.h"
+
+BatchProcessor::BatchProcessor(QObject *parent) : QObject(parent)
+{
+    CurrentEffect    = EffectGrayscale;
+    EffectChain      = QList<int>() << EffectGrayscale;
+    GaussianRadius   = 11;
+    SketchStyle      = ImageKernels::StyleDodge;
+    CartoonThreshold = 80;
+    CartoonSmoothing = ImageKernels::SmoothingGaussian;
+    PixelDenom       = 112;
+    PixelShape       = CellMap::ShapeSquare;
+    JobsCount        = QThread::idealThreadCount();
+    MPixLimit        = 0.0;
+    OutputFormat     = "jpg";
+    ProcessedCount   = 0;
+    FailedCount      = 0;
+    DecodeTime       = 0;
+    EffectTime       = 0;
+    EncodeTime       = 0;
+}
+
+BatchProcessor::~BatchProcessor()
+{
+}
+
+int BatchProcessor::effect() const
+{
+    return CurrentEffect;
+}
+
+void BatchProcessor::setEffect(const int &effect)
+{
+    CurrentEffect = effect;
+    EffectChain   = QList<int>() << effect;
+}
+
+QList<int> BatchProcessor::effectChain() const
+{
+    return EffectChain;
+}
+
+void BatchProcessor::setEffectChain(const QList<int> &chain)
+{
+    CurrentEffect = chain.isEmpty() ? -1 : chain.first();
+    EffectChain   = chain;
+}
+
+int BatchProcessor::radius() const
+{
+    return GaussianRadius;
+}
+
+void BatchProcessor::setRadius(const int &radius)
+{
+    GaussianRadius = radius;
+}
+
+int BatchProcessor::sketchStyle() const
+{
+    return SketchStyle;
+}
+
+void BatchProcessor::setSketchStyle(const int &style)
+{
+    SketchStyle = style;
+}
+
+int BatchProcessor::threshold() const
+{
+    return CartoonThreshold;
+}
+
+void BatchProcessor::setThreshold(const int &threshold)
+{
+    CartoonThreshold = threshold;
+}
+
+int BatchProcessor::smoothing() const
+{
+    return CartoonSmoothing;
+}
+
+void BatchProcessor::setSmoothing(const int &smoothing)
+{
+    CartoonSmoothing = smoothing;
+}
+
+int BatchProcessor::pixDenom() const
+{
+    return PixelDenom;
+}
+
+void BatchProcessor::setPixDenom(const int &pix_denom)
+{
+    PixelDenom = pix_denom;
+}
+
+int BatchProcessor::pixShape() const
+{
+    return PixelShape;
+}
+
+void BatchProcessor::setPixShape(const int &shape)
+{
+    PixelShape = shape;
+}
+
+int BatchProcessor::jobs() const
+{
+    return JobsCount;
+}
+
+void BatchProcessor::setJobs(const int &jobs)
+{
+    JobsCount = jobs;
+}
+
+qreal BatchProcessor::mpixLimit() const
+{
+    return MPixLimit;
+}
+
+void BatchProcessor::setMpixLimit(const qreal &limit)
+{
+    MPixLimit = limit;
+}
+
+QString BatchProcessor::outputDir() const
+{
+    return OutputDir;
+}
+
+void BatchProcessor::setOutputDir(const QString &dir)
+{
+    OutputDir = dir;
+}
+
+QString BatchProcessor::outputFormat() const
+{
+    return OutputFormat;
+}
+
+void BatchProcessor::setOutputFormat(const QString &format)
+{
+    OutputFormat = format;
+}
+
+int BatchProcessor::EffectFromName(const QString &name)
+{
+    if (name.compare("grayscale", Qt::CaseInsensitive) == 0) {
+        return EffectGrayscale;
+    } else if (name.compare("sketch", Qt::CaseInsensitive) == 0) {
+        return EffectSketch;
+    } else if (name.compare("cartoon", Qt::CaseInsensitive) == 0) {
+        return EffectCartoon;
+    } else if (name.compare("blur", Qt::CaseInsensitive) == 0) {
+        return EffectBlur;
+    } else if (name.compare("pixelate", Qt::CaseInsensitive) == 0) {
+        return EffectPixelate;
+    } else {
+        return -1;
+    }
+}
+
+int BatchProcessor::SmoothingFromName(const QString &name)
+{
+    if (name.compare("gaussian", Qt::CaseInsensitive) == 0) {
+        return ImageKernels::SmoothingGaussian;
+    } else if (name.compare("bilateral", Qt::CaseInsensitive) == 0) {
+        return ImageKernels::SmoothingBilateral;
+    } else {
+        return -1;
+    }
+}
+
+int BatchProcessor::ShapeFromName(const QString &name)
+{
+    if (name.compare("square", Qt::CaseInsensitive) == 0) {
+        return CellMap::ShapeSquare;
+    } else if (name.compare("hexagon", Qt::CaseInsensitive) == 0) {
+        return CellMap::ShapeHexagon;
+    } else if (name.compare("circle", Qt::CaseInsensitive) == 0) {
+        return CellMap::ShapeCircle;
+    } else if (name.compare("triangle", Qt::CaseInsensitive) == 0) {
+        return CellMap::ShapeTriangle;
+    } else {
+        return -1;
+    }
+}
+
+int BatchProcessor::StyleFromName(const QString &name)
+{
+    if (name.compare("dodge", Qt::CaseInsensitive) == 0) {
+        return ImageKernels::StyleDodge;
+    } else if (name.compare("sobel", Qt::CaseInsensitive) == 0) {
+        return ImageKernels::StyleSobel;
+    } else if (name.compare("dog", Qt::CaseInsensitive) == 0) {
+        return ImageKernels::StyleDoG;
+    } else {
+        return -1;
+    }
+}
+
+QImage BatchProcessor::LoadImage(const QString &file_name) const
+{
+    QImage       image;
+    QImageReader reader(file_name);
+
+    if (reader.canRead()) {
+        QSize size = reader.size();
+
+        if (MPixLimit > 0.0 && size.width() * size.height() > MPixLimit * 1000000.0) {
+            qreal factor = qSqrt((size.width() * size.height()) / (MPixLimit * 1000000.0));
+
+            size.setWidth(size.width()   / factor);
+            size.setHeight(size.height() / factor);
+
+            reader.setScaledSize(size);
+        }
+
+        image = reader.read();
+
+        if (!image.isNull()) {
+            image = ImageKernels::ToRGB16(image);
+        }
+    }
+
+    return image;
+}
+
+QImage BatchProcessor::ApplyEffect(const QImage &input_image) const
+{
+    if (EffectChain.size() > 1) {
+        // Effect values match EditStack's, Grayscale being its Decolorize
+
+        EditStack stack;
+
+        stack.setImage(input_image);
+
+        for (int i = 0; i < EffectChain.size(); i++) {
+            int stage = stack.addStage(EffectChain.at(i));
+
+            stack.setParameter(stage, EditStack::ParameterRadius,    GaussianRadius);
+            stack.setParameter(stage, EditStack::ParameterThreshold, CartoonThreshold);
+            stack.setParameter(stage, EditStack::ParameterPixDenom,  PixelDenom);
+            stack.setParameter(stage, EditStack::ParameterSmoothing, CartoonSmoothing);
+            stack.setParameter(stage, EditStack::ParameterShape,     PixelShape);
+            stack.setParameter(stage, EditStack::ParameterStyle,     SketchStyle);
+        }
+
+        return stack.render();
+    }
+
+    QObject *generator = 0;
+
+    if (CurrentEffect == EffectGrayscale) {
+        GrayscaleImageGenerator *grayscale_generator = new GrayscaleImageGenerator();
+
+        grayscale_generator->setInput(input_image);
+
+        generator = grayscale_generator;
+    } else if (CurrentEffect == EffectSketch) {
+        SketchImageGenerator *sketch_generator = new SketchImageGenerator();
+
+        sketch_generator->setGaussianRadius(GaussianRadius);
+        sketch_generator->setSketchStyle(SketchStyle);
+        sketch_generator->setInput(input_image);
+
+        generator = sketch_generator;
+    } else if (CurrentEffect == EffectCartoon) {
+        CartoonImageGenerator *cartoon_generator = new CartoonImageGenerator();
+
+        cartoon_generator->setGaussianRadius(GaussianRadius);
+        cartoon_generator->setCartoonThreshold(CartoonThreshold);
+        cartoon_generator->setCartoonSmoothing(CartoonSmoothing);
+        cartoon_generator->setInput(input_image);
+
+        generator = cartoon_generator;
+    } else if (CurrentEffect == EffectBlur) {
+        BlurImageGenerator *blur_generator = new BlurImageGenerator();
+
+        blur_generator->setGaussianRadius(GaussianRadius);
+        blur_generator->setInput(input_image);
+
+        generator = blur_generator;
+    } else if (CurrentEffect == EffectPixelate) {
+        PixelateImageGenerator *pixelate_generator = new PixelateImageGenerator();
+
+        pixelate_generator->setPixelDenom(PixelDenom);
+        pixelate_generator->setPixelShape(PixelShape);
+        pixelate_generator->setInput(input_image);
+
+        generator = pixelate_generator;
+    }
+
+    QImage output_image;
+
+    if (generator != 0) {
+        GeneratorRunner runner;
+
+        output_image = runner.run(generator);
+
+        delete generator;
+    }
+
+    return output_image;
+}
+
+bool BatchProcessor::run(const QStringList &inputs)
+{
+    QStringList files = ExpandInputs(inputs);
+    int         renamed;
+    QStringList output_files = OutputFiles(files, &renamed);
+
+    ProcessedCount = 0;
+    FailedCount    = 0;
+    DecodeTime     = 0;
+    EffectTime     = 0;
+    EncodeTime     = 0;
+
+    QThreadPool   pool;
+    QElapsedTimer timer;
+
+    int conversions = ImageKernels::ConversionCount();
+
+    pool.setMaxThreadCount(JobsCount > 0 ? JobsCount : 1);
+
+    timer.start();
+
+    for (int i = 0; i < files.size(); i++) {
+        pool.start(new BatchTask(this, files.at(i), output_files.at(i)));
+    }
+
+    pool.waitForDone();
+
+    qint64 elapsed = timer.elapsed();
+
+    QTextStream out(stdout);
+
+    out << "images:     " << ProcessedCount << " processed, " << FailedCount << " failed, " << renamed << " renamed" << endl;
+    out << "workers:    " << pool.maxThreadCount() << endl;
+    out << "wall time:  " << elapsed << " ms" << endl;
+    out << "throughput: " << (elapsed > 0 ? ProcessedCount * 1000.0 / elapsed : 0.0) << " images/s" << endl;
+    out << "stage time: decode " << DecodeTime << " ms, effect " << EffectTime << " ms, encode " << EncodeTime << " ms" << endl;
+    out << "convert:    " << ImageKernels::ConversionCount() - conversions << " format conversions" << endl;
+
+    return FailedCount == 0;
+}
+
+QStringList BatchProcessor::ExpandInputs(const QStringList &inputs) const
+{
+    QStringList name_filters;
+    QStringList files;
+
+    foreach (const QByteArray &format, QImageReader::supportedImageFormats()) {
+        name_filters.append(QString("*.%1").arg(QString::fromLatin1(format)));
+    }
+
+    for (int i = 0; i < inputs.size(); i++) {
+        QFileInfo input_info(inputs.at(i));
+
+        if (input_info.isDir()) {
+            QDir dir(input_info.filePath());
+
+            foreach (const QString &entry, dir.entryList(name_filters, QDir::Files | QDir::Readable, QDir::Name)) {
+                files.append(dir.filePath(entry));
+            }
+        } else {
+            files.append(input_info.filePath());
+        }
+    }
+
+    return files;
+}
+
+QStringList BatchProcessor::OutputFiles(const QStringList &files, int *renamed) const
+{
+    // Colliding output names get a numbered suffix, compared case-insensitively
+
+    QSet<QString> used_names;
+    QStringList   output_files;
+
+    *renamed = 0;
+
+    for (int i = 0; i < files.size(); i++) {
+        QString base_name   = QFileInfo(files.at(i)).completeBaseName();
+        QString output_name = base_name + "." + OutputFormat;
+
+        for (int suffix = 2; used_names.contains(output_name.toLower()); suffix++) {
+            output_name = QString("%1-%2.%3").arg(base_name).arg(suffix).arg(OutputFormat);
+        }
+
+        if (output_name != base_name + "." + OutputFormat) {
+            qWarning("%s: output name already used, writing %s", qPrintable(files.at(i)), qPrintable(output_name));
+
+            (*renamed)++;
+        }
+
+        used_names.insert(output_name.toLower());
+        output_files.append(QDir(OutputDir).filePath(output_name));
+    }
+
+    return output_files;
+}
+
+void BatchProcessor::TaskFinished(bool success, qint64 decode_time, qint64 effect_time, qint64 encode_time)
+{
+    QMutexLocker locker(&StatsMutex);
+
+    if (success) {
+        ProcessedCount++;
+    } else {
+        FailedCount++;
+    }
+
+    DecodeTime += decode_time;
+    EffectTime += effect_time;
+    EncodeTime += encode_time;
+}
+
+BatchTask::BatchTask(BatchProcessor *processor, const QString &input_file, const QString &output_file) : QRunnable()
+{
+    Processor  = processor;
+    InputFile  = input_file;
+    OutputFile = output_file;
+}
+
+BatchTask::~BatchTask()
+{
+}
+
+void BatchTask::run()
+{
+    QElapsedTimer timer;
+
+    timer.start();
+
+    QImage input_image = Processor->LoadImage(InputFile);
+
+    qint64 decode_time = timer.restart();
+
+    if (input_image.isNull()) {
+        qWarning("%s: could not read image", qPrintable(InputFile));
+
+        Processor->TaskFinished(false, decode_time, 0, 0);
+
+        return;
+    }
+
+    QImage output_image = Processor->ApplyEffect(input_image);
+
+    qint64 effect_time = timer.restart();
+
+    if (output_image.isNull()) {
+        qWarning("%s: effect failed", qPrintable(InputFile));
+
+        Processor->TaskFinished(false, decode_time, effect_time, 0);
+
+        return;
+    }
+
+    bool success = output_image.save(OutputFile);
+
+    qint64 encode_time = timer.elapsed();
+
+    if (!success) {
+        qWarning("%s: could not write image", qPrintable(OutputFile));
+    }
+
+    Processor->TaskFinished(success, decode_time, effect_time, encode_time);
+}
+
+GeneratorRunner::GeneratorRunner(QObject *parent) : QObject(parent)
+{
+}
+
+GeneratorRunner::~GeneratorRunner()
+{
+}
+
+QImage GeneratorRunner::run(QObject *generator)
+{
+    OutputImage = QImage();
+
+    QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this, SLOT(imageReady(const QImage &)), Qt::DirectConnection);
+
+    QMetaObject::invokeMethod(generator, "start", Qt::DirectConnection);
+
+    QObject::disconnect(generator, SIGNAL(imageReady(const QImage &)), this, SLOT(imageReady(const QImage &)));
+
+    return OutputImage;
+}
+
+void GeneratorRunner::imageReady(const QImage &output_image)
+{
+    OutputImage = output_image;
+}
@@ -0,0 +1,122 @@
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMutex>
+#include <QImage>
+#include <QRunnable>
+
+class BatchProcessor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchProcessor(QObject *parent = 0);
+    virtual ~BatchProcessor();
+
+    enum Effect {
+        EffectGrayscale,
+        EffectSketch,
+        EffectCartoon,
+        EffectBlur,
+        EffectPixelate
+    };
+
+    int  effect() const;
+    void setEffect(const int &effect);
+
+    QList<int> effectChain() const;
+    void       setEffectChain(const QList<int> &chain);
+
+    int  radius() const;
+    void setRadius(const int &radius);
+
+    int  sketchStyle() const;
+    void setSketchStyle(const int &style);
+
+    int  threshold() const;
+    void setThreshold(const int &threshold);
+
+    int  smoothing() const;
+    void setSmoothing(const int &smoothing);
+
+    int  pixDenom() const;
+    void setPixDenom(const int &pix_denom);
+
+    int  pixShape() const;
+    void setPixShape(const int &shape);
+
+    int  jobs() const;
+    void setJobs(const int &jobs);
+
+    qreal mpixLimit() const;
+    void  setMpixLimit(const qreal &limit);
+
+    QString outputDir() const;
+    void    setOutputDir(const QString &dir);
+
+    QString outputFormat() const;
+    void    setOutputFormat(const QString &format);
+
+    static int EffectFromName(const QString &name);
+    static int SmoothingFromName(const QString &name);
+    static int ShapeFromName(const QString &name);
+    static int StyleFromName(const QString &name);
+
+    QImage LoadImage(const QString &file_name) const;
+    QImage ApplyEffect(const QImage &input_image) const;
+
+    bool run(const QStringList &inputs);
+
+private:
+    friend class BatchTask;
+
+    QStringList ExpandInputs(const QStringList &inputs) const;
+    QStringList OutputFiles(const QStringList &files, int *renamed) const;
+
+    void TaskFinished(bool success, qint64 decode_time, qint64 effect_time, qint64 encode_time);
+
+    int        CurrentEffect, GaussianRadius, SketchStyle, CartoonThreshold, CartoonSmoothing, PixelDenom, PixelShape, JobsCount;
+    qreal      MPixLimit;
+    QList<int> EffectChain;
+    QString    OutputDir, OutputFormat;
+
+    QMutex     StatsMutex;
+    int        ProcessedCount, FailedCount;
+    qint64     DecodeTime, EffectTime, EncodeTime;
+};
+
+class BatchTask : public QRunnable
+{
+public:
+    BatchTask(BatchProcessor *processor, const QString &input_file, const QString &output_file);
+    virtual ~BatchTask();
+
+    virtual void run();
+
+private:
+    BatchProcessor *Processor;
+    QString         InputFile, OutputFile;
+};
+
+class GeneratorRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GeneratorRunner(QObject *parent = 0);
+    virtual ~GeneratorRunner();
+
+    QImage run(QObject *generator);
+
+public slots:
+    void imageReady(const QImage &output_image);
+
+private:
+    QImage OutputImage;
+};
+
+#endif // BATCHPROCESSOR_H
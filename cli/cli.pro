@@ -0,0 +1,60 @@
+TARGET = magicphotos-cli
+VERSION = 2.0.1
+
+TEMPLATE = app
+QT += core gui declarative
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp \
+    batchprocessor.cpp \
+    referencekernels.cpp \
+    kernelverifier.cpp \
+    syntheticimage.cpp \
+    ../tracer.cpp \
+    ../imagekernels.cpp \
+    ../effectpipeline.cpp \
+    ../effectscheduler.cpp \
+    ../cellmap.cpp \
+    ../tiledimage.cpp \
+    ../brushmask.cpp \
+    ../effectmask.cpp \
+    ../editstack.cpp \
+    ../editsession.cpp \
+    ../autosavewriter.cpp \
+    ../repaintcoalescer.cpp \
+    ../tilepyramid.cpp \
+    ../exifthumbnail.cpp \
+    ../previewsource.cpp \
+    ../decolorizeeditor.cpp \
+    ../sketcheditor.cpp \
+    ../cartooneditor.cpp \
+    ../blureditor.cpp \
+    ../pixelateeditor.cpp
+HEADERS += \
+    batchprocessor.h \
+    referencekernels.h \
+    kernelverifier.h \
+    syntheticimage.h \
+    ../tracer.h \
+    ../imagekernels.h \
+    ../effectpipeline.h \
+    ../effectscheduler.h \
+    ../cellmap.h \
+    ../tiledimage.h \
+    ../brushmask.h \
+    ../effectmask.h \
+    ../editstack.h \
+    ../editsession.h \
+    ../autosavewriter.h \
+    ../repaintcoalescer.h \
+    ../tilepyramid.h \
+    ../exifthumbnail.h \
+    ../previewsource.h \
+    ../decolorizeeditor.h \
+    ../sketcheditor.h \
+    ../cartooneditor.h \
+    ../blureditor.h \
+    ../pixelateeditor.h
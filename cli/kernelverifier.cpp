@@ -0,0 +1,317 @@
+#include "kernelverifier.h"
+#include "referencekernels.h"
+#include "batchprocessor.h"
+#include "syntheticimage.h"
+#include "imagekernels.h"
+#include "effectpipeline.h"
+
+KernelVerifier::KernelVerifier(QObject *parent) : QObject(parent), Out(stdout)
+{
+    RandomImagesCount = 20;
+    Tolerance         = 0;
+
+    EdgeSizes << QSize(1, 1)  << QSize(1, 2)   << QSize(2, 1)  << QSize(2, 2)
+              << QSize(1, 97) << QSize(97, 1)  << QSize(3, 3)  << QSize(3, 7)
+              << QSize(17, 33) << QSize(63, 65) << QSize(128, 2) << QSize(2, 128);
+}
+
+KernelVerifier::~KernelVerifier()
+{
+}
+
+int KernelVerifier::randomImages() const
+{
+    return RandomImagesCount;
+}
+
+void KernelVerifier::setRandomImages(const int &count)
+{
+    RandomImagesCount = count;
+}
+
+int KernelVerifier::tolerance() const
+{
+    return Tolerance;
+}
+
+void KernelVerifier::setTolerance(const int &tolerance)
+{
+    Tolerance = tolerance;
+}
+
+QString KernelVerifier::filter() const
+{
+    return Filter;
+}
+
+void KernelVerifier::setFilter(const QString &filter)
+{
+    Filter = filter;
+}
+
+QImage KernelVerifier::RandomImage(const QSize &size, uint seed)
+{
+    QImage image(size, QImage::Format_RGB32);
+    uint   state = seed;
+
+    for (int y = 0; y < image.height(); y++) {
+        QRgb *line = (QRgb *)image.scanLine(y);
+
+        for (int x = 0; x < image.width(); x++) {
+            state = state * 1103515245 + 12345;
+
+            line[x] = 0xff000000 | (state >> 8);
+        }
+    }
+
+    return image.convertToFormat(QImage::Format_RGB16);
+}
+
+bool KernelVerifier::run()
+{
+    bool passed = true;
+    uint state  = 1;
+
+    Out << "kernel,width,height,params,max_error_r,max_error_g,max_error_b,max_error_a,differing_pixels,result" << endl;
+
+    for (int i = 0; i < EdgeSizes.size(); i++) {
+        passed = VerifyImage(RandomImage(EdgeSizes.at(i), i + 1)) && passed;
+    }
+
+    for (int i = 0; i < RandomImagesCount; i++) {
+        state = state * 1103515245 + 12345;
+
+        int width  = (state >> 16) % 300 + 1;
+
+        state = state * 1103515245 + 12345;
+
+        int height = (state >> 16) % 300 + 1;
+
+        passed = VerifyImage(RandomImage(QSize(width, height), state)) && passed;
+    }
+
+    passed = VerifyImage(SyntheticImage::Make(QSize(321, 241), 7)) && passed;
+    passed = VerifyBlurStrength() && passed;
+    passed = VerifyAdjustHue() && passed;
+
+    return passed;
+}
+
+bool KernelVerifier::Matches(const QString &kernel_name) const
+{
+    return Filter.isEmpty() || kernel_name.contains(Filter, Qt::CaseInsensitive);
+}
+
+bool KernelVerifier::Compare(const QString &kernel_name, const QString &params, const QImage &result_image, const QImage &reference_image)
+{
+    int max_error[4] = { 0, 0, 0, 0 };
+    int differing    = 0;
+
+    if (result_image.size() != reference_image.size()) {
+        for (int i = 0; i < 4; i++) {
+            max_error[i] = 255;
+        }
+
+        differing = reference_image.width() * reference_image.height();
+    } else {
+        for (int y = 0; y < reference_image.height(); y++) {
+            for (int x = 0; x < reference_image.width(); x++) {
+                QRgb result    = result_image.pixel(x, y);
+                QRgb reference = reference_image.pixel(x, y);
+
+                if (result != reference) {
+                    max_error[0] = qMax(max_error[0], qAbs(qRed(result)   - qRed(reference)));
+                    max_error[1] = qMax(max_error[1], qAbs(qGreen(result) - qGreen(reference)));
+                    max_error[2] = qMax(max_error[2], qAbs(qBlue(result)  - qBlue(reference)));
+                    max_error[3] = qMax(max_error[3], qAbs(qAlpha(result) - qAlpha(reference)));
+
+                    differing++;
+                }
+            }
+        }
+    }
+
+    bool passed = qMax(qMax(max_error[0], max_error[1]), qMax(max_error[2], max_error[3])) <= Tolerance;
+
+    Out << kernel_name << ","
+        << reference_image.width() << ","
+        << reference_image.height() << ","
+        << params << ","
+        << max_error[0] << ","
+        << max_error[1] << ","
+        << max_error[2] << ","
+        << max_error[3] << ","
+        << differing << ","
+        << (passed ? "PASS" : "FAIL") << endl;
+
+    return passed;
+}
+
+bool KernelVerifier::CompareMean(const QString &kernel_name, const QString &params, const QImage &result_image, const QImage &reference_image, const qreal &max_mean_error)
+{
+    // Approximations are held to a mean error instead
+
+    int    max_error[3] = { 0, 0, 0 };
+    int    differing    = 0;
+    qint64 total_error  = 0;
+
+    if (result_image.size() != reference_image.size()) {
+        for (int i = 0; i < 3; i++) {
+            max_error[i] = 255;
+        }
+
+        differing   = reference_image.width() * reference_image.height();
+        total_error = qint64(differing) * 255 * 3;
+    } else {
+        for (int y = 0; y < reference_image.height(); y++) {
+            for (int x = 0; x < reference_image.width(); x++) {
+                QRgb result    = result_image.pixel(x, y);
+                QRgb reference = reference_image.pixel(x, y);
+                int  error[3]  = { qAbs(qRed(result)   - qRed(reference)),
+                                   qAbs(qGreen(result) - qGreen(reference)),
+                                   qAbs(qBlue(result)  - qBlue(reference)) };
+
+                for (int i = 0; i < 3; i++) {
+                    max_error[i] = qMax(max_error[i], error[i]);
+
+                    total_error += error[i];
+                }
+
+                if (result != reference) {
+                    differing++;
+                }
+            }
+        }
+    }
+
+    int   pixels     = qMax(reference_image.width() * reference_image.height(), 1);
+    qreal mean_error = total_error / (pixels * 3.0);
+    bool  passed     = mean_error <= max_mean_error;
+
+    Out << kernel_name << ","
+        << reference_image.width() << ","
+        << reference_image.height() << ","
+        << params << QString(" mean_error=%1").arg(mean_error, 0, 'f', 2) << ","
+        << max_error[0] << ","
+        << max_error[1] << ","
+        << max_error[2] << ","
+        << 0 << ","
+        << differing << ","
+        << (passed ? "PASS" : "FAIL") << endl;
+
+    return passed;
+}
+
+bool KernelVerifier::VerifyImage(const QImage &input_image)
+{
+    BatchProcessor processor;
+    QList<int>     radii;
+    QList<int>     thresholds;
+    QList<int>     pix_denoms;
+    bool           passed = true;
+
+    radii      << 0 << 1 << 2 << 3 << 4 << 11 << 17 << 18 << 48 << 64;
+    thresholds << 0 << 32 << 80 << 128 << 1000;
+    pix_denoms << 1 << 3 << 32 << 112 << 192 << 100000;
+
+    if (Matches("grayscale")) {
+        processor.setEffect(BatchProcessor::EffectGrayscale);
+
+        passed = Compare("grayscale", "", processor.ApplyEffect(input_image), ReferenceKernels::Grayscale(input_image)) && passed;
+    }
+
+    for (int i = 0; i < radii.size(); i++) {
+        processor.setRadius(radii.at(i));
+
+        if (Matches("sketch")) {
+            processor.setEffect(BatchProcessor::EffectSketch);
+
+            passed = Compare("sketch", QString("radius=%1").arg(radii.at(i)),
+                             processor.ApplyEffect(input_image), ReferenceKernels::Sketch(input_image, radii.at(i))) && passed;
+        }
+        if (Matches("cartoon")) {
+            processor.setEffect(BatchProcessor::EffectCartoon);
+
+            for (int j = 0; j < thresholds.size(); j++) {
+                processor.setThreshold(thresholds.at(j));
+
+                passed = Compare("cartoon", QString("radius=%1 threshold=%2").arg(radii.at(i)).arg(thresholds.at(j)),
+                                 processor.ApplyEffect(input_image), ReferenceKernels::Cartoon(input_image, radii.at(i), thresholds.at(j))) && passed;
+            }
+        }
+    }
+
+    if (Matches("pixelate")) {
+        processor.setEffect(BatchProcessor::EffectPixelate);
+
+        for (int i = 0; i < pix_denoms.size(); i++) {
+            processor.setPixDenom(pix_denoms.at(i));
+
+            passed = Compare("pixelate", QString("pix_denom=%1").arg(pix_denoms.at(i)),
+                             processor.ApplyEffect(input_image), ReferenceKernels::Pixelate(input_image, pix_denoms.at(i))) && passed;
+        }
+    }
+
+    return passed;
+}
+
+bool KernelVerifier::VerifyBlurStrength()
+{
+    // Box passes only approximate a gaussian, so the blur is held to mean errors
+
+    BatchProcessor processor;
+    QImage         input_image = SyntheticImage::Make(QSize(321, 241), 7);
+    bool           passed      = true;
+
+    processor.setEffect(BatchProcessor::EffectBlur);
+
+    for (int radius = 1; radius <= 17; radius++) {
+        processor.setRadius(radius);
+
+        QImage result_image = processor.ApplyEffect(input_image);
+
+        if (Matches("blur-gaussian")) {
+            passed = CompareMean("blur-gaussian", QString("radius=%1").arg(radius), result_image,
+                                 ReferenceKernels::GaussianBlur(input_image, EffectPipeline::Sigma(radius)), MAX_GAUSSIAN_ERROR) && passed;
+        }
+        if (Matches("blur-recursive")) {
+            passed = CompareMean("blur-recursive", QString("radius=%1").arg(radius), result_image,
+                                 ReferenceKernels::RecursiveBlur(input_image, radius), MAX_RECURSIVE_ERROR) && passed;
+        }
+    }
+
+    return passed;
+}
+
+bool KernelVerifier::VerifyAdjustHue()
+{
+    bool passed = true;
+
+    if (Matches("recolor")) {
+        QList<int> hues;
+        QImage     input_image(256, 256, QImage::Format_RGB16);
+
+        hues << 0 << 60 << 180 << 359;
+
+        for (int i = 0; i < 65536; i++) {
+            ((quint16 *)input_image.scanLine(i / 256))[i % 256] = i;
+        }
+
+        for (int i = 0; i < hues.size(); i++) {
+            QImage result_image    = input_image.copy();
+            QImage reference_image(input_image.size(), QImage::Format_RGB16);
+
+            ImageKernels::AdjustHue(result_image, hues.at(i));
+
+            for (int y = 0; y < input_image.height(); y++) {
+                for (int x = 0; x < input_image.width(); x++) {
+                    reference_image.setPixel(x, y, ReferenceKernels::AdjustHue(input_image.pixel(x, y), hues.at(i)));
+                }
+            }
+
+            passed = Compare("recolor", QString("hue=%1").arg(hues.at(i)), result_image, reference_image) && passed;
+        }
+    }
+
+    return passed;
+}
@@ -0,0 +1,50 @@
+#ifndef KERNELVERIFIER_H
+#define KERNELVERIFIER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QSize>
+#include <QImage>
+#include <QTextStream>
+
+class KernelVerifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit KernelVerifier(QObject *parent = 0);
+    virtual ~KernelVerifier();
+
+    int  randomImages() const;
+    void setRandomImages(const int &count);
+
+    int  tolerance() const;
+    void setTolerance(const int &tolerance);
+
+    QString filter() const;
+    void    setFilter(const QString &filter);
+
+    static QImage RandomImage(const QSize &size, uint seed);
+
+    bool run();
+
+private:
+    bool Matches(const QString &kernel_name) const;
+    bool Compare(const QString &kernel_name, const QString &params, const QImage &result_image, const QImage &reference_image);
+    bool CompareMean(const QString &kernel_name, const QString &params, const QImage &result_image, const QImage &reference_image, const qreal &max_mean_error);
+
+    bool VerifyImage(const QImage &input_image);
+    bool VerifyBlurStrength();
+    bool VerifyAdjustHue();
+
+    static const qreal MAX_GAUSSIAN_ERROR  = 4.0;
+    static const qreal MAX_RECURSIVE_ERROR = 6.0;
+
+    int          RandomImagesCount, Tolerance;
+    QString      Filter;
+    QList<QSize> EdgeSizes;
+    QTextStream  Out;
+};
+
+#endif // KERNELVERIFIER_H
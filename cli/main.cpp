@@ -0,0 +1,155 @@
+#include <QApplication>
+#include <QStringList>
+#include <QDir>
+#include <QTextStream>
+
+#include "tracer.h"
+#include "batchprocessor.h"
+#include "kernelverifier.h"
+
+static void PrintUsage()
+{
+    QTextStream err(stderr);
+
+    err << "Usage: magicphotos-cli --effect EFFECT --output DIR [OPTIONS] FILE_OR_DIR..." << endl
+        << "       magicphotos-cli --verify [--random-images N] [--tolerance N] [--filter KERNEL]" << endl
+        << endl
+        << "Effects: grayscale, sketch, cartoon, blur, pixelate, or several of them" << endl
+        << "separated by commas, applied in order as an edit stack" << endl
+        << endl
+        << "Inputs whose output names would collide are written with a numbered suffix" << endl
+        << "(name-2.jpg, ...) and reported on stderr; the exit status is 1 only when" << endl
+        << "an image fails" << endl
+        << endl
+        << "Options:" << endl
+        << "  --radius N       Gaussian radius for sketch, cartoon and blur (default 11)" << endl
+        << "  --style S        sketch style: dodge, sobel or dog (default dodge)" << endl
+        << "  --threshold N    cartoon threshold (default 80)" << endl
+        << "  --smoothing S    cartoon smoothing: gaussian or bilateral (default gaussian)" << endl
+        << "  --pix-denom N    pixelate block denominator (default 112)" << endl
+        << "  --pix-shape S    pixelate cell shape: square, hexagon, circle or triangle (default square)" << endl
+        << "  --jobs N         number of parallel workers (default: number of CPU cores)" << endl
+        << "  --max-mpix X     downscale inputs larger than X megapixels on decode (default: no limit)" << endl
+        << "  --format EXT     output format: jpg, png or bmp (default jpg)" << endl
+        << endl
+        << "Verify options:" << endl
+        << "  --filter KERNEL    check only kernels whose name contains KERNEL" << endl
+        << "  --random-images N  number of random-sized images besides the edge cases (default 20)" << endl
+        << "  --tolerance N      maximum allowed per-channel error against the reference kernels (default 0)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv, false);
+
+    Tracer::Initialize();
+
+    BatchProcessor  processor;
+    KernelVerifier  verifier;
+    QStringList     args        = app.arguments();
+    QStringList     inputs;
+    bool            valid       = true;
+    bool            verify_mode = false;
+    int             effect      = -1;
+
+    for (int i = 1; i < args.size() && valid; i++) {
+        QString arg = args.at(i);
+
+        if (arg == "--verify") {
+            verify_mode = true;
+        } else if (arg.startsWith("--")) {
+            if (i + 1 >= args.size()) {
+                valid = false;
+
+                break;
+            }
+
+            QString value = args.at(++i);
+            bool    ok    = true;
+
+            if (arg == "--effect") {
+                QList<int> chain;
+
+                foreach (const QString &name, value.split(",")) {
+                    chain.append(BatchProcessor::EffectFromName(name));
+
+                    ok = ok && chain.last() != -1;
+                }
+
+                effect = chain.first();
+
+                processor.setEffectChain(chain);
+            } else if (arg == "--radius") {
+                processor.setRadius(value.toInt(&ok));
+            } else if (arg == "--style") {
+                processor.setSketchStyle(BatchProcessor::StyleFromName(value));
+
+                ok = processor.sketchStyle() != -1;
+            } else if (arg == "--threshold") {
+                processor.setThreshold(value.toInt(&ok));
+            } else if (arg == "--smoothing") {
+                processor.setSmoothing(BatchProcessor::SmoothingFromName(value));
+
+                ok = processor.smoothing() != -1;
+            } else if (arg == "--pix-denom") {
+                processor.setPixDenom(value.toInt(&ok));
+
+                ok = ok && processor.pixDenom() > 0;
+            } else if (arg == "--pix-shape") {
+                processor.setPixShape(BatchProcessor::ShapeFromName(value));
+
+                ok = processor.pixShape() != -1;
+            } else if (arg == "--jobs") {
+                processor.setJobs(value.toInt(&ok));
+
+                ok = ok && processor.jobs() > 0;
+            } else if (arg == "--max-mpix") {
+                processor.setMpixLimit(value.toDouble(&ok));
+            } else if (arg == "--format") {
+                ok = (value == "jpg" || value == "png" || value == "bmp");
+
+                processor.setOutputFormat(value);
+            } else if (arg == "--output") {
+                processor.setOutputDir(value);
+            } else if (arg == "--filter") {
+                verifier.setFilter(value);
+            } else if (arg == "--random-images") {
+                verifier.setRandomImages(value.toInt(&ok));
+
+                ok = ok && verifier.randomImages() >= 0;
+            } else if (arg == "--tolerance") {
+                verifier.setTolerance(value.toInt(&ok));
+
+                ok = ok && verifier.tolerance() >= 0;
+            } else {
+                ok = false;
+            }
+
+            if (!ok) {
+                qWarning("invalid option: %s %s", qPrintable(arg), qPrintable(value));
+
+                valid = false;
+            }
+        } else {
+            inputs.append(arg);
+        }
+    }
+
+    if (valid && verify_mode) {
+        return verifier.run() ? 0 : 1;
+    }
+
+    if (!valid || effect == -1 || processor.outputDir().isEmpty() || inputs.isEmpty()) {
+        PrintUsage();
+
+        return 2;
+    }
+
+    if (!QDir().mkpath(processor.outputDir())) {
+        qWarning("could not create output directory %s", qPrintable(processor.outputDir()));
+
+        return 1;
+    }
+
+    return processor.run(inputs) ? 0 : 1;
+}
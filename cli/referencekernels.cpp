@@ -0,0 +1,299 @@
+#include <qmath.h>
+#include <QVector>
+#include <QColor>
+
+#include "referencekernels.h"
+#include "imagekernels.h"
+
+QImage ReferenceKernels::Grayscale(const QImage &input_image)
+{
+    QImage grayscale_image = input_image;
+
+    for (int x = 0; x < grayscale_image.width(); x++) {
+        for (int y = 0; y < grayscale_image.height(); y++) {
+            int gray  = qGray(grayscale_image.pixel(x, y));
+            int alpha = qAlpha(grayscale_image.pixel(x, y));
+
+            grayscale_image.setPixel(x, y, qRgba(gray, gray, gray, alpha));
+        }
+    }
+
+    return grayscale_image;
+}
+
+QImage ReferenceKernels::Sketch(const QImage &input_image, int gaussian_radius)
+{
+    QImage grayscale_image = input_image;
+    QImage sketch_image    = KernelBlur(input_image, gaussian_radius);
+
+    for (int x = 0; x < input_image.width(); x++) {
+        for (int y = 0; y < input_image.height(); y++) {
+            int gray  = qGray(input_image.pixel(x, y));
+            int alpha = qAlpha(input_image.pixel(x, y));
+
+            grayscale_image.setPixel(x, y, qRgba(gray, gray, gray, alpha));
+
+            int blr_gray = qGray(sketch_image.pixel(x, y));
+            int inv_gray = blr_gray >= 255 ? 0 : 255 - blr_gray;
+
+            sketch_image.setPixel(x, y, qRgba(inv_gray, inv_gray, inv_gray, alpha));
+        }
+    }
+
+    for (int x = 0; x < sketch_image.width(); x++) {
+        for (int y = 0; y < sketch_image.height(); y++) {
+            int top_gray = qGray(sketch_image.pixel(x, y));
+            int btm_gray = qGray(grayscale_image.pixel(x, y));
+            int res_gray = top_gray >= 255 ? 255 : qMin(btm_gray * 255 / (255 - top_gray), 255);
+
+            int alpha    = qAlpha(sketch_image.pixel(x, y));
+
+            sketch_image.setPixel(x, y, qRgba(res_gray, res_gray, res_gray, alpha));
+        }
+    }
+
+    return sketch_image;
+}
+
+QImage ReferenceKernels::Cartoon(const QImage &input_image, int gaussian_radius, int cartoon_threshold)
+{
+    QImage blur_image    = gaussian_radius != 0 ? KernelBlur(input_image, gaussian_radius) : input_image;
+    QImage cartoon_image = input_image;
+
+    int width  = blur_image.width();
+    int height = blur_image.height();
+
+    QVector<int> src_buf(width * height * 4, 0);
+    QVector<int> dst_buf(width * height * 4, 0);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            QRgb color = blur_image.pixel(x, y);
+
+            src_buf[(y * width + x) * 4]     = qBlue(color);
+            src_buf[(y * width + x) * 4 + 1] = qGreen(color);
+            src_buf[(y * width + x) * 4 + 2] = qRed(color);
+            src_buf[(y * width + x) * 4 + 3] = qAlpha(color);
+        }
+    }
+
+    for (int y = 1; y < height - 1; y++) {
+        for (int x = 1; x < width - 1; x++) {
+            int offset = (y * width + x) * 4;
+            int row    = width * 4;
+            int grad   = 0;
+
+            for (int i = 0; i < 3; i++) {
+                grad += qAbs(src_buf[offset + i - 4] - src_buf[offset + i + 4]) + qAbs(src_buf[offset + i - row] - src_buf[offset + i + row]);
+            }
+
+            bool exceeds_threshold = grad > cartoon_threshold;
+
+            if (!exceeds_threshold) {
+                grad = 0;
+
+                for (int i = 0; i < 3; i++) {
+                    grad += qAbs(src_buf[offset + i - 4] - src_buf[offset + i + 4]);
+                }
+
+                exceeds_threshold = grad > cartoon_threshold;
+            }
+            if (!exceeds_threshold) {
+                grad = 0;
+
+                for (int i = 0; i < 3; i++) {
+                    grad += qAbs(src_buf[offset + i - row] - src_buf[offset + i + row]);
+                }
+
+                exceeds_threshold = grad > cartoon_threshold;
+            }
+            if (!exceeds_threshold) {
+                grad = 0;
+
+                for (int i = 0; i < 3; i++) {
+                    grad += qAbs(src_buf[offset + i - 4 - row] - src_buf[offset + i + 4 + row]) + qAbs(src_buf[offset + i + 4 - row] - src_buf[offset + i - 4 + row]);
+                }
+
+                exceeds_threshold = grad > cartoon_threshold;
+            }
+
+            for (int i = 0; i < 3; i++) {
+                dst_buf[offset + i] = exceeds_threshold ? 0 : src_buf[offset + i];
+            }
+
+            dst_buf[offset + 3] = src_buf[offset + 3];
+        }
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            cartoon_image.setPixel(x, y, qRgba(dst_buf[(y * width + x) * 4 + 2], dst_buf[(y * width + x) * 4 + 1],
+                                               dst_buf[(y * width + x) * 4],     dst_buf[(y * width + x) * 4 + 3]));
+        }
+    }
+
+    return cartoon_image;
+}
+
+QImage ReferenceKernels::Pixelate(const QImage &input_image, int pix_denom)
+{
+    QImage pixelated_image = input_image;
+
+    int pix_size = qMax(pixelated_image.width(), pixelated_image.height()) / pix_denom;
+
+    if (pix_size != 0) {
+        for (int i = 0; i < pixelated_image.width() / pix_size + 1; i++) {
+            for (int j = 0; j < pixelated_image.height() / pix_size + 1; j++) {
+                int avg_r  = 0;
+                int avg_g  = 0;
+                int avg_b  = 0;
+                int pixels = 0;
+
+                for (int x = i * pix_size; x < (i + 1) * pix_size && x < pixelated_image.width(); x++) {
+                    for (int y = j * pix_size; y < (j + 1) * pix_size && y < pixelated_image.height(); y++) {
+                        QRgb pixel = pixelated_image.pixel(x, y);
+
+                        avg_r += qRed(pixel);
+                        avg_g += qGreen(pixel);
+                        avg_b += qBlue(pixel);
+
+                        pixels++;
+                    }
+                }
+
+                if (pixels != 0) {
+                    for (int x = i * pix_size; x < (i + 1) * pix_size && x < pixelated_image.width(); x++) {
+                        for (int y = j * pix_size; y < (j + 1) * pix_size && y < pixelated_image.height(); y++) {
+                            pixelated_image.setPixel(x, y, qRgba(avg_r / pixels, avg_g / pixels, avg_b / pixels, qAlpha(pixelated_image.pixel(x, y))));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return pixelated_image;
+}
+
+QRgb ReferenceKernels::AdjustHue(QRgb rgb, int hue)
+{
+    QColor color(qRgb(qRed(rgb) & 0xf8, qGreen(rgb) & 0xfc, qBlue(rgb) & 0xf8));
+
+    return QColor::fromHsv(hue, color.saturation(), color.value(), qAlpha(rgb)).rgba();
+}
+
+QImage ReferenceKernels::GaussianBlur(const QImage &input_image, qreal sigma)
+{
+    QImage blur_image = input_image;
+
+    if (sigma <= 0.0) {
+        return blur_image;
+    }
+
+    int width  = blur_image.width();
+    int height = blur_image.height();
+    int reach  = qCeil(sigma * 4.0);
+
+    QVector<qreal> weights(reach * 2 + 1);
+    qreal          total = 0.0;
+
+    for (int k = -reach; k <= reach; k++) {
+        weights[k + reach] = qExp(-(k * k) / (2.0 * sigma * sigma));
+
+        total += weights.at(k + reach);
+    }
+
+    QVector<qreal> src_buf(width * height * 3, 0.0);
+    QVector<qreal> dst_buf(width * height * 3, 0.0);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            QRgb color = blur_image.pixel(x, y);
+
+            src_buf[(y * width + x) * 3]     = qRed(color);
+            src_buf[(y * width + x) * 3 + 1] = qGreen(color);
+            src_buf[(y * width + x) * 3 + 2] = qBlue(color);
+        }
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        bool horizontal = (pass == 0);
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                for (int i = 0; i < 3; i++) {
+                    qreal sum = 0.0;
+
+                    for (int k = -reach; k <= reach; k++) {
+                        int sx = horizontal ? qBound(0, x + k, width - 1) : x;
+                        int sy = horizontal ? y : qBound(0, y + k, height - 1);
+
+                        sum += weights.at(k + reach) * src_buf.at((sy * width + sx) * 3 + i);
+                    }
+
+                    dst_buf[(y * width + x) * 3 + i] = sum / total;
+                }
+            }
+        }
+
+        src_buf = dst_buf;
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            blur_image.setPixel(x, y, qRgb(qRound(src_buf.at((y * width + x) * 3)),
+                                           qRound(src_buf.at((y * width + x) * 3 + 1)),
+                                           qRound(src_buf.at((y * width + x) * 3 + 2))));
+        }
+    }
+
+    return blur_image;
+}
+
+QImage ReferenceKernels::RecursiveBlur(const QImage &input_image, int gaussian_radius)
+{
+    QImage blur_image = input_image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    int tab[] = { 14, 10, 8, 6, 5, 5, 4, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2 };
+    int alpha = (gaussian_radius < 1) ? 16 : (gaussian_radius > 17) ? 1 : tab[gaussian_radius - 1];
+
+    int width  = blur_image.width();
+    int height = blur_image.height();
+
+    for (int pass = 0; pass < 4; pass++) {
+        bool vertical = (pass % 2 == 0);
+        bool forward  = (pass < 2);
+        int  lines    = vertical ? width  : height;
+        int  length   = vertical ? height : width;
+
+        for (int line = 0; line < lines; line++) {
+            int rgba[4];
+
+            for (int k = 0; k < length; k++) {
+                int x = vertical ? line : (forward ? k : width  - 1 - k);
+                int y = vertical ? (forward ? k : height - 1 - k) : line;
+
+                unsigned char *p = blur_image.scanLine(y) + x * 4;
+
+                for (int i = 0; i < 4; i++) {
+                    if (k == 0) {
+                        rgba[i] = p[i] << 4;
+                    } else {
+                        p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
+                    }
+                }
+            }
+        }
+    }
+
+    return blur_image.convertToFormat(input_image.format());
+}
+
+QImage ReferenceKernels::KernelBlur(const QImage &input_image, int gaussian_radius)
+{
+    QImage blur_image = input_image;
+
+    ImageKernels::Blur(blur_image, gaussian_radius);
+
+    return blur_image;
+}
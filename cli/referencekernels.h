@@ -0,0 +1,25 @@
+#ifndef REFERENCEKERNELS_H
+#define REFERENCEKERNELS_H
+
+#include <QImage>
+
+// Straightforward scalar implementations of the effect math, kept as the
+// golden reference for optimized kernels. Do not optimize these.
+
+class ReferenceKernels
+{
+public:
+    static QImage Grayscale(const QImage &input_image);
+    static QImage Sketch(const QImage &input_image, int gaussian_radius);
+    static QImage Cartoon(const QImage &input_image, int gaussian_radius, int cartoon_threshold);
+    static QImage GaussianBlur(const QImage &input_image, qreal sigma);
+    static QImage RecursiveBlur(const QImage &input_image, int gaussian_radius);
+    static QImage Pixelate(const QImage &input_image, int pix_denom);
+
+    static QRgb   AdjustHue(QRgb rgb, int hue);
+
+private:
+    static QImage KernelBlur(const QImage &input_image, int gaussian_radius);
+};
+
+#endif // REFERENCEKERNELS_H
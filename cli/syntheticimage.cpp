@@ -0,0 +1,36 @@
+#include <qmath.h>
+
+#include "syntheticimage.h"
+
+QSize SyntheticImage::SizeForMpix(const qreal &mpix)
+{
+    int width  = qSqrt(mpix * 1000000.0 * 4.0 / 3.0);
+    int height = width * 3 / 4;
+
+    return QSize(qMax(width, 1), qMax(height, 1));
+}
+
+QImage SyntheticImage::Make(const QSize &size, uint seed)
+{
+    QImage image(size, QImage::Format_RGB32);
+    uint   state = seed;
+
+    for (int y = 0; y < image.height(); y++) {
+        QRgb *line = (QRgb *)image.scanLine(y);
+
+        for (int x = 0; x < image.width(); x++) {
+            state = state * 1103515245 + 12345;
+
+            int noise = (state >> 16) & 0x1f;
+            int block = ((x / 64 + y / 64) % 2) * 64;
+
+            int red   = qMin(x * 191 / image.width()  + noise + block, 255);
+            int green = qMin(y * 191 / image.height() + noise,         255);
+            int blue  = qMin((x + y) % 192            + noise + block, 255);
+
+            line[x] = qRgb(red, green, blue);
+        }
+    }
+
+    return image.convertToFormat(QImage::Format_RGB16);
+}
@@ -0,0 +1,18 @@
+#ifndef SYNTHETICIMAGE_H
+#define SYNTHETICIMAGE_H
+
+#include <QtGlobal>
+#include <QSize>
+#include <QImage>
+
+// Deterministic RGB16 test image of gradients, 64-pixel blocks and noise,
+// shared by the kernel verifier, the benchmarks and the trace replayer.
+
+class SyntheticImage
+{
+public:
+    static QSize  SizeForMpix(const qreal &mpix);
+    static QImage Make(const QSize &size, uint seed);
+};
+
+#endif // SYNTHETICIMAGE_H
@@ -1,16 +1,23 @@
 #include <qmath.h>
 #include <QFileInfo>
-#include <QThread>
 #include <QImageReader>
 #include <QPainter>
 
 #include "decolorizeeditor.h"
+#include "imagekernels.h"
+#include "effectscheduler.h"
+#include "tracer.h"
 
 DecolorizeEditor::DecolorizeEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 {
-    IsChanged   = false;
-    CurrentMode = ModeScroll;
-    HelperSize  = 0;
+    IsChanged     = false;
+    CurrentMode   = ModeScroll;
+    HelperSize    = 0;
+    BrushSize     = DEFAULT_BRUSH_SIZE;
+    BrushHardness = DEFAULT_BRUSH_HARDNESS;
+
+    Repainter = new RepaintCoalescer(this, this);
+    Autosaver = new AutosaveWriter(this);
 
     setAcceptedMouseButtons(Qt::LeftButton | Qt::RightButton | Qt::MiddleButton);
 
@@ -20,6 +27,9 @@ DecolorizeEditor::DecolorizeEditor(QDeclarativeItem *parent) : QDeclarativeItem(
 
 DecolorizeEditor::~DecolorizeEditor()
 {
+    EffectScheduler::Instance()->cancel(this);
+
+    SaveSession();
 }
 
 int DecolorizeEditor::mode() const
@@ -42,6 +52,26 @@ void DecolorizeEditor::setHelperSize(const int &size)
     HelperSize = size;
 }
 
+int DecolorizeEditor::brushSize() const
+{
+    return BrushSize;
+}
+
+void DecolorizeEditor::setBrushSize(const int &size)
+{
+    BrushSize = qMax(size, 1);
+}
+
+qreal DecolorizeEditor::brushHardness() const
+{
+    return BrushHardness;
+}
+
+void DecolorizeEditor::setBrushHardness(const qreal &hardness)
+{
+    BrushHardness = qBound((qreal)0.0, hardness, (qreal)1.0);
+}
+
 bool DecolorizeEditor::changed() const
 {
     return IsChanged;
@@ -49,8 +79,14 @@ bool DecolorizeEditor::changed() const
 
 void DecolorizeEditor::openImage(const QString &image_url)
 {
+    TRACE_SCOPE("DecolorizeEditor::openImage");
+
     QString image_file = QUrl(image_url).toLocalFile();
 
+    if (!image_file.isNull() && ResumeSession(image_file)) {
+        return;
+    }
+
     if (!image_file.isNull()) {
         QImageReader reader(image_file);
 
@@ -66,26 +102,27 @@ void DecolorizeEditor::openImage(const QString &image_url)
                 reader.setScaledSize(size);
             }
 
-            LoadedImage = reader.read();
+            {
+                TRACE_SCOPE("QImageReader::read");
+
+                LoadedImage = reader.read();
+            }
 
             if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+                LoadedImage = ImageKernels::ConvertToFormat(LoadedImage, QImage::Format_RGB16);
 
                 if (!LoadedImage.isNull()) {
-                    QThread                 *thread    = new QThread();
-                    GrayscaleImageGenerator *generator = new GrayscaleImageGenerator();
+                    SourceFile = image_file;
 
-                    generator->moveToThread(thread);
+                    GrayscaleImageGenerator *generator = new GrayscaleImageGenerator();
 
-                    QObject::connect(thread,    SIGNAL(started()),                  generator, SLOT(start()));
-                    QObject::connect(thread,    SIGNAL(finished()),                 thread,    SLOT(deleteLater()));
                     QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this,      SLOT(effectedImageReady(const QImage &)));
-                    QObject::connect(generator, SIGNAL(finished()),                 thread,    SLOT(quit()));
                     QObject::connect(generator, SIGNAL(finished()),                 generator, SLOT(deleteLater()));
 
                     generator->setInput(LoadedImage);
 
-                    thread->start(QThread::LowPriority);
+                    EffectScheduler::Instance()->cancel(this);
+                    EffectScheduler::Instance()->schedule(generator, EffectScheduler::PriorityBackground, this);
                 } else {
                     emit imageOpenFailed();
                 }
@@ -102,17 +139,19 @@ void DecolorizeEditor::openImage(const QString &image_url)
 
 void DecolorizeEditor::saveImage(const QString &image_url)
 {
+    TRACE_SCOPE("DecolorizeEditor::saveImage");
+
     QString file_name = QUrl(image_url).toLocalFile();
 
     if (!file_name.isNull()) {
-        if (!CurrentImage.isNull()) {
+        if (!CurrentMask.isNull()) {
             if (QFileInfo(file_name).suffix().compare("png", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("jpg", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("bmp", Qt::CaseInsensitive) != 0) {
                 file_name = file_name + ".jpg";
             }
 
-            if (CurrentImage.convertToFormat(QImage::Format_ARGB32).save(file_name)) {
+            if (CurrentMask.composite(OriginalImage, EffectedImage, OriginalImage.rect()).save(file_name)) {
                 IsChanged = false;
 
                 emit imageSaved();
@@ -130,7 +169,9 @@ void DecolorizeEditor::saveImage(const QString &image_url)
 void DecolorizeEditor::undo()
 {
     if (UndoStack.size() > 0) {
-        CurrentImage = UndoStack.pop();
+        CurrentMask = UndoStack.pop();
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         if (UndoStack.size() == 0) {
             emit undoAvailabilityChanged(false);
@@ -138,17 +179,32 @@ void DecolorizeEditor::undo()
 
         IsChanged = true;
 
+        Autosaver->update("mask", CurrentMask.weights());
+
         update();
     }
 }
 
+void DecolorizeEditor::discard()
+{
+    Autosaver->stop();
+
+    IsChanged = false;
+
+    if (!SourceFile.isEmpty()) {
+        EditSession::Remove(SourceFile);
+    }
+}
+
 void DecolorizeEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*)
 {
+    TRACE_SCOPE("DecolorizeEditor::paint");
+
     qreal scale = 1.0;
 
-    if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-        scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                width() / CurrentImage.width() : height() / CurrentImage.height();
+    if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+        scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                width() / OriginalImage.width() : height() / OriginalImage.height();
     }
 
     bool antialiasing = painter->testRenderHint(QPainter::Antialiasing);
@@ -157,21 +213,22 @@ void DecolorizeEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *
         painter->setRenderHint(QPainter::Antialiasing, true);
     }
 
-    QRectF src_rect(option->exposedRect.left()   / scale,
-                    option->exposedRect.top()    / scale,
-                    option->exposedRect.width()  / scale,
-                    option->exposedRect.height() / scale);
-
-    painter->drawImage(option->exposedRect, CurrentImage.copy(src_rect.toRect()));
+    DisplayPyramid.draw(painter, option->exposedRect, scale);
 
     painter->setRenderHint(QPainter::Antialiasing, antialiasing);
 }
 
 void DecolorizeEditor::effectedImageReady(const QImage &effected_image)
 {
+    Tracer::AsyncEnd("imageReady delivery", sender());
+
+    TRACE_SCOPE("DecolorizeEditor::effectedImageReady");
+
     OriginalImage = LoadedImage;
     EffectedImage = effected_image;
-    CurrentImage  = EffectedImage;
+    CurrentMask   = EffectMask(EffectedImage.size());
+
+    DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
     LoadedImage = QImage();
 
@@ -179,8 +236,10 @@ void DecolorizeEditor::effectedImageReady(const QImage &effected_image)
 
     IsChanged = true;
 
-    setImplicitWidth(CurrentImage.width());
-    setImplicitHeight(CurrentImage.height());
+    Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+    setImplicitWidth(EffectedImage.width());
+    setImplicitHeight(EffectedImage.height());
 
     update();
 
@@ -213,9 +272,83 @@ void DecolorizeEditor::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     }
 }
 
+EditSession DecolorizeEditor::MakeSession() const
+{
+    EditSession       session;
+    QList<TiledImage> journal;
+
+    for (int i = 0; i < UndoStack.size(); i++) {
+        journal.append(UndoStack.at(i).weights());
+    }
+
+    session.setEditor("decolorize");
+    session.setSourceFile(SourceFile);
+    session.setImage("mask",     CurrentMask.weights());
+    session.setImage("original", TiledImage(OriginalImage));
+    session.setImage("effected", TiledImage(EffectedImage));
+    session.setJournal(journal);
+
+    return session;
+}
+
+bool DecolorizeEditor::ResumeSession(const QString &image_file)
+{
+    TRACE_SCOPE("DecolorizeEditor::ResumeSession");
+
+    EditSession session;
+
+    if (session.load(EditSession::FileFor(image_file)) && session.editor() == "decolorize" && session.sourceUnchanged() &&
+        session.image("original").size() == session.image("mask").size() &&
+        session.image("effected").size() == session.image("mask").size() && !session.image("mask").isNull()) {
+        QList<TiledImage> journal = session.journal();
+
+        SourceFile    = image_file;
+        OriginalImage = session.image("original").toImage();
+        EffectedImage = session.image("effected").toImage();
+        CurrentMask   = EffectMask(session.image("mask"));
+
+        UndoStack.clear();
+
+        for (int i = 0; i < journal.size(); i++) {
+            UndoStack.push(EffectMask(journal.at(i)));
+        }
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
+
+        IsChanged = true;
+
+        Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+        setImplicitWidth(OriginalImage.width());
+        setImplicitHeight(OriginalImage.height());
+
+        update();
+
+        emit undoAvailabilityChanged(!UndoStack.isEmpty());
+        emit imageOpened();
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void DecolorizeEditor::SaveSession()
+{
+    if (IsChanged) {
+        Autosaver->finish();
+    } else {
+        Autosaver->stop();
+
+        if (!SourceFile.isEmpty() && !CurrentMask.isNull()) {
+            EditSession::Remove(SourceFile);
+        }
+    }
+}
+
 void DecolorizeEditor::SaveUndoImage()
 {
-    UndoStack.push(CurrentImage);
+    UndoStack.push(CurrentMask);
 
     if (UndoStack.size() > UNDO_DEPTH) {
         for (int i = 0; i < UndoStack.size() - UNDO_DEPTH; i++) {
@@ -228,6 +361,8 @@ void DecolorizeEditor::SaveUndoImage()
 
 void DecolorizeEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 {
+    TRACE_SCOPE("DecolorizeEditor::ChangeImageAt");
+
     if (CurrentMode != ModeScroll) {
         if (save_undo) {
             SaveUndoImage();
@@ -235,35 +370,31 @@ void DecolorizeEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 
         qreal scale = 1.0;
 
-        if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-            scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                    width() / CurrentImage.width() : height() / CurrentImage.height();
+        if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+            scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                    width() / OriginalImage.width() : height() / OriginalImage.height();
         }
 
         int img_center_x = center_x   / scale;
         int img_center_y = center_y   / scale;
-        int radius       = BRUSH_SIZE / scale;
-
-        for (int x = img_center_x - radius; x <= img_center_x + radius; x++) {
-            for (int y = img_center_y - radius; y <= img_center_y + radius; y++) {
-                if (x >= 0 && x < CurrentImage.width() && y >= 0 && y < CurrentImage.height() && qSqrt(qPow(x - img_center_x, 2) + qPow(y - img_center_y, 2)) <= radius) {
-                    if (CurrentMode == ModeOriginal) {
-                        CurrentImage.setPixel(x, y, OriginalImage.pixel(x, y));
-                    } else {
-                        CurrentImage.setPixel(x, y, EffectedImage.pixel(x, y));
-                    }
-                }
-            }
-        }
+        int radius       = BrushSize  / scale;
+
+        CurrentMask.stamp(BrushMask::Cached(radius, BrushHardness), QPoint(img_center_x, img_center_y), CurrentMode == ModeOriginal ? 0 : BrushMask::MAX_WEIGHT);
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         IsChanged = true;
 
-        update(center_x - BRUSH_SIZE, center_y - BRUSH_SIZE, BRUSH_SIZE * 2, BRUSH_SIZE * 2);
+        Autosaver->update("mask", CurrentMask.weights());
 
-        QImage helper_image = CurrentImage.copy(img_center_x - (HelperSize / scale) / 2,
-                                                img_center_y - (HelperSize / scale) / 2,
-                                                HelperSize / scale,
-                                                HelperSize / scale).scaledToWidth(HelperSize);
+        Repainter->update(QRectF(center_x - BrushSize, center_y - BrushSize, BrushSize * 2, BrushSize * 2));
+
+        QRect helper_rect(img_center_x - (HelperSize / scale) / 2,
+                          img_center_y - (HelperSize / scale) / 2,
+                          HelperSize / scale,
+                          HelperSize / scale);
+
+        QImage helper_image = CurrentMask.composite(OriginalImage, EffectedImage, helper_rect).scaledToWidth(HelperSize);
 
         emit helperImageReady(helper_image);
     }
@@ -284,16 +415,13 @@ void GrayscaleImageGenerator::setInput(const QImage &input_image)
 
 void GrayscaleImageGenerator::start()
 {
-    QImage grayscale_image = InputImage;
+    TRACE_SCOPE("GrayscaleImageGenerator::start");
 
-    for (int x = 0; x < grayscale_image.width(); x++) {
-        for (int y = 0; y < grayscale_image.height(); y++) {
-            int gray  = qGray(grayscale_image.pixel(x, y));
-            int alpha = qAlpha(grayscale_image.pixel(x, y));
+    QImage grayscale_image = ImageKernels::ToRGB16(InputImage);
 
-            grayscale_image.setPixel(x, y, qRgba(gray, gray, gray, alpha));
-        }
-    }
+    ImageKernels::Grayscale(grayscale_image);
+
+    Tracer::AsyncBegin("imageReady delivery", this);
 
     emit imageReady(grayscale_image);
     emit finished();
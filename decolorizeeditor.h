@@ -9,13 +9,22 @@
 #include <QStyleOptionGraphicsItem>
 #include <QDeclarativeItem>
 
+#include "repaintcoalescer.h"
+#include "tilepyramid.h"
+#include "brushmask.h"
+#include "effectmask.h"
+#include "editsession.h"
+#include "autosavewriter.h"
+
 class DecolorizeEditor : public QDeclarativeItem
 {
     Q_OBJECT
 
-    Q_PROPERTY(int  mode       READ mode       WRITE setMode)
-    Q_PROPERTY(int  helperSize READ helperSize WRITE setHelperSize)
-    Q_PROPERTY(bool changed    READ changed)
+    Q_PROPERTY(int   mode          READ mode          WRITE setMode)
+    Q_PROPERTY(int   helperSize    READ helperSize    WRITE setHelperSize)
+    Q_PROPERTY(int   brushSize     READ brushSize     WRITE setBrushSize)
+    Q_PROPERTY(qreal brushHardness READ brushHardness WRITE setBrushHardness)
+    Q_PROPERTY(bool  changed       READ changed)
 
     Q_ENUMS(Mode)
     Q_ENUMS(MouseState)
@@ -30,12 +39,19 @@ public:
     int  helperSize() const;
     void setHelperSize(const int &size);
 
+    int  brushSize() const;
+    void setBrushSize(const int &size);
+
+    qreal brushHardness() const;
+    void  setBrushHardness(const qreal &hardness);
+
     bool changed() const;
 
     Q_INVOKABLE void openImage(const QString &image_url);
     Q_INVOKABLE void saveImage(const QString &image_url);
 
     Q_INVOKABLE void undo();
+    Q_INVOKABLE void discard();
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*);
 
@@ -73,18 +89,29 @@ protected:
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
 
 private:
+    EditSession MakeSession() const;
+
+    bool ResumeSession(const QString &image_file);
+    void SaveSession();
     void SaveUndoImage();
     void ChangeImageAt(bool save_undo, int center_x, int center_y);
 
-    static const int UNDO_DEPTH  = 4,
-                     BRUSH_SIZE  = 16;
-
-    static const qreal IMAGE_MPIX_LIMIT = 1.0;
-
-    bool           IsChanged;
-    int            CurrentMode, HelperSize;
-    QImage         LoadedImage, OriginalImage, EffectedImage, CurrentImage;
-    QStack<QImage> UndoStack;
+    static const int UNDO_DEPTH         = 4,
+                     DEFAULT_BRUSH_SIZE = 16;
+
+    static const qreal IMAGE_MPIX_LIMIT       = 1.0,
+                       DEFAULT_BRUSH_HARDNESS = 1.0;
+
+    bool               IsChanged;
+    int                CurrentMode, HelperSize, BrushSize;
+    qreal              BrushHardness;
+    QString            SourceFile;
+    QImage             LoadedImage, OriginalImage, EffectedImage;
+    EffectMask         CurrentMask;
+    QStack<EffectMask> UndoStack;
+    TilePyramid        DisplayPyramid;
+    RepaintCoalescer   *Repainter;
+    AutosaveWriter     *Autosaver;
 };
 
 class GrayscaleImageGenerator : public QObject
@@ -0,0 +1,520 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QDesktopServices>
+
+#include "editsession.h"
+#include "tracer.h"
+
+static bool IsUniformTile(const QImage &tile, uint *value)
+{
+    if (tile.depth() == 8) {
+        const uchar first = tile.constScanLine(0)[0];
+
+        for (int y = 0; y < tile.height(); y++) {
+            const uchar *line = tile.constScanLine(y);
+
+            for (int x = 0; x < tile.width(); x++) {
+                if (line[x] != first) {
+                    return false;
+                }
+            }
+        }
+
+        *value = first;
+
+        return true;
+    } else if (tile.depth() == 16) {
+        const quint16 first = ((const quint16 *)tile.constScanLine(0))[0];
+
+        for (int y = 0; y < tile.height(); y++) {
+            const quint16 *line = (const quint16 *)tile.constScanLine(y);
+
+            for (int x = 0; x < tile.width(); x++) {
+                if (line[x] != first) {
+                    return false;
+                }
+            }
+        }
+
+        *value = first;
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+EditSession::EditSession()
+{
+    SourceSize     = 0;
+    SourceModified = 0;
+}
+
+QString EditSession::editor() const
+{
+    return Editor;
+}
+
+void EditSession::setEditor(const QString &editor)
+{
+    Editor = editor;
+}
+
+QString EditSession::sourceFile() const
+{
+    return SourceFile;
+}
+
+void EditSession::setSourceFile(const QString &file_name)
+{
+    QFileInfo file_info(file_name);
+
+    SourceFile     = file_info.absoluteFilePath();
+    SourceSize     = file_info.size();
+    SourceModified = file_info.lastModified().toTime_t();
+}
+
+bool EditSession::sourceUnchanged() const
+{
+    QFileInfo file_info(SourceFile);
+
+    return file_info.exists() && file_info.size() == SourceSize && file_info.lastModified().toTime_t() == SourceModified;
+}
+
+int EditSession::parameter(const QString &name, int default_value) const
+{
+    return Parameters.value(name, default_value);
+}
+
+void EditSession::setParameter(const QString &name, int value)
+{
+    Parameters.insert(name, value);
+}
+
+QStringList EditSession::imageNames() const
+{
+    return Images.keys();
+}
+
+bool EditSession::hasImage(const QString &name) const
+{
+    return Images.contains(name);
+}
+
+TiledImage EditSession::image(const QString &name) const
+{
+    return Images.value(name);
+}
+
+void EditSession::setImage(const QString &name, const TiledImage &image)
+{
+    Images.insert(name, image);
+}
+
+QList<TiledImage> EditSession::journal() const
+{
+    return Journal;
+}
+
+void EditSession::setJournal(const QList<TiledImage> &journal)
+{
+    Journal = journal;
+}
+
+void EditSession::clear()
+{
+    Editor         = QString();
+    SourceFile     = QString();
+    SourceSize     = 0;
+    SourceModified = 0;
+
+    Parameters.clear();
+    Images.clear();
+    Journal.clear();
+}
+
+bool EditSession::save(const QString &file_name) const
+{
+    TRACE_SCOPE("EditSession::save");
+
+    QList<TiledImage> images = Images.values() + Journal;
+
+    // Uniform tiles are stored as their negated value, shared tiles once
+
+    QList<QVector<qint32> > tile_refs;
+    QList<QImage>           stored_tiles;
+    QVector<qint64>         tile_offsets;
+    QHash<qint64, int>      tile_indices;
+    qint64                  data_size = 0;
+
+    for (int i = 0; i < images.size(); i++) {
+        const TiledImage &image = images.at(i);
+        QVector<qint32>   refs;
+
+        for (int tile_y = 0; tile_y < image.tileRows(); tile_y++) {
+            for (int tile_x = 0; tile_x < image.tileColumns(); tile_x++) {
+                const QImage &tile = image.tile(tile_x, tile_y);
+                uint          value;
+
+                if (IsUniformTile(tile, &value)) {
+                    refs.append(-(qint32)value - 1);
+                } else {
+                    if (!tile_indices.contains(tile.cacheKey())) {
+                        tile_indices.insert(tile.cacheKey(), stored_tiles.size());
+                        tile_offsets.append(data_size);
+                        stored_tiles.append(tile);
+
+                        data_size += tile.width() * tile.height() * (tile.depth() / 8);
+                    }
+
+                    refs.append(tile_indices.value(tile.cacheKey()));
+                }
+            }
+        }
+
+        tile_refs.append(refs);
+    }
+
+    if (file_name.isEmpty() || !QDir().mkpath(QFileInfo(file_name).absolutePath())) {
+        return false;
+    }
+
+    QString temp_file_name = file_name + ".tmp";
+    QFile   file(temp_file_name);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    stream << SESSION_MAGIC << SESSION_VERSION;
+    stream << Editor << SourceFile << SourceSize << SourceModified << Parameters;
+    stream << QStringList(Images.keys()) << (qint32)Journal.size();
+
+    for (int i = 0; i < images.size(); i++) {
+        stream << (qint32)images.at(i).format() << (qint32)images.at(i).width() << (qint32)images.at(i).height() << tile_refs.at(i);
+    }
+
+    stream << tile_offsets;
+
+    qint64 data_start = (file.pos() + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    bool   success    = stream.status() == QDataStream::Ok && file.seek(data_start);
+
+    for (int i = 0; i < stored_tiles.size() && success; i++) {
+        const QImage &tile       = stored_tiles.at(i);
+        int           line_bytes = tile.width() * (tile.depth() / 8);
+
+        for (int y = 0; y < tile.height() && success; y++) {
+            success = file.write((const char *)tile.constScanLine(y), line_bytes) == line_bytes;
+        }
+    }
+
+    file.close();
+
+    if (success && file.error() == QFile::NoError) {
+        QFile::remove(file_name);
+        QFile::remove(JournalFileFor(file_name));
+
+        return QFile::rename(temp_file_name, file_name);
+    } else {
+        QFile::remove(temp_file_name);
+
+        return false;
+    }
+}
+
+bool EditSession::load(const QString &file_name)
+{
+    TRACE_SCOPE("EditSession::load");
+
+    clear();
+
+    QFile file(file_name);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32     magic   = 0;
+    quint32     version = 0;
+
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    stream >> magic >> version;
+
+    if (magic != SESSION_MAGIC || version != SESSION_VERSION) {
+        return false;
+    }
+
+    QStringList             names;
+    qint32                  journal_size = 0;
+    QList<qint32>           formats, widths, heights;
+    QList<QVector<qint32> > tile_refs;
+    QVector<qint64>         tile_offsets;
+
+    stream >> Editor >> SourceFile >> SourceSize >> SourceModified >> Parameters;
+    stream >> names >> journal_size;
+
+    for (int i = 0; i < names.size() + journal_size && stream.status() == QDataStream::Ok; i++) {
+        qint32          format, width, height;
+        QVector<qint32> refs;
+
+        stream >> format >> width >> height >> refs;
+
+        formats.append(format);
+        widths.append(width);
+        heights.append(height);
+        tile_refs.append(refs);
+    }
+
+    stream >> tile_offsets;
+
+    if (stream.status() != QDataStream::Ok) {
+        clear();
+
+        return false;
+    }
+
+    qint64 data_start = (file.pos() + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+
+    QVector<QImage>        stored_tiles(tile_offsets.size());
+    QHash<quint64, QImage> uniform_tiles;
+    bool                   valid = true;
+
+    for (int i = 0; i < tile_refs.size() && valid; i++) {
+        QImage::Format format  = (QImage::Format)formats.at(i);
+        int            width   = widths.at(i);
+        int            height  = heights.at(i);
+        int            tiles_x = (width  + TiledImage::TILE_SIZE - 1) / TiledImage::TILE_SIZE;
+        int            tiles_y = (height + TiledImage::TILE_SIZE - 1) / TiledImage::TILE_SIZE;
+
+        const QVector<qint32> &refs = tile_refs.at(i);
+
+        if ((format != QImage::Format_RGB16 && format != QImage::Format_Indexed8) || width < 0 || height < 0 ||
+            refs.size() != tiles_x * tiles_y) {
+            valid = false;
+
+            break;
+        }
+
+        int             bytes_per_pixel = (format == QImage::Format_RGB16 ? 2 : 1);
+        QVector<QImage> tiles;
+
+        for (int tile_y = 0; tile_y < tiles_y && valid; tile_y++) {
+            for (int tile_x = 0; tile_x < tiles_x && valid; tile_x++) {
+                int    tile_width  = qMin((int)TiledImage::TILE_SIZE, width  - tile_x * TiledImage::TILE_SIZE);
+                int    tile_height = qMin((int)TiledImage::TILE_SIZE, height - tile_y * TiledImage::TILE_SIZE);
+                qint32 ref         = refs.at(tile_y * tiles_x + tile_x);
+
+                if (ref < 0) {
+                    uint    value = -(ref + 1);
+                    quint64 key   = ((quint64)value << 32) | (format << 16) | (tile_width << 8) | tile_height;
+
+                    if (!uniform_tiles.contains(key)) {
+                        QImage tile(tile_width, tile_height, format);
+
+                        tile.fill(value);
+
+                        uniform_tiles.insert(key, tile);
+                    }
+
+                    tiles.append(uniform_tiles.value(key));
+                } else if (ref < stored_tiles.size() &&
+                           data_start + tile_offsets.at(ref) + tile_width * tile_height * bytes_per_pixel <= file.size()) {
+                    QImage &tile = stored_tiles[ref];
+
+                    if (tile.isNull()) {
+                        int line_bytes = tile_width * bytes_per_pixel;
+
+                        tile  = QImage(tile_width, tile_height, format);
+                        valid = file.seek(data_start + tile_offsets.at(ref));
+
+                        if (tile.bytesPerLine() == line_bytes) {
+                            valid = valid && file.read((char *)tile.bits(), line_bytes * tile_height) == line_bytes * tile_height;
+                        } else {
+                            for (int y = 0; y < tile_height && valid; y++) {
+                                valid = file.read((char *)tile.scanLine(y), line_bytes) == line_bytes;
+                            }
+                        }
+                    }
+
+                    tiles.append(tile);
+                } else {
+                    valid = false;
+                }
+            }
+        }
+
+        if (valid) {
+            TiledImage image(QSize(width, height), format, tiles);
+
+            if (i < names.size()) {
+                Images.insert(names.at(i), image);
+            } else {
+                Journal.append(image);
+            }
+        }
+    }
+
+    if (!valid) {
+        clear();
+
+        return false;
+    }
+
+    // Replay stops at the first record cut short by a crash
+
+    QFile journal_file(JournalFileFor(file_name));
+
+    if (journal_file.open(QIODevice::ReadOnly)) {
+        QDataStream journal(&journal_file);
+
+        journal.setVersion(QDataStream::Qt_4_7);
+
+        while (!journal.atEnd()) {
+            QByteArray record;
+
+            journal >> record;
+
+            if (journal.status() != QDataStream::Ok || !ReplayRecord(record)) {
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+QString EditSession::FileFor(const QString &source_file)
+{
+    QString    cache_dir = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+    QByteArray hash      = QCryptographicHash::hash(QFileInfo(source_file).absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex();
+
+    if (cache_dir.isEmpty()) {
+        return QString();
+    }
+
+    return QDir(cache_dir).filePath(QString("magicphotos-%1.session").arg(QString::fromLatin1(hash)));
+}
+
+void EditSession::Remove(const QString &source_file)
+{
+    QString file_name = FileFor(source_file);
+
+    if (!file_name.isEmpty()) {
+        QFile::remove(file_name);
+        QFile::remove(JournalFileFor(file_name));
+    }
+}
+
+bool EditSession::AppendJournal(const QString &file_name, const QString &name, const TiledImage &image, const QVector<qint32> &tiles)
+{
+    TRACE_SCOPE("EditSession::AppendJournal");
+
+    // Record: name, format, size, tile indices and raw tiles, in one write
+
+    QByteArray  record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    stream << JOURNAL_MAGIC << name << (qint32)image.format() << (qint32)image.width() << (qint32)image.height() << tiles;
+
+    for (int i = 0; i < tiles.size(); i++) {
+        if (tiles.at(i) < 0 || tiles.at(i) >= image.tileCount()) {
+            return false;
+        }
+
+        const QImage &tile       = image.tile(tiles.at(i) % image.tileColumns(), tiles.at(i) / image.tileColumns());
+        int           line_bytes = tile.width() * (tile.depth() / 8);
+
+        for (int y = 0; y < tile.height(); y++) {
+            stream.writeRawData((const char *)tile.constScanLine(y), line_bytes);
+        }
+    }
+
+    QFile file(JournalFileFor(file_name));
+
+    if (file_name.isEmpty() || !file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+
+    out.setVersion(QDataStream::Qt_4_7);
+
+    out << record;
+
+    file.close();
+
+    return out.status() == QDataStream::Ok && file.error() == QFile::NoError;
+}
+
+QString EditSession::JournalFileFor(const QString &file_name)
+{
+    return file_name + ".journal";
+}
+
+bool EditSession::ReplayRecord(const QByteArray &record)
+{
+    QDataStream     stream(record);
+    quint32         magic = 0;
+    QString         name;
+    qint32          format, width, height;
+    QVector<qint32> tiles;
+
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    stream >> magic >> name >> format >> width >> height >> tiles;
+
+    if (stream.status() != QDataStream::Ok || magic != JOURNAL_MAGIC || !Images.contains(name)) {
+        return false;
+    }
+
+    TiledImage image = Images.value(name);
+
+    if (image.format() != format || image.width() != width || image.height() != height) {
+        return false;
+    }
+
+    QVector<QImage> image_tiles;
+
+    for (int tile_y = 0; tile_y < image.tileRows(); tile_y++) {
+        for (int tile_x = 0; tile_x < image.tileColumns(); tile_x++) {
+            image_tiles.append(image.tile(tile_x, tile_y));
+        }
+    }
+
+    for (int i = 0; i < tiles.size(); i++) {
+        if (tiles.at(i) < 0 || tiles.at(i) >= image_tiles.size()) {
+            return false;
+        }
+
+        const QImage &old_tile   = image_tiles.at(tiles.at(i));
+        QImage        tile(old_tile.width(), old_tile.height(), old_tile.format());
+        int           line_bytes = tile.width() * (tile.depth() / 8);
+
+        for (int y = 0; y < tile.height(); y++) {
+            if (stream.readRawData((char *)tile.scanLine(y), line_bytes) != line_bytes) {
+                return false;
+            }
+        }
+
+        image_tiles[tiles.at(i)] = tile;
+    }
+
+    Images.insert(name, TiledImage(image.size(), image.format(), image_tiles));
+
+    return true;
+}
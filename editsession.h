@@ -0,0 +1,72 @@
+#ifndef EDITSESSION_H
+#define EDITSESSION_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QMap>
+#include <QList>
+#include <QVector>
+#include <QStringList>
+#include <QByteArray>
+#include <QImage>
+
+#include "tiledimage.h"
+
+// Snapshot of an editor's work: source file, effect parameters, named tiled
+// images and the undo journal. Tiles follow a page-aligned header, shared ones
+// once and uniform ones as a single value, and are read straight into their
+// images, as a QImage cannot keep a file mapping alive. Changed tiles go to a
+// journal that load() replays and save() discards; Remove() deletes both.
+
+class EditSession
+{
+public:
+    EditSession();
+
+    QString editor() const;
+    void    setEditor(const QString &editor);
+
+    QString sourceFile() const;
+    void    setSourceFile(const QString &file_name);
+    bool    sourceUnchanged() const;
+
+    int  parameter(const QString &name, int default_value = 0) const;
+    void setParameter(const QString &name, int value);
+
+    QStringList imageNames() const;
+    bool        hasImage(const QString &name) const;
+    TiledImage  image(const QString &name) const;
+    void        setImage(const QString &name, const TiledImage &image);
+
+    QList<TiledImage> journal() const;
+    void              setJournal(const QList<TiledImage> &journal);
+
+    void clear();
+
+    bool save(const QString &file_name) const;
+    bool load(const QString &file_name);
+
+    static QString FileFor(const QString &source_file);
+    static void    Remove(const QString &source_file);
+    static bool    AppendJournal(const QString &file_name, const QString &name, const TiledImage &image, const QVector<qint32> &tiles);
+
+private:
+    static QString JournalFileFor(const QString &file_name);
+
+    bool ReplayRecord(const QByteArray &record);
+
+    static const quint32 SESSION_MAGIC   = 0x4d505353,
+                         SESSION_VERSION = 1,
+                         JOURNAL_MAGIC   = 0x4d50534a;
+
+    static const int PAGE_SIZE = 4096;
+
+    QString                   Editor, SourceFile;
+    qint64                    SourceSize;
+    uint                      SourceModified;
+    QMap<QString, int>        Parameters;
+    QMap<QString, TiledImage> Images;
+    QList<TiledImage>         Journal;
+};
+
+#endif // EDITSESSION_H
@@ -0,0 +1,311 @@
+#include "editstack.h"
+#include "imagekernels.h"
+#include "effectpipeline.h"
+#include "tracer.h"
+
+EditStack::EditStack()
+{
+    TilesX = 0;
+    TilesY = 0;
+}
+
+void EditStack::setImage(const QImage &image)
+{
+    SourceImage = image.isNull() ? TiledImage() : TiledImage(ImageKernels::ToRGB16(image));
+    TilesX      = (SourceImage.width()  + TiledImage::TILE_SIZE - 1) / TiledImage::TILE_SIZE;
+    TilesY      = (SourceImage.height() + TiledImage::TILE_SIZE - 1) / TiledImage::TILE_SIZE;
+
+    for (int i = 0; i < Stages.size(); i++) {
+        Stage &stage = Stages[i];
+
+        stage.Mask   = EffectMask(SourceImage.size());
+        stage.Output = TiledImage(SourceImage.size(), QImage::Format_RGB16, 0);
+        stage.Dirty  = QVector<bool>(TilesX * TilesY, true);
+    }
+}
+
+bool EditStack::isNull() const
+{
+    return SourceImage.isNull();
+}
+
+QSize EditStack::size() const
+{
+    return SourceImage.size();
+}
+
+int EditStack::stageCount() const
+{
+    return Stages.size();
+}
+
+int EditStack::stageEffect(int stage) const
+{
+    return Stages.at(stage).Effect;
+}
+
+int EditStack::addStage(int effect)
+{
+    Stage stage;
+
+    stage.Effect    = effect;
+    stage.Radius    = DEFAULT_RADIUS;
+    stage.Threshold = DEFAULT_THRESHOLD;
+    stage.PixDenom  = DEFAULT_PIX_DENOM;
+    stage.Smoothing = DEFAULT_SMOOTHING;
+    stage.Shape     = DEFAULT_SHAPE;
+    stage.Style     = DEFAULT_STYLE;
+    stage.Mask      = EffectMask(SourceImage.size());
+    stage.Output    = TiledImage(SourceImage.size(), QImage::Format_RGB16, 0);
+    stage.Dirty     = QVector<bool>(TilesX * TilesY, true);
+
+    Stages.append(stage);
+
+    return Stages.size() - 1;
+}
+
+void EditStack::removeStage(int stage)
+{
+    Stages.removeAt(stage);
+
+    if (stage < Stages.size()) {
+        Invalidate(stage, SourceImage.rect());
+    }
+}
+
+int EditStack::parameter(int stage, int parameter) const
+{
+    if (parameter == ParameterRadius) {
+        return Stages.at(stage).Radius;
+    } else if (parameter == ParameterThreshold) {
+        return Stages.at(stage).Threshold;
+    } else if (parameter == ParameterPixDenom) {
+        return Stages.at(stage).PixDenom;
+    } else if (parameter == ParameterSmoothing) {
+        return Stages.at(stage).Smoothing;
+    } else if (parameter == ParameterShape) {
+        return Stages.at(stage).Shape;
+    } else if (parameter == ParameterStyle) {
+        return Stages.at(stage).Style;
+    } else {
+        return 0;
+    }
+}
+
+void EditStack::setParameter(int stage, int parameter, int value)
+{
+    if (this->parameter(stage, parameter) != value) {
+        if (parameter == ParameterRadius) {
+            Stages[stage].Radius = value;
+        } else if (parameter == ParameterThreshold) {
+            Stages[stage].Threshold = value;
+        } else if (parameter == ParameterPixDenom) {
+            Stages[stage].PixDenom = value;
+        } else if (parameter == ParameterSmoothing) {
+            Stages[stage].Smoothing = value;
+        } else if (parameter == ParameterShape) {
+            Stages[stage].Shape = value;
+        } else if (parameter == ParameterStyle) {
+            Stages[stage].Style = value;
+        }
+
+        Invalidate(stage, SourceImage.rect());
+    }
+}
+
+const EffectMask &EditStack::mask(int stage) const
+{
+    return Stages.at(stage).Mask;
+}
+
+void EditStack::setMask(int stage, const EffectMask &mask)
+{
+    Stages[stage].Mask = mask;
+
+    Invalidate(stage, SourceImage.rect());
+}
+
+void EditStack::stampMask(int stage, const BrushMask &brush_mask, const QPoint &center, int weight)
+{
+    int radius = brush_mask.radius();
+
+    Stages[stage].Mask.stamp(brush_mask, center, weight);
+
+    Invalidate(stage, QRect(center.x() - radius, center.y() - radius, radius * 2 + 1, radius * 2 + 1));
+}
+
+int EditStack::dirtyTiles(int stage) const
+{
+    return Stages.at(stage).Dirty.count(true);
+}
+
+QImage EditStack::render(const QRect &rect)
+{
+    TRACE_SCOPE("EditStack::render");
+
+    if (Stages.isEmpty()) {
+        return SourceImage.copy(rect);
+    }
+
+    Evaluate(Stages.size() - 1, rect);
+
+    return Stages.last().Output.copy(rect);
+}
+
+QImage EditStack::render()
+{
+    return render(SourceImage.rect());
+}
+
+void EditStack::Invalidate(int stage, const QRect &rect)
+{
+    const int tile_size = TiledImage::TILE_SIZE;
+
+    QRect area = rect.intersected(SourceImage.rect());
+
+    // A change spreads downstream by the reach of every later effect
+
+    for (int i = stage; i < Stages.size() && !area.isEmpty(); i++) {
+        if (i != stage) {
+            area = Reach(Stages.at(i), area);
+        }
+
+        QVector<bool> &dirty = Stages[i].Dirty;
+
+        for (int tile_y = area.top() / tile_size; tile_y <= area.bottom() / tile_size; tile_y++) {
+            for (int tile_x = area.left() / tile_size; tile_x <= area.right() / tile_size; tile_x++) {
+                dirty[tile_y * TilesX + tile_x] = true;
+            }
+        }
+    }
+}
+
+void EditStack::Evaluate(int stage, const QRect &rect)
+{
+    TRACE_SCOPE("EditStack::Evaluate");
+
+    const int tile_size = TiledImage::TILE_SIZE;
+
+    Stage &current = Stages[stage];
+    QRect  area    = rect.intersected(SourceImage.rect());
+
+    if (area.isEmpty()) {
+        return;
+    }
+
+    // Dirty tiles are recomputed in horizontal runs that share their margins
+
+    for (int tile_y = area.top() / tile_size; tile_y <= area.bottom() / tile_size; tile_y++) {
+        int tile_x = area.left() / tile_size;
+
+        while (tile_x <= area.right() / tile_size) {
+            if (!current.Dirty.at(tile_y * TilesX + tile_x)) {
+                tile_x++;
+
+                continue;
+            }
+
+            int run_end = tile_x;
+
+            while (run_end < area.right() / tile_size && current.Dirty.at(tile_y * TilesX + run_end + 1)) {
+                run_end++;
+            }
+
+            QRect tiles_rect = QRect(tile_x * tile_size, tile_y * tile_size,
+                                     (run_end - tile_x + 1) * tile_size, tile_size).intersected(SourceImage.rect());
+            QRect input_rect = Reach(current, tiles_rect);
+
+            if (stage > 0) {
+                Evaluate(stage - 1, input_rect);
+            }
+
+            QImage original_image = Input(stage).copy(input_rect);
+            QImage effected_image = original_image;
+
+            Apply(current, input_rect, effected_image);
+
+            current.Output.paste(tiles_rect.topLeft(),
+                                 current.Mask.composite(original_image, effected_image, input_rect.topLeft(), tiles_rect));
+
+            for (int x = tile_x; x <= run_end; x++) {
+                current.Dirty[tile_y * TilesX + x] = false;
+            }
+
+            tile_x = run_end + 1;
+        }
+    }
+}
+
+QRect EditStack::Reach(const Stage &stage, const QRect &rect) const
+{
+    QRect reach = rect;
+
+    if (stage.Effect == EffectSketch && stage.Style == ImageKernels::StyleSobel) {
+        int margin = EffectPipeline::SobelReach(ImageKernels::LineRadius(stage.Radius));
+
+        reach = rect.adjusted(-margin, -margin, margin, margin);
+    } else if (stage.Effect == EffectSketch && stage.Style == ImageKernels::StyleDoG) {
+        int margin = EffectPipeline::DifferenceOfGaussiansReach(ImageKernels::LineRadius(stage.Radius));
+
+        reach = rect.adjusted(-margin, -margin, margin, margin);
+    } else if (stage.Effect == EffectSketch || stage.Effect == EffectBlur) {
+        int margin = EffectPipeline::BlurReach(stage.Radius);
+
+        reach = rect.adjusted(-margin, -margin, margin, margin);
+    } else if (stage.Effect == EffectCartoon) {
+        // Cut where the weights drop below half a level
+
+        int margin = (stage.Smoothing == ImageKernels::SmoothingBilateral ? EffectPipeline::BilateralReach(stage.Radius) :
+                                                                             EffectPipeline::BlurReach(stage.Radius)) + 1;
+
+        reach = rect.adjusted(-margin, -margin, margin, margin);
+    } else if (stage.Effect == EffectPixelate) {
+        int pix_size = PixelSize(stage);
+
+        // Hexagons and triangles straddle the block grid
+
+        if (pix_size > 0 && (stage.Shape == CellMap::ShapeHexagon || stage.Shape == CellMap::ShapeTriangle)) {
+            int margin = CellMap::Reach(stage.Shape, pix_size);
+
+            reach = rect.adjusted(-margin, -margin, margin, margin);
+        } else if (pix_size > 0) {
+            reach = QRect(QPoint(rect.left() / pix_size * pix_size,
+                                 rect.top()  / pix_size * pix_size),
+                          QPoint((rect.right()  / pix_size + 1) * pix_size - 1,
+                                 (rect.bottom() / pix_size + 1) * pix_size - 1));
+        }
+    }
+
+    return reach.intersected(SourceImage.rect());
+}
+
+int EditStack::PixelSize(const Stage &stage) const
+{
+    // Blocks are aligned on the whole image, as in the pixelate editor
+
+    return stage.PixDenom > 0 ? qMax(SourceImage.width(), SourceImage.height()) / stage.PixDenom : 0;
+}
+
+void EditStack::Apply(const Stage &stage, const QRect &rect, QImage &image) const
+{
+    if (stage.Effect == EffectDecolorize) {
+        ImageKernels::Grayscale(image);
+    } else if (stage.Effect == EffectSketch) {
+        ImageKernels::Sketch(image, stage.Radius, stage.Style);
+    } else if (stage.Effect == EffectCartoon) {
+        ImageKernels::Cartoon(image, stage.Radius, stage.Threshold, stage.Smoothing);
+    } else if (stage.Effect == EffectBlur) {
+        ImageKernels::Blur(image, stage.Radius);
+    } else if (stage.Effect == EffectPixelate && stage.Shape == CellMap::ShapeSquare) {
+        EffectPipeline().blockAverage(PixelSize(stage)).run(image);
+    } else if (stage.Effect == EffectPixelate) {
+        // Crop maps are built for the occasion rather than cached
+
+        EffectPipeline().cellAverage(CellMap(stage.Shape, PixelSize(stage), rect)).run(image);
+    }
+}
+
+const TiledImage &EditStack::Input(int stage) const
+{
+    return stage == 0 ? SourceImage : Stages.at(stage - 1).Output;
+}
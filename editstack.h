@@ -0,0 +1,94 @@
+#ifndef EDITSTACK_H
+#define EDITSTACK_H
+
+#include <QtGlobal>
+#include <QList>
+#include <QVector>
+#include <QSize>
+#include <QRect>
+#include <QPoint>
+#include <QImage>
+
+#include "tiledimage.h"
+#include "brushmask.h"
+#include "effectmask.h"
+#include "imagekernels.h"
+
+// Several effects applied to one RGB16 image in order, each through its own
+// weight mask. Stage outputs are tiles with a dirty flag each; render()
+// recomputes only the dirty tiles it needs.
+
+class EditStack
+{
+public:
+    EditStack();
+
+    enum Effect {
+        EffectDecolorize,
+        EffectSketch,
+        EffectCartoon,
+        EffectBlur,
+        EffectPixelate
+    };
+
+    enum Parameter {
+        ParameterRadius,
+        ParameterThreshold,
+        ParameterPixDenom,
+        ParameterSmoothing,
+        ParameterShape,
+        ParameterStyle
+    };
+
+    void setImage(const QImage &image);
+
+    bool  isNull() const;
+    QSize size() const;
+
+    int  stageCount() const;
+    int  stageEffect(int stage) const;
+    int  addStage(int effect);
+    void removeStage(int stage);
+
+    int  parameter(int stage, int parameter) const;
+    void setParameter(int stage, int parameter, int value);
+
+    const EffectMask &mask(int stage) const;
+    void              setMask(int stage, const EffectMask &mask);
+    void              stampMask(int stage, const BrushMask &brush_mask, const QPoint &center, int weight);
+
+    int dirtyTiles(int stage) const;
+
+    QImage render(const QRect &rect);
+    QImage render();
+
+private:
+    struct Stage
+    {
+        int           Effect, Radius, Threshold, PixDenom, Smoothing, Shape, Style;
+        EffectMask    Mask;
+        TiledImage    Output;
+        QVector<bool> Dirty;
+    };
+
+    void  Invalidate(int stage, const QRect &rect);
+    void  Evaluate(int stage, const QRect &rect);
+    QRect Reach(const Stage &stage, const QRect &rect) const;
+    int   PixelSize(const Stage &stage) const;
+    void  Apply(const Stage &stage, const QRect &rect, QImage &image) const;
+
+    const TiledImage &Input(int stage) const;
+
+    static const int DEFAULT_RADIUS    = 11,
+                     DEFAULT_THRESHOLD = 80,
+                     DEFAULT_PIX_DENOM = 112,
+                     DEFAULT_SMOOTHING = ImageKernels::SmoothingGaussian,
+                     DEFAULT_SHAPE     = CellMap::ShapeSquare,
+                     DEFAULT_STYLE     = ImageKernels::StyleDodge;
+
+    int          TilesX, TilesY;
+    TiledImage   SourceImage;
+    QList<Stage> Stages;
+};
+
+#endif // EDITSTACK_H
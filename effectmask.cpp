@@ -0,0 +1,111 @@
+#include "effectmask.h"
+
+EffectMask::EffectMask()
+{
+}
+
+EffectMask::EffectMask(const QSize &size) : Weights(size, QImage::Format_Indexed8, BrushMask::MAX_WEIGHT)
+{
+}
+
+EffectMask::EffectMask(const TiledImage &weights) : Weights(weights)
+{
+}
+
+bool EffectMask::isNull() const
+{
+    return Weights.isNull();
+}
+
+int EffectMask::width() const
+{
+    return Weights.width();
+}
+
+int EffectMask::height() const
+{
+    return Weights.height();
+}
+
+const TiledImage &EffectMask::weights() const
+{
+    return Weights;
+}
+
+void EffectMask::stamp(const BrushMask &mask, const QPoint &center, int weight)
+{
+    if (isNull() || mask.isNull()) {
+        return;
+    }
+
+    const int tile_size = TiledImage::TILE_SIZE;
+
+    for (int dy = -mask.radius(); dy <= mask.radius(); dy++) {
+        int y = center.y() + dy;
+
+        if (y >= 0 && y < Weights.height()) {
+            int from_x = qMax(center.x() - mask.halfWidth(dy), 0);
+            int to_x   = qMin(center.x() + mask.halfWidth(dy), Weights.width() - 1);
+
+            const quint8 *brush = mask.weights(dy) - center.x();
+
+            while (from_x <= to_x) {
+                int tile_x    = from_x / tile_size;
+                int tile_left = tile_x * tile_size;
+                int span_end  = qMin(to_x, tile_left + tile_size - 1);
+
+                quint8 *line = Weights.scanLine(tile_x, y) - tile_left;
+
+                for (int x = from_x; x <= span_end; x++) {
+                    line[x] += (weight - line[x]) * brush[x] / BrushMask::MAX_WEIGHT;
+                }
+
+                from_x = span_end + 1;
+            }
+        }
+    }
+}
+
+QImage EffectMask::composite(const QImage &original_image, const QImage &effected_image, const QRect &rect) const
+{
+    return composite(original_image, effected_image, QPoint(0, 0), rect);
+}
+
+// Both sources start at origin, so a crop composites without a full-size copy
+
+QImage EffectMask::composite(const QImage &original_image, const QImage &effected_image, const QPoint &origin, const QRect &rect) const
+{
+    QImage image(rect.size(), QImage::Format_RGB16);
+
+    if (image.isNull()) {
+        return image;
+    }
+
+    image.fill(0);
+
+    QRect area = rect.intersected(QRect(0, 0, Weights.width(), Weights.height()))
+                     .intersected(QRect(origin, original_image.size()));
+
+    if (!area.isEmpty()) {
+        const int tile_size = TiledImage::TILE_SIZE;
+
+        for (int y = area.top(); y <= area.bottom(); y++) {
+            quint16       *dst = (quint16 *)image.scanLine(y - rect.top()) - rect.left();
+            const quint16 *org = (const quint16 *)original_image.constScanLine(y - origin.y()) - origin.x();
+            const quint16 *eff = (const quint16 *)effected_image.constScanLine(y - origin.y()) - origin.x();
+
+            for (int tile_x = area.left() / tile_size; tile_x <= area.right() / tile_size; tile_x++) {
+                int from_x = qMax(area.left(),  tile_x * tile_size);
+                int to_x   = qMin(area.right(), tile_x * tile_size + tile_size - 1);
+
+                const quint8 *weight = Weights.constScanLine(tile_x, y) - tile_x * tile_size;
+
+                for (int x = from_x; x <= to_x; x++) {
+                    dst[x] = BrushMask::Blend(eff[x], org[x], weight[x]);
+                }
+            }
+        }
+    }
+
+    return image;
+}
@@ -0,0 +1,38 @@
+#ifndef EFFECTMASK_H
+#define EFFECTMASK_H
+
+#include <QtGlobal>
+#include <QSize>
+#include <QRect>
+#include <QPoint>
+#include <QImage>
+
+#include "tiledimage.h"
+#include "brushmask.h"
+
+// Per-pixel weight of the effected image over the original one, kept in
+// copy-on-write 8-bit tiles, so an undo snapshot costs only the touched tiles.
+
+class EffectMask
+{
+public:
+    EffectMask();
+    explicit EffectMask(const QSize &size);
+    explicit EffectMask(const TiledImage &weights);
+
+    bool isNull() const;
+    int  width() const;
+    int  height() const;
+
+    const TiledImage &weights() const;
+
+    void stamp(const BrushMask &mask, const QPoint &center, int weight);
+
+    QImage composite(const QImage &original_image, const QImage &effected_image, const QRect &rect) const;
+    QImage composite(const QImage &original_image, const QImage &effected_image, const QPoint &origin, const QRect &rect) const;
+
+private:
+    TiledImage Weights;
+};
+
+#endif // EFFECTMASK_H
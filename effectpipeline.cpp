@@ -0,0 +1,929 @@
+#include <string.h>
+#include <qmath.h>
+
+#include "effectpipeline.h"
+#include "imagekernels.h"
+#include "effectscheduler.h"
+#include "tracer.h"
+
+EffectPipeline::EffectPipeline()
+{
+    Width  = 0;
+    Height = 0;
+}
+
+EffectPipeline &EffectPipeline::blur(int gaussian_radius)
+{
+    return Append(OpBlur, gaussian_radius);
+}
+
+EffectPipeline &EffectPipeline::bilateral(int gaussian_radius)
+{
+    return Append(OpBilateral, gaussian_radius);
+}
+
+EffectPipeline &EffectPipeline::luma()
+{
+    return Append(OpLuma);
+}
+
+EffectPipeline &EffectPipeline::invert()
+{
+    return Append(OpInvert);
+}
+
+EffectPipeline &EffectPipeline::quantize()
+{
+    return Append(OpQuantize);
+}
+
+EffectPipeline &EffectPipeline::dodge(int top_buffer)
+{
+    return Append(OpDodge, top_buffer);
+}
+
+EffectPipeline &EffectPipeline::edgeThreshold(int threshold)
+{
+    return Append(OpEdgeThreshold, threshold);
+}
+
+EffectPipeline &EffectPipeline::blockAverage(int block_size)
+{
+    return Append(OpBlockAverage, block_size);
+}
+
+EffectPipeline &EffectPipeline::cellAverage(const CellMap &cell_map)
+{
+    CellMaps.append(cell_map);
+
+    return Append(OpCellAverage, CellMaps.size() - 1);
+}
+
+EffectPipeline &EffectPipeline::sobel(int gaussian_radius)
+{
+    return Append(OpSobel, gaussian_radius);
+}
+
+EffectPipeline &EffectPipeline::differenceOfGaussians(int gaussian_radius)
+{
+    return Append(OpDifferenceOfGaussians, gaussian_radius);
+}
+
+EffectPipeline &EffectPipeline::store(int buffer)
+{
+    return Append(OpStore, buffer);
+}
+
+EffectPipeline &EffectPipeline::load(int buffer)
+{
+    return Append(OpLoad, buffer);
+}
+
+int EffectPipeline::passCount() const
+{
+    int  passes    = 0;
+    bool in_strips = true;
+
+    for (int i = 0; i < Stages.size(); i++) {
+        if (!IsPerPixel(Stages.at(i).Op)) {
+            passes    = passes + (in_strips ? 2 : 1);
+            in_strips = false;
+        } else {
+            in_strips = true;
+        }
+    }
+
+    return passes + 1;
+}
+
+void EffectPipeline::run(QImage &image)
+{
+    TRACE_SCOPE("EffectPipeline::run");
+
+    Width  = image.width();
+    Height = image.height();
+
+    if (Width == 0 || Height == 0) {
+        return;
+    }
+
+    // Expansion and packing are per-pixel stages, so they fuse with their neighbours
+
+    QVector<Stage> stages;
+    Stage          expand = { OpExpand, 0 };
+    Stage          pack   = { OpPack,   0 };
+
+    stages.append(expand);
+    stages += Stages;
+    stages.append(pack);
+
+    int first = 0;
+
+    for (int i = 0; i < stages.size(); i++) {
+        const Stage &stage = stages.at(i);
+
+        if (!IsPerPixel(stage.Op)) {
+            if (i > first) {
+                RunStrips(stages, first, i, image);
+            }
+
+            EffectScheduler::Checkpoint();
+
+            if (stage.Op == OpBlur) {
+                RunBlur(stage.Param);
+            } else if (stage.Op == OpBilateral) {
+                RunBilateral(stage.Param);
+            } else if (stage.Op == OpEdgeThreshold) {
+                RunEdgeThreshold(stage.Param);
+            } else if (stage.Op == OpBlockAverage) {
+                RunBlockAverage(stage.Param);
+            } else if (stage.Op == OpCellAverage) {
+                RunCellAverage(CellMaps.at(stage.Param));
+            } else if (stage.Op == OpSobel) {
+                RunSobel(stage.Param);
+            } else if (stage.Op == OpDifferenceOfGaussians) {
+                RunDifferenceOfGaussians(stage.Param);
+            }
+
+            first = i + 1;
+        }
+    }
+
+    RunStrips(stages, first, stages.size(), image);
+}
+
+int EffectPipeline::BlurReach(int gaussian_radius)
+{
+    // Reach of the three box passes, so a blurred crop matches the full image
+
+    if (gaussian_radius < 1) {
+        return 0;
+    }
+
+    int box_radius[3];
+
+    BoxRadii(gaussian_radius, box_radius);
+
+    return box_radius[0] + box_radius[1] + box_radius[2];
+}
+
+int EffectPipeline::BilateralReach(int gaussian_radius)
+{
+    // Past this distance a source pixel weighs less than half a level
+
+    if (gaussian_radius < 1) {
+        return 0;
+    }
+
+    return qCeil(qLn(255.0 * 2.0) / -qLn(BilateralFeedback(gaussian_radius)));
+}
+
+int EffectPipeline::SobelReach(int gaussian_radius)
+{
+    return BlurReach(gaussian_radius) + 1;
+}
+
+int EffectPipeline::DifferenceOfGaussiansReach(int gaussian_radius)
+{
+    return BlurReach(OuterRadius(gaussian_radius));
+}
+
+bool EffectPipeline::IsPerPixel(Operation op)
+{
+    return op != OpBlur && op != OpBilateral && op != OpEdgeThreshold && op != OpBlockAverage &&
+           op != OpCellAverage && op != OpSobel && op != OpDifferenceOfGaussians;
+}
+
+EffectPipeline &EffectPipeline::Append(Operation op, int param)
+{
+    Stage stage = { op, param };
+
+    Stages.append(stage);
+
+    return *this;
+}
+
+quint8 *EffectPipeline::Buffer(int index)
+{
+    Q_ASSERT(index >= 0 && index < MAX_BUFFERS);
+
+    if (Buffers[index].size() != Width * Height * 3) {
+        Buffers[index].resize(Width * Height * 3);
+    }
+
+    return Buffers[index].data();
+}
+
+quint8 *EffectPipeline::Scratch(int size)
+{
+    if (ScratchBuffer.size() < size) {
+        ScratchBuffer.resize(size);
+    }
+
+    return ScratchBuffer.data();
+}
+
+void EffectPipeline::RunStrips(const QVector<Stage> &stages, int first, int last, QImage &image)
+{
+    int strip_height = qMax(STRIP_BYTES / (Width * 3), 1);
+
+    // A job of a higher class can cut in between strips
+
+    for (int from_y = 0; from_y < Height; from_y += strip_height) {
+        int to_y = qMin(from_y + strip_height, Height);
+
+        EffectScheduler::Checkpoint();
+
+        for (int i = first; i < last; i++) {
+            RunStage(stages.at(i), image, from_y, to_y);
+        }
+    }
+}
+
+void EffectPipeline::RunStage(const Stage &stage, QImage &image, int from_y, int to_y)
+{
+    int     count = (to_y - from_y) * Width;
+    quint8 *p     = Buffer(0) + from_y * Width * 3;
+
+    switch (stage.Op) {
+    case OpExpand:
+        for (int y = from_y; y < to_y; y++) {
+            const quint16 *src = (const quint16 *)image.constScanLine(y);
+
+            for (int x = 0; x < Width; x++, p += 3) {
+                p[0] = ImageKernels::Red(src[x]);
+                p[1] = ImageKernels::Green(src[x]);
+                p[2] = ImageKernels::Blue(src[x]);
+            }
+        }
+
+        break;
+    case OpPack:
+        for (int y = from_y; y < to_y; y++) {
+            quint16 *dst = (quint16 *)image.scanLine(y);
+
+            for (int x = 0; x < Width; x++, p += 3) {
+                dst[x] = ImageKernels::Pack(p[0], p[1], p[2]);
+            }
+        }
+
+        break;
+    case OpLuma:
+        for (int i = 0; i < count; i++, p += 3) {
+            int gray = (p[0] * 11 + p[1] * 16 + p[2] * 5) / 32;
+
+            p[0] = p[1] = p[2] = gray;
+        }
+
+        break;
+    case OpInvert:
+        for (int i = 0; i < count * 3; i++) {
+            p[i] = 255 - p[i];
+        }
+
+        break;
+    case OpQuantize:
+        // Same as packing to RGB565 and expanding again
+
+        for (int i = 0; i < count; i++, p += 3) {
+            p[0] = (p[0] & 0xf8) | (p[0] >> 5);
+            p[1] = (p[1] & 0xfc) | (p[1] >> 6);
+            p[2] = (p[2] & 0xf8) | (p[2] >> 5);
+        }
+
+        break;
+    case OpDodge:
+        {
+            const quint8 *top = Buffer(stage.Param) + from_y * Width * 3;
+
+            for (int i = 0; i < count * 3; i++) {
+                p[i] = top[i] >= 255 ? 255 : qMin(p[i] * 255 / (255 - top[i]), 255);
+            }
+        }
+
+        break;
+    case OpStore:
+        memcpy(Buffer(stage.Param) + from_y * Width * 3, p, count * 3);
+
+        break;
+    case OpLoad:
+        memcpy(p, Buffer(stage.Param) + from_y * Width * 3, count * 3);
+
+        break;
+    default:
+        break;
+    }
+}
+
+void EffectPipeline::RunBlur(int gaussian_radius)
+{
+    if (gaussian_radius < 1) {
+        return;
+    }
+
+    // Three box blurs whose variances sum to that of the gaussian
+
+    int box_radius[3];
+
+    BoxRadii(gaussian_radius, box_radius);
+
+    quint8 *buf = Buffer(0);
+    quint8 *tmp = Scratch(Width * Height * 3);
+
+    for (int i = 0; i < 3; i++) {
+        BoxBlurHorizontal(buf, tmp, Width, Height, box_radius[i]);
+        BoxBlurVertical(tmp, buf, Width, Height, box_radius[i]);
+    }
+}
+
+void EffectPipeline::RunBilateral(int gaussian_radius)
+{
+    if (gaussian_radius < 1) {
+        return;
+    }
+
+    // Recursive bilateral filter: first-order recursions both ways along rows
+    // and columns, with the feedback cut by a range weight at color edges
+
+    float alpha = BilateralFeedback(gaussian_radius);
+    float feedback[256];
+
+    for (int d = 0; d < 256; d++) {
+        feedback[d] = alpha * qExp(-(qreal)(d * d) / (2 * BILATERAL_RANGE_SIGMA * BILATERAL_RANGE_SIGMA));
+    }
+
+    // Scratch: running sums and weights, the downward pass and one saved row
+
+    int      line_size       = Width * 3;
+    quint8  *buf             = Buffer(0);
+    quint8  *scratch         = Scratch(Width * 4 * sizeof(float) + Width * Height * (sizeof(quint16) + 3) + line_size);
+    float   *sums            = (float *)scratch;
+    float   *weights         = sums + line_size;
+    quint16 *forward_weights = (quint16 *)(weights + Width);
+    quint8  *forward         = (quint8 *)(forward_weights + Width * Height);
+    quint8  *guide           = forward + Width * Height * 3;
+
+    for (int y = 0; y < Height; y++) {
+        quint8 *p = buf + y * line_size;
+
+        sums[0]    = p[0];
+        sums[1]    = p[1];
+        sums[2]    = p[2];
+        weights[0] = 1.0f;
+
+        for (int x = 1; x < Width; x++) {
+            int   o = x * 3;
+            float a = feedback[Distance(p + o, p + o - 3)];
+
+            for (int i = 0; i < 3; i++) {
+                sums[o + i] = (1.0f - alpha) * p[o + i] + a * sums[o - 3 + i];
+            }
+
+            weights[x] = (1.0f - alpha) + a * weights[x - 1];
+        }
+
+        // Right to left, merged with the left to right sums
+
+        float  sum[3];
+        float  weight = 1.0f;
+        quint8 right[3];
+
+        for (int x = Width - 1; x >= 0; x--) {
+            int     o = x * 3;
+            quint8 *q = p + o;
+
+            if (x == Width - 1) {
+                sum[0] = q[0];
+                sum[1] = q[1];
+                sum[2] = q[2];
+            } else {
+                float a = feedback[Distance(q, right)];
+
+                for (int i = 0; i < 3; i++) {
+                    sum[i] = (1.0f - alpha) * q[i] + a * sum[i];
+                }
+
+                weight = (1.0f - alpha) + a * weight;
+            }
+
+            for (int i = 0; i < 3; i++) {
+                right[i] = q[i];
+                q[i]     = (sums[o + i] + sum[i]) / (weights[x] + weight) + 0.5f;
+            }
+        }
+    }
+
+    for (int y = 0; y < Height; y++) {
+        const quint8 *p = buf + y * line_size;
+        quint8       *f = forward + y * line_size;
+        quint16      *w = forward_weights + y * Width;
+
+        for (int x = 0; x < Width; x++) {
+            int o = x * 3;
+
+            if (y == 0) {
+                sums[o]     = p[o];
+                sums[o + 1] = p[o + 1];
+                sums[o + 2] = p[o + 2];
+                weights[x]  = 1.0f;
+            } else {
+                float a = feedback[Distance(p + o, p + o - line_size)];
+
+                for (int i = 0; i < 3; i++) {
+                    sums[o + i] = (1.0f - alpha) * p[o + i] + a * sums[o + i];
+                }
+
+                weights[x] = (1.0f - alpha) + a * weights[x];
+            }
+
+            for (int i = 0; i < 3; i++) {
+                f[o + i] = sums[o + i] / weights[x] + 0.5f;
+            }
+
+            w[x] = weights[x] * 65535.0f + 0.5f;
+        }
+    }
+
+    for (int y = Height - 1; y >= 0; y--) {
+        quint8        *p = buf + y * line_size;
+        const quint8  *f = forward + y * line_size;
+        const quint16 *w = forward_weights + y * Width;
+
+        for (int x = 0; x < Width; x++) {
+            int   o              = x * 3;
+            float forward_weight = w[x] / 65535.0f;
+
+            if (y == Height - 1) {
+                sums[o]     = p[o];
+                sums[o + 1] = p[o + 1];
+                sums[o + 2] = p[o + 2];
+                weights[x]  = 1.0f;
+            } else {
+                float a = feedback[Distance(p + o, guide + o)];
+
+                for (int i = 0; i < 3; i++) {
+                    sums[o + i] = (1.0f - alpha) * p[o + i] + a * sums[o + i];
+                }
+
+                weights[x] = (1.0f - alpha) + a * weights[x];
+            }
+
+            for (int i = 0; i < 3; i++) {
+                guide[o + i] = p[o + i];
+                p[o + i]     = (f[o + i] * forward_weight + sums[o + i]) / (forward_weight + weights[x]) + 0.5f;
+            }
+        }
+    }
+}
+
+void EffectPipeline::RunEdgeThreshold(int threshold)
+{
+    int     line_size = Width * 3;
+    quint8 *buf       = Buffer(0);
+
+    if (Width < 3 || Height < 3) {
+        memset(buf, 0, line_size * Height);
+
+        return;
+    }
+
+    // Rows are rewritten in place, so a ring of three row copies is kept
+
+    quint8 *prev = Scratch(line_size * 3);
+    quint8 *curr = prev + line_size;
+    quint8 *next = curr + line_size;
+
+    memcpy(prev, buf,             line_size);
+    memcpy(curr, buf + line_size, line_size);
+
+    for (int y = 1; y < Height - 1; y++) {
+        quint8 *dst = buf + y * line_size;
+
+        memcpy(next, dst + line_size, line_size);
+
+        for (int x = 1; x < Width - 1; x++) {
+            int o = x * 3;
+            int horz_grad = 0;
+            int vert_grad = 0;
+            int diag_grad = 0;
+
+            for (int i = 0; i < 3; i++) {
+                horz_grad += qAbs(curr[o + i - 3] - curr[o + i + 3]);
+                vert_grad += qAbs(prev[o + i]     - next[o + i]);
+                diag_grad += qAbs(prev[o + i - 3] - next[o + i + 3]) + qAbs(prev[o + i + 3] - next[o + i - 3]);
+            }
+
+            if (horz_grad + vert_grad > threshold ||
+                horz_grad             > threshold ||
+                vert_grad             > threshold ||
+                diag_grad             > threshold) {
+                dst[o] = dst[o + 1] = dst[o + 2] = 0;
+            }
+        }
+
+        memset(dst,                 0, 3);
+        memset(dst + line_size - 3, 0, 3);
+
+        quint8 *tmp = prev;
+
+        prev = curr;
+        curr = next;
+        next = tmp;
+    }
+
+    memset(buf,                            0, line_size);
+    memset(buf + (Height - 1) * line_size, 0, line_size);
+}
+
+void EffectPipeline::RunBlockAverage(int block_size)
+{
+    if (block_size <= 0) {
+        return;
+    }
+
+    int     blocks = Width / block_size + 1;
+    int    *sums   = (int *)Scratch(blocks * 3 * sizeof(int));
+    quint8 *buf    = Buffer(0);
+
+    for (int block_y = 0; block_y < Height; block_y += block_size) {
+        int block_height = qMin(block_size, Height - block_y);
+
+        memset(sums, 0, blocks * 3 * sizeof(int));
+
+        for (int y = block_y; y < block_y + block_height; y++) {
+            const quint8 *p = buf + y * Width * 3;
+
+            for (int x = 0; x < Width; x++, p += 3) {
+                int *sum = sums + (x / block_size) * 3;
+
+                sum[0] += p[0];
+                sum[1] += p[1];
+                sum[2] += p[2];
+            }
+        }
+
+        for (int y = block_y; y < block_y + block_height; y++) {
+            quint8 *p = buf + y * Width * 3;
+
+            for (int x = 0; x < Width; x++, p += 3) {
+                int  block  = x / block_size;
+                int  pixels = qMin(block_size, Width - block * block_size) * block_height;
+                int *sum    = sums + block * 3;
+
+                p[0] = sum[0] / pixels;
+                p[1] = sum[1] / pixels;
+                p[2] = sum[2] / pixels;
+            }
+        }
+    }
+}
+
+void EffectPipeline::RunCellAverage(const CellMap &cell_map)
+{
+    if (cell_map.isNull() || cell_map.area().size() != QSize(Width, Height)) {
+        return;
+    }
+
+    // Sum every cell, then paint each pixel with its cell's average
+
+    int     cells = cell_map.cellCount();
+    int    *sums  = (int *)Scratch(cells * 4 * sizeof(int));
+    quint8 *buf   = Buffer(0);
+
+    memset(sums, 0, cells * 4 * sizeof(int));
+
+    for (int y = 0; y < Height; y++) {
+        const qint32 *index = cell_map.indices(y);
+        const quint8 *p     = buf + y * Width * 3;
+
+        for (int x = 0; x < Width; x++, p += 3) {
+            int *sum = sums + (index[x] < 0 ? -index[x] - 1 : index[x]) * 4;
+
+            sum[0] += p[0];
+            sum[1] += p[1];
+            sum[2] += p[2];
+            sum[3]++;
+        }
+    }
+
+    for (int cell = 0; cell < cells; cell++) {
+        int *sum = sums + cell * 4;
+
+        if (sum[3] > 0) {
+            sum[0] = sum[0] / sum[3];
+            sum[1] = sum[1] / sum[3];
+            sum[2] = sum[2] / sum[3];
+        }
+    }
+
+    for (int y = 0; y < Height; y++) {
+        const qint32 *index = cell_map.indices(y);
+        quint8       *p     = buf + y * Width * 3;
+
+        for (int x = 0; x < Width; x++, p += 3) {
+            if (index[x] < 0) {
+                p[0] = 0;
+                p[1] = 0;
+                p[2] = 0;
+            } else {
+                const int *sum = sums + index[x] * 4;
+
+                p[0] = sum[0];
+                p[1] = sum[1];
+                p[2] = sum[2];
+            }
+        }
+    }
+}
+
+void EffectPipeline::RunSobel(int gaussian_radius)
+{
+    // Smoothed luma, then the Sobel gradient magnitude as dark lines on white
+
+    quint8 *plane = Scratch(Width * Height * 2);
+    quint8 *tmp   = plane + Width * Height;
+
+    RunPlanePass(PassLuma, Buffer(0), 0, plane);
+
+    BlurPlane(plane, tmp, gaussian_radius);
+
+    RunPlanePass(PassSobel, plane, 0, Buffer(0));
+}
+
+void EffectPipeline::RunDifferenceOfGaussians(int gaussian_radius)
+{
+    // Difference of the luma blurred at two scales 1.6 apart
+
+    quint8 *inner = Scratch(Width * Height * 3);
+    quint8 *outer = inner + Width * Height;
+    quint8 *tmp   = outer + Width * Height;
+
+    RunPlanePass(PassLuma, Buffer(0), 0, inner);
+
+    memcpy(outer, inner, Width * Height);
+
+    BlurPlane(inner, tmp, gaussian_radius);
+    BlurPlane(outer, tmp, OuterRadius(gaussian_radius));
+
+    RunPlanePass(PassDifference, inner, outer, Buffer(0));
+}
+
+void EffectPipeline::BlurPlane(quint8 *plane, quint8 *tmp, int gaussian_radius)
+{
+    if (gaussian_radius < 1) {
+        return;
+    }
+
+    int box_radius[3];
+
+    BoxRadii(gaussian_radius, box_radius);
+
+    for (int i = 0; i < 3; i++) {
+        RunPlanePass(PassBoxHorizontal, plane, 0, tmp,   box_radius[i]);
+        RunPlanePass(PassBoxVertical,   tmp,   0, plane, box_radius[i]);
+    }
+}
+
+void EffectPipeline::RunPlanePass(PlanePass pass, const quint8 *source, const quint8 *other, quint8 *target, int param)
+{
+    int strip_height = qMax(STRIP_BYTES / Width, 1);
+
+    QVector<int> column_sums(pass == PassBoxVertical ? Width : 0);
+
+    PlaneStrip strip;
+
+    strip.Pass   = pass;
+    strip.Width  = Width;
+    strip.Height = Height;
+    strip.Param  = param;
+    strip.Source = source;
+    strip.Other  = other;
+    strip.Target = target;
+    strip.Sums   = column_sums.data();
+
+    for (int from_y = 0; from_y < Height; from_y += strip_height) {
+        strip.FromY = from_y;
+        strip.ToY   = qMin(from_y + strip_height, Height);
+
+        EffectScheduler::Checkpoint();
+
+        RunPlaneStrip(strip);
+    }
+}
+
+void EffectPipeline::BoxRadii(int gaussian_radius, int *box_radius)
+{
+    // Boxes of odd widths w and w + 2 whose variances add up to the gaussian's
+
+    qreal variance = Sigma(gaussian_radius) * Sigma(gaussian_radius);
+    int   width    = qFloor(qSqrt(4.0 * variance + 1.0));
+
+    if (width % 2 == 0) {
+        width--;
+    }
+
+    int wider = qBound(0, qRound((12.0 * variance - 3 * (width * width - 1)) / (4 * width + 4)), 3);
+
+    for (int i = 0; i < 3; i++) {
+        box_radius[i] = (i < 3 - wider ? width - 1 : width + 1) / 2;
+    }
+}
+
+qreal EffectPipeline::Sigma(int gaussian_radius)
+{
+    // Matches the strength of the recursive blur the editors used before
+
+    return gaussian_radius * 5 / 8.0;
+}
+
+qreal EffectPipeline::BilateralFeedback(int gaussian_radius)
+{
+    // Decay matching a gaussian of the sigma blur() uses
+
+    return qExp(-M_SQRT2 / Sigma(gaussian_radius));
+}
+
+int EffectPipeline::Distance(const quint8 *a, const quint8 *b)
+{
+    return qMax(qAbs(a[0] - b[0]), qMax(qAbs(a[1] - b[1]), qAbs(a[2] - b[2])));
+}
+
+int EffectPipeline::OuterRadius(int gaussian_radius)
+{
+    return qMax(gaussian_radius * 8 / 5, gaussian_radius + 1);
+}
+
+void EffectPipeline::RunPlaneStrip(const PlaneStrip &strip)
+{
+    // Plain byte rows with no branches, so the compiler can vectorize
+
+    int width = strip.Width;
+
+    if (strip.Pass == PassLuma) {
+        for (int y = strip.FromY; y < strip.ToY; y++) {
+            const quint8 *p = strip.Source + y * width * 3;
+            quint8       *d = strip.Target + y * width;
+
+            for (int x = 0; x < width; x++) {
+                d[x] = (p[x * 3] * 11 + p[x * 3 + 1] * 16 + p[x * 3 + 2] * 5) / 32;
+            }
+        }
+    } else if (strip.Pass == PassBoxHorizontal) {
+        int box_radius = strip.Param;
+        int box_width  = box_radius * 2 + 1;
+
+        for (int y = strip.FromY; y < strip.ToY; y++) {
+            const quint8 *s = strip.Source + y * width;
+            quint8       *d = strip.Target + y * width;
+
+            int sum = s[0] * (box_radius + 1) + s[width - 1] * qMax(box_radius - (width - 1), 0);
+
+            for (int x = 1; x <= qMin(box_radius, width - 1); x++) {
+                sum += s[x];
+            }
+
+            for (int x = 0; x < width; x++) {
+                d[x] = (sum + box_width / 2) / box_width;
+
+                sum += s[qMin(x + box_radius + 1, width - 1)] - s[qMax(x - box_radius, 0)];
+            }
+        }
+    } else if (strip.Pass == PassBoxVertical) {
+        // Column sums carry over from the strip above
+
+        int  box_radius = strip.Param;
+        int  box_width  = box_radius * 2 + 1;
+        int  last_y     = strip.Height - 1;
+        int *sum        = strip.Sums;
+
+        if (strip.FromY == 0) {
+            memset(sum, 0, width * sizeof(int));
+
+            for (int y = -box_radius; y <= box_radius; y++) {
+                const quint8 *s = strip.Source + qBound(0, y, last_y) * width;
+
+                for (int x = 0; x < width; x++) {
+                    sum[x] += s[x];
+                }
+            }
+        }
+
+        for (int y = strip.FromY; y < strip.ToY; y++) {
+            const quint8 *add = strip.Source + qMin(y + box_radius + 1, last_y) * width;
+            const quint8 *sub = strip.Source + qMax(y - box_radius, 0)          * width;
+            quint8       *d   = strip.Target + y * width;
+
+            for (int x = 0; x < width; x++) {
+                d[x] = (sum[x] + box_width / 2) / box_width;
+
+                sum[x] += add[x] - sub[x];
+            }
+        }
+    } else if (strip.Pass == PassSobel) {
+        // Rows are padded with their edge pixels
+
+        QVector<quint8> padded((width + 2) * 3);
+
+        quint8 *above = padded.data();
+        quint8 *row   = above + width + 2;
+        quint8 *below = row   + width + 2;
+
+        for (int y = strip.FromY; y < strip.ToY; y++) {
+            const quint8 *lines[3] = { strip.Source + qMax(y - 1, 0)                * width,
+                                       strip.Source + y                             * width,
+                                       strip.Source + qMin(y + 1, strip.Height - 1) * width };
+            quint8       *rows[3]  = { above, row, below };
+
+            for (int i = 0; i < 3; i++) {
+                memcpy(rows[i] + 1, lines[i], width);
+
+                rows[i][0]         = lines[i][0];
+                rows[i][width + 1] = lines[i][width - 1];
+            }
+
+            quint8 *d = strip.Target + y * width * 3;
+
+            for (int x = 0; x < width; x++) {
+                int horz_grad = (above[x + 2] + 2 * row[x + 2] + below[x + 2]) - (above[x] + 2 * row[x] + below[x]);
+                int vert_grad = (below[x] + 2 * below[x + 1] + below[x + 2]) - (above[x] + 2 * above[x + 1] + above[x + 2]);
+                int line      = 255 - qMin(qAbs(horz_grad) + qAbs(vert_grad), 255);
+
+                d[x * 3] = d[x * 3 + 1] = d[x * 3 + 2] = line;
+            }
+        }
+    } else if (strip.Pass == PassDifference) {
+        for (int y = strip.FromY; y < strip.ToY; y++) {
+            const quint8 *inner = strip.Source + y * width;
+            const quint8 *outer = strip.Other  + y * width;
+            quint8       *d     = strip.Target + y * width * 3;
+
+            for (int x = 0; x < width; x++) {
+                int line = qBound(0, 255 + (inner[x] - outer[x]) * DOG_GAIN, 255);
+
+                d[x * 3] = d[x * 3 + 1] = d[x * 3 + 2] = line;
+            }
+        }
+    }
+}
+
+void EffectPipeline::BoxBlurHorizontal(const quint8 *src, quint8 *dst, int width, int height, int box_radius)
+{
+    int box_width = box_radius * 2 + 1;
+
+    for (int y = 0; y < height; y++) {
+        const quint8 *s = src + y * width * 3;
+        quint8       *d = dst + y * width * 3;
+
+        for (int i = 0; i < 3; i++) {
+            int first = s[i];
+            int last  = s[(width - 1) * 3 + i];
+            int sum   = first * (box_radius + 1) + last * qMax(box_radius - (width - 1), 0);
+
+            for (int x = 1; x <= qMin(box_radius, width - 1); x++) {
+                sum += s[x * 3 + i];
+            }
+
+            for (int x = 0; x < width; x++) {
+                d[x * 3 + i] = (sum + box_width / 2) / box_width;
+
+                sum += s[qMin(x + box_radius + 1, width - 1) * 3 + i] - s[qMax(x - box_radius, 0) * 3 + i];
+            }
+        }
+    }
+}
+
+void EffectPipeline::BoxBlurVertical(const quint8 *src, quint8 *dst, int width, int height, int box_radius)
+{
+    int box_width = box_radius * 2 + 1;
+    int line_size = width * 3;
+
+    QVector<int> column_sums(line_size);
+
+    int          *sum   = column_sums.data();
+    const quint8 *first = src;
+    const quint8 *last  = src + (height - 1) * line_size;
+
+    for (int x = 0; x < line_size; x++) {
+        sum[x] = first[x] * (box_radius + 1) + last[x] * qMax(box_radius - (height - 1), 0);
+    }
+
+    for (int y = 1; y <= qMin(box_radius, height - 1); y++) {
+        const quint8 *s = src + y * line_size;
+
+        for (int x = 0; x < line_size; x++) {
+            sum[x] += s[x];
+        }
+    }
+
+    for (int y = 0; y < height; y++) {
+        const quint8 *add = src + qMin(y + box_radius + 1, height - 1) * line_size;
+        const quint8 *sub = src + qMax(y - box_radius, 0) * line_size;
+        quint8       *d   = dst + y * line_size;
+
+        for (int x = 0; x < line_size; x++) {
+            d[x] = (sum[x] + box_width / 2) / box_width;
+
+            sum[x] += add[x] - sub[x];
+        }
+    }
+}
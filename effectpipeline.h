@@ -0,0 +1,125 @@
+#ifndef EFFECTPIPELINE_H
+#define EFFECTPIPELINE_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QImage>
+
+#include "cellmap.h"
+
+// Effect described as a chain of stages over an RGB16 image, run on an 8-bit
+// RGB copy in buffer 0. Adjacent per-pixel stages are fused into one pass over
+// cache-sized row strips; the others run as passes of their own, with a
+// scheduler checkpoint between strips.
+
+class EffectPipeline
+{
+public:
+    EffectPipeline();
+
+    static const int MAX_BUFFERS = 4;
+
+    EffectPipeline &blur(int gaussian_radius);
+    EffectPipeline &bilateral(int gaussian_radius);
+    EffectPipeline &luma();
+    EffectPipeline &invert();
+    EffectPipeline &quantize();
+    EffectPipeline &dodge(int top_buffer);
+    EffectPipeline &edgeThreshold(int threshold);
+    EffectPipeline &blockAverage(int block_size);
+    EffectPipeline &cellAverage(const CellMap &cell_map);
+    EffectPipeline &sobel(int gaussian_radius);
+    EffectPipeline &differenceOfGaussians(int gaussian_radius);
+    EffectPipeline &store(int buffer);
+    EffectPipeline &load(int buffer);
+
+    int  passCount() const;
+    void run(QImage &image);
+
+    static int BlurReach(int gaussian_radius);
+    static int BilateralReach(int gaussian_radius);
+    static int SobelReach(int gaussian_radius);
+    static int DifferenceOfGaussiansReach(int gaussian_radius);
+
+    static qreal Sigma(int gaussian_radius);
+
+private:
+    enum Operation {
+        OpExpand,
+        OpPack,
+        OpLuma,
+        OpInvert,
+        OpQuantize,
+        OpDodge,
+        OpStore,
+        OpLoad,
+        OpBlur,
+        OpBilateral,
+        OpEdgeThreshold,
+        OpBlockAverage,
+        OpCellAverage,
+        OpSobel,
+        OpDifferenceOfGaussians
+    };
+
+    enum PlanePass {
+        PassLuma,
+        PassBoxHorizontal,
+        PassBoxVertical,
+        PassSobel,
+        PassDifference
+    };
+
+    struct Stage
+    {
+        Operation Op;
+        int       Param;
+    };
+
+    struct PlaneStrip
+    {
+        PlanePass     Pass;
+        int           Width, Height, FromY, ToY, Param;
+        const quint8 *Source, *Other;
+        quint8       *Target;
+        int          *Sums;
+    };
+
+    static bool IsPerPixel(Operation op);
+
+    EffectPipeline &Append(Operation op, int param = 0);
+
+    quint8 *Buffer(int index);
+    quint8 *Scratch(int size);
+
+    void RunStrips(const QVector<Stage> &stages, int first, int last, QImage &image);
+    void RunStage(const Stage &stage, QImage &image, int from_y, int to_y);
+    void RunBlur(int gaussian_radius);
+    void RunBilateral(int gaussian_radius);
+    void RunEdgeThreshold(int threshold);
+    void RunBlockAverage(int block_size);
+    void RunCellAverage(const CellMap &cell_map);
+    void RunSobel(int gaussian_radius);
+    void RunDifferenceOfGaussians(int gaussian_radius);
+    void BlurPlane(quint8 *plane, quint8 *tmp, int gaussian_radius);
+    void RunPlanePass(PlanePass pass, const quint8 *source, const quint8 *other, quint8 *target, int param = 0);
+
+    static void  BoxRadii(int gaussian_radius, int *box_radius);
+    static qreal BilateralFeedback(int gaussian_radius);
+    static int   Distance(const quint8 *a, const quint8 *b);
+    static int   OuterRadius(int gaussian_radius);
+    static void  RunPlaneStrip(const PlaneStrip &strip);
+    static void  BoxBlurHorizontal(const quint8 *src, quint8 *dst, int width, int height, int box_radius);
+    static void  BoxBlurVertical(const quint8 *src, quint8 *dst, int width, int height, int box_radius);
+
+    static const int STRIP_BYTES           = 32768,
+                     BILATERAL_RANGE_SIGMA = 12,
+                     DOG_GAIN              = 16;
+
+    int              Width, Height;
+    QVector<Stage>   Stages;
+    QVector<CellMap> CellMaps;
+    QVector<quint8>  Buffers[MAX_BUFFERS], ScratchBuffer;
+};
+
+#endif // EFFECTPIPELINE_H
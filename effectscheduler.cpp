@@ -0,0 +1,282 @@
+#include <QThread>
+#include <QMutexLocker>
+#include <QMetaObject>
+#include <QCoreApplication>
+
+#include "effectscheduler.h"
+#include "tracer.h"
+
+EffectScheduler                             *EffectScheduler::SchedulerInstance = 0;
+QThreadStorage<EffectScheduler::RunState *> EffectScheduler::RunningState;
+
+EffectScheduler::EffectScheduler(QObject *parent) : QObject(parent)
+{
+    DroppedCount     = 0;
+    PreemptionsCount = 0;
+    HighestQueued    = -1;
+
+    WorkerPool.setMaxThreadCount(qMax(QThread::idealThreadCount(), 1));
+}
+
+EffectScheduler::~EffectScheduler()
+{
+    {
+        QMutexLocker locker(&SchedulerMutex);
+
+        while (!QueuedJobs.isEmpty()) {
+            Drop(QueuedJobs.takeFirst());
+        }
+
+        UpdateHighestQueued();
+    }
+
+    WorkerPool.waitForDone();
+
+    SchedulerInstance = 0;
+}
+
+EffectScheduler *EffectScheduler::Instance()
+{
+    // Created on first use from the GUI thread
+
+    if (SchedulerInstance == 0) {
+        SchedulerInstance = new EffectScheduler(QCoreApplication::instance());
+    }
+
+    return SchedulerInstance;
+}
+
+void EffectScheduler::schedule(QRunnable *job, int priority, const QObject *owner)
+{
+    Job entry;
+
+    entry.Runnable = job;
+    entry.Priority = priority;
+    entry.Owner    = owner;
+
+    {
+        QMutexLocker locker(&SchedulerMutex);
+
+        // Highest class first, first come first served within a class
+
+        int index = 0;
+
+        while (index < QueuedJobs.size() && QueuedJobs.at(index).Priority >= priority) {
+            index++;
+        }
+
+        QueuedJobs.insert(index, entry);
+
+        UpdateHighestQueued();
+    }
+
+    // Each job brings a dispatcher that runs the first queued job
+
+    WorkerPool.start(new DispatchJob(this));
+}
+
+void EffectScheduler::schedule(QObject *generator, int priority, const QObject *owner)
+{
+    schedule(new GeneratorJob(generator), priority, owner);
+}
+
+void EffectScheduler::cancel(const QObject *owner)
+{
+    QMutexLocker locker(&SchedulerMutex);
+
+    for (int i = QueuedJobs.size() - 1; i >= 0; i--) {
+        if (QueuedJobs.at(i).Owner == owner) {
+            Drop(QueuedJobs.takeAt(i));
+        }
+    }
+
+    UpdateHighestQueued();
+
+    JobFinished.wakeAll();
+}
+
+void EffectScheduler::waitFor(const QObject *owner)
+{
+    QMutexLocker locker(&SchedulerMutex);
+
+    while (RunningJobs.contains(owner) || HasQueued(owner)) {
+        JobFinished.wait(&SchedulerMutex);
+    }
+}
+
+int EffectScheduler::queuedJobs() const
+{
+    QMutexLocker locker(&SchedulerMutex);
+
+    return QueuedJobs.size();
+}
+
+int EffectScheduler::droppedJobs() const
+{
+    QMutexLocker locker(&SchedulerMutex);
+
+    return DroppedCount;
+}
+
+int EffectScheduler::preemptions() const
+{
+    QMutexLocker locker(&SchedulerMutex);
+
+    return PreemptionsCount;
+}
+
+void EffectScheduler::Checkpoint()
+{
+    // Called often, so the common case returns after two reads
+
+    EffectScheduler *scheduler = SchedulerInstance;
+
+    if (scheduler == 0 || !RunningState.hasLocalData()) {
+        return;
+    }
+
+    RunState *state    = RunningState.localData();
+    int       priority = state->Priority;
+
+    if (priority < 0 || (int)scheduler->HighestQueued <= priority || state->Depth >= MAX_NESTING_DEPTH) {
+        return;
+    }
+
+    // A free worker picks the job up on its own
+
+    Job job;
+
+    while (!scheduler->HasIdleWorker() && scheduler->TakeJob(priority, &job)) {
+        {
+            QMutexLocker locker(&scheduler->SchedulerMutex);
+
+            scheduler->PreemptionsCount++;
+        }
+
+        TRACE_SCOPE("EffectScheduler::Checkpoint preempted");
+
+        scheduler->RunJob(job);
+    }
+}
+
+EffectScheduler::GeneratorJob::GeneratorJob(QObject *generator) : QRunnable()
+{
+    IsStarted = false;
+    Generator = generator;
+}
+
+EffectScheduler::GeneratorJob::~GeneratorJob()
+{
+    // A generator that never started never emits finished()
+
+    if (!IsStarted) {
+        Generator->deleteLater();
+    }
+}
+
+void EffectScheduler::GeneratorJob::run()
+{
+    IsStarted = true;
+
+    QMetaObject::invokeMethod(Generator, "start", Qt::DirectConnection);
+}
+
+EffectScheduler::DispatchJob::DispatchJob(EffectScheduler *scheduler) : QRunnable()
+{
+    Scheduler = scheduler;
+}
+
+void EffectScheduler::DispatchJob::run()
+{
+    Job job;
+
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+
+    if (Scheduler->TakeJob(-1, &job)) {
+        Scheduler->RunJob(job);
+    }
+}
+
+bool EffectScheduler::TakeJob(int above_priority, Job *job)
+{
+    QMutexLocker locker(&SchedulerMutex);
+
+    if (!QueuedJobs.isEmpty() && QueuedJobs.first().Priority > above_priority) {
+        *job = QueuedJobs.takeFirst();
+
+        RunningJobs[job->Owner]++;
+
+        UpdateHighestQueued();
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void EffectScheduler::RunJob(const Job &job)
+{
+    if (!RunningState.hasLocalData()) {
+        RunState *state = new RunState;
+
+        state->Priority = -1;
+        state->Depth    = 0;
+
+        RunningState.setLocalData(state);
+    }
+
+    // A job run from a checkpoint nests inside the one it preempted
+
+    RunState *state    = RunningState.localData();
+    int       previous = state->Priority;
+
+    state->Priority = job.Priority;
+    state->Depth++;
+
+    job.Runnable->run();
+
+    state->Priority = previous;
+    state->Depth--;
+
+    if (job.Runnable->autoDelete()) {
+        delete job.Runnable;
+    }
+
+    QMutexLocker locker(&SchedulerMutex);
+
+    if (--RunningJobs[job.Owner] == 0) {
+        RunningJobs.remove(job.Owner);
+    }
+
+    JobFinished.wakeAll();
+}
+
+void EffectScheduler::Drop(const Job &job)
+{
+    if (job.Runnable->autoDelete()) {
+        delete job.Runnable;
+    }
+
+    DroppedCount++;
+}
+
+bool EffectScheduler::HasQueued(const QObject *owner) const
+{
+    for (int i = 0; i < QueuedJobs.size(); i++) {
+        if (QueuedJobs.at(i).Owner == owner) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool EffectScheduler::HasIdleWorker() const
+{
+    return WorkerPool.activeThreadCount() < WorkerPool.maxThreadCount();
+}
+
+void EffectScheduler::UpdateHighestQueued()
+{
+    HighestQueued = QueuedJobs.isEmpty() ? -1 : QueuedJobs.first().Priority;
+}
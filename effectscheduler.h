@@ -0,0 +1,105 @@
+#ifndef EFFECTSCHEDULER_H
+#define EFFECTSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QRunnable>
+#include <QAtomicInt>
+
+// Runs effect generators and other image jobs on one shared worker pool in
+// order of priority class. At Checkpoint(), when every worker is busy, a job
+// runs a queued job of a higher class nested on its own thread, at most
+// MAX_NESTING_DEPTH deep. cancel() drops whatever an owner still has queued.
+
+class EffectScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        PriorityPrefetch,
+        PriorityBackground,
+        PriorityViewport,
+        PriorityInteractive
+    };
+
+    static EffectScheduler *Instance();
+
+    void schedule(QRunnable *job, int priority, const QObject *owner);
+    void schedule(QObject *generator, int priority, const QObject *owner);
+    void cancel(const QObject *owner);
+    void waitFor(const QObject *owner);
+
+    int queuedJobs() const;
+    int droppedJobs() const;
+    int preemptions() const;
+
+    static void Checkpoint();
+
+private:
+    explicit EffectScheduler(QObject *parent = 0);
+    virtual ~EffectScheduler();
+
+    class GeneratorJob : public QRunnable
+    {
+    public:
+        explicit GeneratorJob(QObject *generator);
+        virtual ~GeneratorJob();
+
+        virtual void run();
+
+    private:
+        bool     IsStarted;
+        QObject *Generator;
+    };
+
+    class DispatchJob : public QRunnable
+    {
+    public:
+        explicit DispatchJob(EffectScheduler *scheduler);
+
+        virtual void run();
+
+    private:
+        EffectScheduler *Scheduler;
+    };
+
+    struct Job
+    {
+        QRunnable     *Runnable;
+        int            Priority;
+        const QObject *Owner;
+    };
+
+    struct RunState
+    {
+        int Priority, Depth;
+    };
+
+    bool TakeJob(int above_priority, Job *job);
+    void RunJob(const Job &job);
+    void Drop(const Job &job);
+    bool HasQueued(const QObject *owner) const;
+    bool HasIdleWorker() const;
+    void UpdateHighestQueued();
+
+    static const int MAX_NESTING_DEPTH = 3;
+
+    static EffectScheduler           *SchedulerInstance;
+    static QThreadStorage<RunState *> RunningState;
+
+    int                         DroppedCount, PreemptionsCount;
+    QAtomicInt                  HighestQueued;
+    QList<Job>                  QueuedJobs;
+    QHash<const QObject *, int> RunningJobs;
+    mutable QMutex              SchedulerMutex;
+    QWaitCondition              JobFinished;
+    QThreadPool                 WorkerPool;
+};
+
+#endif // EFFECTSCHEDULER_H
@@ -0,0 +1,203 @@
+#include <QBuffer>
+#include <QImageReader>
+
+#include "exifthumbnail.h"
+#include "tracer.h"
+
+QImage ExifThumbnail::Load(const QString &file_name, const QSize &image_size, const QSize &size, const QSize &min_size)
+{
+    TRACE_SCOPE("ExifThumbnail::Load");
+
+    QFile file(file_name);
+
+    if (image_size.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return QImage();
+    }
+
+    QVector<Preview> previews = FindPreviews(file);
+
+    // Smallest previews first, since they are the cheapest to decode
+
+    for (int i = 1; i < previews.size(); i++) {
+        for (int j = i; j > 0 && previews.at(j).Length < previews.at(j - 1).Length; j--) {
+            qSwap(previews[j], previews[j - 1]);
+        }
+    }
+
+    for (int i = 0; i < previews.size(); i++) {
+        if (file.seek(previews.at(i).Offset)) {
+            QByteArray data = file.read(previews.at(i).Length);
+            QBuffer    buffer(&data);
+
+            buffer.open(QIODevice::ReadOnly);
+
+            QImageReader reader(&buffer, "jpeg");
+            QSize        preview_size = reader.size();
+
+            // Larger previews cost as much as decoding the main image scaled
+
+            if (preview_size.width()  >= min_size.width()  && preview_size.height() >= min_size.height() &&
+                preview_size.width()  <= size.width()  * MAX_SCALE &&
+                preview_size.height() <= size.height() * MAX_SCALE && !preview_size.isEmpty() &&
+                qAbs((qreal)preview_size.width() / preview_size.height() - (qreal)image_size.width() / image_size.height()) <=
+                ASPECT_TOLERANCE * image_size.width() / image_size.height()) {
+                if (preview_size.width() > size.width() || preview_size.height() > size.height()) {
+                    reader.setScaledSize(preview_size.scaled(size, Qt::KeepAspectRatio).expandedTo(QSize(1, 1)));
+                }
+
+                QImage image = reader.read();
+
+                if (!image.isNull()) {
+                    return image;
+                }
+            }
+        }
+    }
+
+    return QImage();
+}
+
+QVector<ExifThumbnail::Preview> ExifThumbnail::FindPreviews(QFile &file)
+{
+    QVector<Preview> previews;
+
+    if (file.read(2) != QByteArray("\xff\xd8", 2)) {
+        return previews;
+    }
+
+    // Previews live in the APP1 and APP2 segments before the start of scan
+
+    while (true) {
+        QByteArray marker = file.read(4);
+
+        if (marker.size() != 4 || (uchar)marker.at(0) != 0xff) {
+            break;
+        }
+
+        int    type   = (uchar)marker.at(1);
+        int    length = ((uchar)marker.at(2) << 8) | (uchar)marker.at(3);
+        qint64 start  = file.pos();
+
+        if (type == 0xda || type == 0xd9 || length < 2) {
+            break;
+        } else if (type == 0xe1 || type == 0xe2) {
+            QByteArray segment = file.read(length - 2);
+
+            if (type == 0xe1 && segment.startsWith(QByteArray("Exif\0\0", 6))) {
+                ParseExif(segment.mid(6), start + 6, &previews);
+            } else if (type == 0xe2 && segment.startsWith(QByteArray("MPF\0", 4))) {
+                ParseMpf(segment.mid(4), start + 4, &previews);
+            }
+        }
+
+        if (!file.seek(start + length - 2)) {
+            break;
+        }
+    }
+
+    return previews;
+}
+
+void ExifThumbnail::ParseExif(const QByteArray &tiff, qint64 tiff_offset, QVector<Preview> *previews)
+{
+    bool big_endian = tiff.startsWith("MM");
+
+    if (!big_endian && !tiff.startsWith("II")) {
+        return;
+    }
+
+    // IFD1, which follows IFD0, describes the thumbnail image
+
+    qint64 ifd0 = Read32(tiff, 4, big_endian);
+    qint64 ifd1 = Read32(tiff, ifd0 + 2 + Read16(tiff, ifd0, big_endian) * 12, big_endian);
+
+    if (ifd1 == 0) {
+        return;
+    }
+
+    qint64 offset = 0;
+    qint64 length = 0;
+    int    count  = Read16(tiff, ifd1, big_endian);
+
+    for (int i = 0; i < count; i++) {
+        qint64 entry = ifd1 + 2 + i * 12;
+        int    tag   = Read16(tiff, entry, big_endian);
+
+        if (tag == 0x0201) {
+            offset = Read32(tiff, entry + 8, big_endian);
+        } else if (tag == 0x0202) {
+            length = Read32(tiff, entry + 8, big_endian);
+        }
+    }
+
+    if (offset > 0 && length > 0 && offset + length <= tiff.size()) {
+        Preview preview;
+
+        preview.Offset = tiff_offset + offset;
+        preview.Length = length;
+
+        previews->append(preview);
+    }
+}
+
+void ExifThumbnail::ParseMpf(const QByteArray &tiff, qint64 tiff_offset, QVector<Preview> *previews)
+{
+    bool big_endian = tiff.startsWith("MM");
+
+    if (!big_endian && !tiff.startsWith("II")) {
+        return;
+    }
+
+    // MP Entry: 16-byte records of attributes, size and offset; only the large
+    // thumbnails are previews
+
+    qint64 ifd   = Read32(tiff, 4, big_endian);
+    int    count = Read16(tiff, ifd, big_endian);
+
+    for (int i = 0; i < count; i++) {
+        qint64 entry = ifd + 2 + i * 12;
+
+        if (Read16(tiff, entry, big_endian) == 0xb002) {
+            qint64 records_length = Read32(tiff, entry + 4, big_endian);
+            qint64 records        = Read32(tiff, entry + 8, big_endian);
+
+            for (qint64 record = records; record + 16 <= records + records_length && record + 16 <= tiff.size(); record += 16) {
+                quint32 type   = Read32(tiff, record, big_endian) & MP_TYPE_MASK;
+                qint64  length = Read32(tiff, record + 4, big_endian);
+                qint64  offset = Read32(tiff, record + 8, big_endian);
+
+                if ((type == MP_TYPE_VGA || type == MP_TYPE_FULL_HD) && offset > 0 && length > 0) {
+                    Preview preview;
+
+                    preview.Offset = tiff_offset + offset;
+                    preview.Length = length;
+
+                    previews->append(preview);
+                }
+            }
+        }
+    }
+}
+
+quint32 ExifThumbnail::Read16(const QByteArray &tiff, qint64 offset, bool big_endian)
+{
+    if (offset < 0 || offset + 2 > tiff.size()) {
+        return 0;
+    }
+
+    const uchar *data = (const uchar *)tiff.constData() + offset;
+
+    return big_endian ? (data[0] << 8) | data[1] : (data[1] << 8) | data[0];
+}
+
+quint32 ExifThumbnail::Read32(const QByteArray &tiff, qint64 offset, bool big_endian)
+{
+    if (offset < 0 || offset + 4 > tiff.size()) {
+        return 0;
+    }
+
+    const uchar *data = (const uchar *)tiff.constData() + offset;
+
+    return big_endian ? ((quint32)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3] :
+                        ((quint32)data[3] << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
+}
@@ -0,0 +1,43 @@
+#ifndef EXIFTHUMBNAIL_H
+#define EXIFTHUMBNAIL_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QSize>
+#include <QFile>
+#include <QImage>
+
+// Reads the preview JPEGs that cameras embed in a JPEG file: the EXIF
+// thumbnail and the larger Multi-Picture Format previews.
+
+class ExifThumbnail
+{
+public:
+    // Smallest embedded preview of image_size's aspect that is at least min_size
+    // and at most MAX_SCALE times size, decoded to fit in size
+    static QImage Load(const QString &file_name, const QSize &image_size, const QSize &size, const QSize &min_size);
+
+private:
+    struct Preview {
+        qint64 Offset, Length;
+    };
+
+    static QVector<Preview> FindPreviews(QFile &file);
+    static void             ParseExif(const QByteArray &tiff, qint64 tiff_offset, QVector<Preview> *previews);
+    static void             ParseMpf(const QByteArray &tiff, qint64 tiff_offset, QVector<Preview> *previews);
+
+    static quint32 Read16(const QByteArray &tiff, qint64 offset, bool big_endian);
+    static quint32 Read32(const QByteArray &tiff, qint64 offset, bool big_endian);
+
+    static const qreal ASPECT_TOLERANCE = 0.02;
+
+    static const int MAX_SCALE = 2;
+
+    static const quint32 MP_TYPE_MASK    = 0x00ffffff,
+                         MP_TYPE_VGA     = 0x010001,
+                         MP_TYPE_FULL_HD = 0x010002;
+};
+
+#endif // EXIFTHUMBNAIL_H
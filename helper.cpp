@@ -1,6 +1,7 @@
 #include <QPainter>
 
 #include "helper.h"
+#include "tracer.h"
 
 Helper::Helper(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 {
@@ -13,6 +14,8 @@ Helper::~Helper()
 
 void Helper::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
+    TRACE_SCOPE("Helper::paint");
+
     qreal scale = 1.0;
 
     if (HelperImage.width() != 0 && HelperImage.height() != 0) {
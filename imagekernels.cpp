@@ -0,0 +1,135 @@
+#include <QAtomicInt>
+#include <QVector>
+#include <QColor>
+
+#include "imagekernels.h"
+#include "effectpipeline.h"
+#include "tracer.h"
+
+static QVector<quint16> MakeSaturationValueMap()
+{
+    // Saturation and value of every RGB565 color, as the recolor brush computes them
+
+    QVector<quint16> map(65536);
+    QColor           color;
+
+    for (int i = 0; i < 65536; i++) {
+        color.setRgb((i >> 8) & 0xf8, (i >> 3) & 0xfc, (i << 3) & 0xf8);
+
+        map[i] = (color.saturation() << 8) | color.value();
+    }
+
+    return map;
+}
+
+static const QVector<quint16> &SaturationValueMap()
+{
+    static const QVector<quint16> map(MakeSaturationValueMap());
+
+    return map;
+}
+
+static QAtomicInt ConversionCounter(0);
+
+QImage ImageKernels::ConvertToFormat(const QImage &image, QImage::Format format)
+{
+    TRACE_SCOPE("QImage::convertToFormat");
+
+    int count = ConversionCounter.fetchAndAddRelaxed(1) + 1;
+
+    Tracer::Counter("format conversions", count);
+
+    return image.convertToFormat(format);
+}
+
+QImage ImageKernels::ToRGB16(const QImage &image)
+{
+    if (image.format() == QImage::Format_RGB16) {
+        return image;
+    } else {
+        return ConvertToFormat(image, QImage::Format_RGB16);
+    }
+}
+
+int ImageKernels::ConversionCount()
+{
+    return ConversionCounter;
+}
+
+void ImageKernels::Grayscale(QImage &image)
+{
+    EffectPipeline().luma().run(image);
+}
+
+void ImageKernels::Blur(QImage &image, int gaussian_radius)
+{
+    EffectPipeline().blur(gaussian_radius).run(image);
+}
+
+void ImageKernels::Sketch(QImage &image, int gaussian_radius, int style)
+{
+    if (style == StyleSobel) {
+        EffectPipeline().sobel(LineRadius(gaussian_radius)).run(image);
+    } else if (style == StyleDoG) {
+        EffectPipeline().differenceOfGaussians(LineRadius(gaussian_radius)).run(image);
+    } else {
+        // Grayscale and inverted values pass through RGB565, as they used to
+
+        EffectPipeline().store(1)
+                        .blur(gaussian_radius).quantize().luma().invert().quantize().luma().store(2)
+                        .load(1).luma().quantize().luma().dodge(2)
+                        .run(image);
+    }
+}
+
+void ImageKernels::Cartoon(QImage &image, int gaussian_radius, int cartoon_threshold, int smoothing)
+{
+    EffectPipeline pipeline;
+
+    if (smoothing == SmoothingBilateral) {
+        pipeline.bilateral(gaussian_radius);
+    } else {
+        pipeline.blur(gaussian_radius);
+    }
+
+    pipeline.quantize().edgeThreshold(cartoon_threshold).run(image);
+}
+
+void ImageKernels::Pixelate(QImage &image, int pix_denom, int shape)
+{
+    int pix_size = pix_denom > 0 ? qMax(image.width(), image.height()) / pix_denom : 0;
+
+    if (shape == CellMap::ShapeSquare) {
+        EffectPipeline().blockAverage(pix_size).run(image);
+    } else {
+        EffectPipeline().cellAverage(CellMap::Cached(shape, pix_size, image.rect())).run(image);
+    }
+}
+
+quint16 ImageKernels::AdjustHue(quint16 rgb16, int hue)
+{
+    quint16 saturation_value = SaturationValueMap().at(rgb16);
+    QRgb    rgb              = QColor::fromHsv(hue, saturation_value >> 8, saturation_value & 0xff).rgb();
+
+    return Pack(qRed(rgb), qGreen(rgb), qBlue(rgb));
+}
+
+void ImageKernels::AdjustHue(QImage &image, int hue)
+{
+    TRACE_SCOPE("ImageKernels::AdjustHue");
+
+    for (int y = 0; y < image.height(); y++) {
+        quint16 *line = (quint16 *)image.scanLine(y);
+
+        for (int x = 0; x < image.width(); x++) {
+            line[x] = AdjustHue(line[x], hue);
+        }
+    }
+}
+
+int ImageKernels::LineRadius(int gaussian_radius)
+{
+    // Line styles blur far less than the dodge style for the same radius
+
+    return gaussian_radius / 4;
+}
@@ -0,0 +1,67 @@
+#ifndef IMAGEKERNELS_H
+#define IMAGEKERNELS_H
+
+#include <QtGlobal>
+#include <QImage>
+
+#include "cellmap.h"
+
+// Effect kernels that work directly on Format_RGB16 scanlines. RGB565
+// expansion and truncation match QImage::pixel() and setPixel() exactly.
+
+class ImageKernels
+{
+public:
+    enum Smoothing {
+        SmoothingGaussian,
+        SmoothingBilateral
+    };
+
+    enum Style {
+        StyleDodge,
+        StyleSobel,
+        StyleDoG
+    };
+
+    static inline int Red(quint16 rgb16)
+    {
+        return ((rgb16 >> 8) & 0xf8) | (rgb16 >> 13);
+    }
+
+    static inline int Green(quint16 rgb16)
+    {
+        return ((rgb16 >> 3) & 0xfc) | ((rgb16 >> 9) & 0x03);
+    }
+
+    static inline int Blue(quint16 rgb16)
+    {
+        return ((rgb16 << 3) & 0xf8) | ((rgb16 >> 2) & 0x07);
+    }
+
+    static inline int Gray(quint16 rgb16)
+    {
+        return (Red(rgb16) * 11 + Green(rgb16) * 16 + Blue(rgb16) * 5) / 32;
+    }
+
+    static inline quint16 Pack(int red, int green, int blue)
+    {
+        return ((red & 0xf8) << 8) | ((green & 0xfc) << 3) | (blue >> 3);
+    }
+
+    static QImage ConvertToFormat(const QImage &image, QImage::Format format);
+    static QImage ToRGB16(const QImage &image);
+    static int    ConversionCount();
+
+    static void Grayscale(QImage &image);
+    static void Blur(QImage &image, int gaussian_radius);
+    static void Sketch(QImage &image, int gaussian_radius, int style = StyleDodge);
+    static void Cartoon(QImage &image, int gaussian_radius, int cartoon_threshold, int smoothing = SmoothingGaussian);
+    static void Pixelate(QImage &image, int pix_denom, int shape = CellMap::ShapeSquare);
+
+    static quint16 AdjustHue(quint16 rgb16, int hue);
+    static void    AdjustHue(QImage &image, int hue);
+
+    static int LineRadius(int gaussian_radius);
+};
+
+#endif // IMAGEKERNELS_H
@@ -7,6 +7,24 @@ CONFIG += qt-components mobility
 MOBILITY += gallery
 
 SOURCES += main.cpp \
+    tracer.cpp \
+    imagekernels.cpp \
+    effectpipeline.cpp \
+    effectscheduler.cpp \
+    cellmap.cpp \
+    tiledimage.cpp \
+    brushmask.cpp \
+    effectmask.cpp \
+    editstack.cpp \
+    editsession.cpp \
+    autosavewriter.cpp \
+    blurlayer.cpp \
+    repaintcoalescer.cpp \
+    tilepyramid.cpp \
+    exifthumbnail.cpp \
+    previewsource.cpp \
+    thumbnailcache.cpp \
+    thumbnailprovider.cpp \
     helper.cpp \
     decolorizeeditor.cpp \
     sketcheditor.cpp \
@@ -16,6 +34,24 @@ SOURCES += main.cpp \
     recoloreditor.cpp \
     retoucheditor.cpp
 HEADERS += \
+    tracer.h \
+    imagekernels.h \
+    effectpipeline.h \
+    effectscheduler.h \
+    cellmap.h \
+    tiledimage.h \
+    brushmask.h \
+    effectmask.h \
+    editstack.h \
+    editsession.h \
+    autosavewriter.h \
+    blurlayer.h \
+    repaintcoalescer.h \
+    tilepyramid.h \
+    exifthumbnail.h \
+    previewsource.h \
+    thumbnailcache.h \
+    thumbnailprovider.h \
     helper.h \
     decolorizeeditor.h \
     sketcheditor.h \
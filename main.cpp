@@ -1,6 +1,9 @@
 #include <QApplication>
+#include <QDeclarativeContext>
+#include <QDeclarativeEngine>
 
 #include "helper.h"
+#include "tracer.h"
 #include "decolorizeeditor.h"
 #include "sketcheditor.h"
 #include "cartooneditor.h"
@@ -8,17 +11,27 @@
 #include "pixelateeditor.h"
 #include "recoloreditor.h"
 #include "retoucheditor.h"
+#include "thumbnailcache.h"
+#include "thumbnailprovider.h"
 
 #include "qmlapplicationviewer.h"
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
+
+    Tracer::Initialize();
+
+    ThumbnailCache thumbnail_cache;
+
 #ifndef MEEGO_TARGET
     QmlApplicationViewer splash;
 #endif
     QmlApplicationViewer viewer;
 
+    viewer.rootContext()->setContextProperty("thumbnailCache", &thumbnail_cache);
+    viewer.engine()->addImageProvider(QLatin1String("thumbnail"), new ThumbnailProvider(&thumbnail_cache));
+
     qmlRegisterType<Helper>("ImageEditor", 1, 0, "Helper");
 
     qmlRegisterType<DecolorizeEditor>("ImageEditor", 1, 0, "DecolorizeEditor");
@@ -1,17 +1,26 @@
 #include <qmath.h>
 #include <QFileInfo>
-#include <QThread>
 #include <QImageReader>
 #include <QPainter>
 
 #include "pixelateeditor.h"
+#include "imagekernels.h"
+#include "exifthumbnail.h"
+#include "effectscheduler.h"
+#include "tracer.h"
 
 PixelateEditor::PixelateEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 {
-    IsChanged   = false;
-    CurrentMode = ModeScroll;
-    HelperSize  = 0;
-    PixelDenom  = 0;
+    IsChanged     = false;
+    CurrentMode   = ModeScroll;
+    HelperSize    = 0;
+    BrushSize     = DEFAULT_BRUSH_SIZE;
+    BrushHardness = DEFAULT_BRUSH_HARDNESS;
+    PixelDenom    = 0;
+    PixelShape    = ShapeSquare;
+
+    Repainter = new RepaintCoalescer(this, this);
+    Autosaver = new AutosaveWriter(this);
 
     setAcceptedMouseButtons(Qt::LeftButton | Qt::RightButton | Qt::MiddleButton);
 
@@ -21,6 +30,9 @@ PixelateEditor::PixelateEditor(QDeclarativeItem *parent) : QDeclarativeItem(pare
 
 PixelateEditor::~PixelateEditor()
 {
+    EffectScheduler::Instance()->cancel(this);
+
+    SaveSession();
 }
 
 int PixelateEditor::mode() const
@@ -43,6 +55,26 @@ void PixelateEditor::setHelperSize(const int &size)
     HelperSize = size;
 }
 
+int PixelateEditor::brushSize() const
+{
+    return BrushSize;
+}
+
+void PixelateEditor::setBrushSize(const int &size)
+{
+    BrushSize = qMax(size, 1);
+}
+
+qreal PixelateEditor::brushHardness() const
+{
+    return BrushHardness;
+}
+
+void PixelateEditor::setBrushHardness(const qreal &hardness)
+{
+    BrushHardness = qBound((qreal)0.0, hardness, (qreal)1.0);
+}
+
 int PixelateEditor::pixDenom() const
 {
     return PixelDenom;
@@ -53,6 +85,16 @@ void PixelateEditor::setPixDenom(const int &pix_denom)
     PixelDenom = pix_denom;
 }
 
+int PixelateEditor::shape() const
+{
+    return PixelShape;
+}
+
+void PixelateEditor::setShape(const int &shape)
+{
+    PixelShape = shape;
+}
+
 bool PixelateEditor::changed() const
 {
     return IsChanged;
@@ -60,8 +102,14 @@ bool PixelateEditor::changed() const
 
 void PixelateEditor::openImage(const QString &image_url)
 {
+    TRACE_SCOPE("PixelateEditor::openImage");
+
     QString image_file = QUrl(image_url).toLocalFile();
 
+    if (!image_file.isNull() && ResumeSession(image_file)) {
+        return;
+    }
+
     if (!image_file.isNull()) {
         QImageReader reader(image_file);
 
@@ -77,27 +125,29 @@ void PixelateEditor::openImage(const QString &image_url)
                 reader.setScaledSize(size);
             }
 
-            LoadedImage = reader.read();
+            {
+                TRACE_SCOPE("QImageReader::read");
+
+                LoadedImage = reader.read();
+            }
 
             if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+                LoadedImage = ImageKernels::ConvertToFormat(LoadedImage, QImage::Format_RGB16);
 
                 if (!LoadedImage.isNull()) {
-                    QThread                *thread    = new QThread();
-                    PixelateImageGenerator *generator = new PixelateImageGenerator();
+                    SourceFile = image_file;
 
-                    generator->moveToThread(thread);
+                    PixelateImageGenerator *generator = new PixelateImageGenerator();
 
-                    QObject::connect(thread,    SIGNAL(started()),                  generator, SLOT(start()));
-                    QObject::connect(thread,    SIGNAL(finished()),                 thread,    SLOT(deleteLater()));
                     QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this,      SLOT(effectedImageReady(const QImage &)));
-                    QObject::connect(generator, SIGNAL(finished()),                 thread,    SLOT(quit()));
                     QObject::connect(generator, SIGNAL(finished()),                 generator, SLOT(deleteLater()));
 
                     generator->setPixelDenom(PixelDenom);
+                    generator->setPixelShape(PixelShape);
                     generator->setInput(LoadedImage);
 
-                    thread->start(QThread::LowPriority);
+                    EffectScheduler::Instance()->cancel(this);
+                    EffectScheduler::Instance()->schedule(generator, EffectScheduler::PriorityBackground, this);
                 } else {
                     emit imageOpenFailed();
                 }
@@ -114,17 +164,19 @@ void PixelateEditor::openImage(const QString &image_url)
 
 void PixelateEditor::saveImage(const QString &image_url)
 {
+    TRACE_SCOPE("PixelateEditor::saveImage");
+
     QString file_name = QUrl(image_url).toLocalFile();
 
     if (!file_name.isNull()) {
-        if (!CurrentImage.isNull()) {
+        if (!CurrentMask.isNull()) {
             if (QFileInfo(file_name).suffix().compare("png", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("jpg", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("bmp", Qt::CaseInsensitive) != 0) {
                 file_name = file_name + ".jpg";
             }
 
-            if (CurrentImage.convertToFormat(QImage::Format_ARGB32).save(file_name)) {
+            if (CurrentMask.composite(OriginalImage, EffectedImage, OriginalImage.rect()).save(file_name)) {
                 IsChanged = false;
 
                 emit imageSaved();
@@ -142,7 +194,9 @@ void PixelateEditor::saveImage(const QString &image_url)
 void PixelateEditor::undo()
 {
     if (UndoStack.size() > 0) {
-        CurrentImage = UndoStack.pop();
+        CurrentMask = UndoStack.pop();
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         if (UndoStack.size() == 0) {
             emit undoAvailabilityChanged(false);
@@ -150,17 +204,32 @@ void PixelateEditor::undo()
 
         IsChanged = true;
 
+        Autosaver->update("mask", CurrentMask.weights());
+
         update();
     }
 }
 
+void PixelateEditor::discard()
+{
+    Autosaver->stop();
+
+    IsChanged = false;
+
+    if (!SourceFile.isEmpty()) {
+        EditSession::Remove(SourceFile);
+    }
+}
+
 void PixelateEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*)
 {
+    TRACE_SCOPE("PixelateEditor::paint");
+
     qreal scale = 1.0;
 
-    if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-        scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                width() / CurrentImage.width() : height() / CurrentImage.height();
+    if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+        scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                width() / OriginalImage.width() : height() / OriginalImage.height();
     }
 
     bool antialiasing = painter->testRenderHint(QPainter::Antialiasing);
@@ -169,21 +238,22 @@ void PixelateEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *op
         painter->setRenderHint(QPainter::Antialiasing, true);
     }
 
-    QRectF src_rect(option->exposedRect.left()   / scale,
-                    option->exposedRect.top()    / scale,
-                    option->exposedRect.width()  / scale,
-                    option->exposedRect.height() / scale);
-
-    painter->drawImage(option->exposedRect, CurrentImage.copy(src_rect.toRect()));
+    DisplayPyramid.draw(painter, option->exposedRect, scale);
 
     painter->setRenderHint(QPainter::Antialiasing, antialiasing);
 }
 
 void PixelateEditor::effectedImageReady(const QImage &effected_image)
 {
+    Tracer::AsyncEnd("imageReady delivery", sender());
+
+    TRACE_SCOPE("PixelateEditor::effectedImageReady");
+
     OriginalImage = LoadedImage;
     EffectedImage = effected_image;
-    CurrentImage  = EffectedImage;
+    CurrentMask   = EffectMask(EffectedImage.size());
+
+    DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
     LoadedImage = QImage();
 
@@ -191,8 +261,10 @@ void PixelateEditor::effectedImageReady(const QImage &effected_image)
 
     IsChanged = true;
 
-    setImplicitWidth(CurrentImage.width());
-    setImplicitHeight(CurrentImage.height());
+    Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+    setImplicitWidth(EffectedImage.width());
+    setImplicitHeight(EffectedImage.height());
 
     update();
 
@@ -225,9 +297,86 @@ void PixelateEditor::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     }
 }
 
+EditSession PixelateEditor::MakeSession() const
+{
+    EditSession       session;
+    QList<TiledImage> journal;
+
+    for (int i = 0; i < UndoStack.size(); i++) {
+        journal.append(UndoStack.at(i).weights());
+    }
+
+    session.setEditor("pixelate");
+    session.setSourceFile(SourceFile);
+    session.setParameter("pixDenom", PixelDenom);
+    session.setParameter("shape",    PixelShape);
+    session.setImage("mask",     CurrentMask.weights());
+    session.setImage("original", TiledImage(OriginalImage));
+    session.setImage("effected", TiledImage(EffectedImage));
+    session.setJournal(journal);
+
+    return session;
+}
+
+bool PixelateEditor::ResumeSession(const QString &image_file)
+{
+    TRACE_SCOPE("PixelateEditor::ResumeSession");
+
+    EditSession session;
+
+    if (session.load(EditSession::FileFor(image_file)) && session.editor() == "pixelate" && session.sourceUnchanged() &&
+        session.parameter("pixDenom") == PixelDenom && session.parameter("shape") == PixelShape &&
+        session.image("original").size() == session.image("mask").size() &&
+        session.image("effected").size() == session.image("mask").size() && !session.image("mask").isNull()) {
+        QList<TiledImage> journal = session.journal();
+
+        SourceFile    = image_file;
+        OriginalImage = session.image("original").toImage();
+        EffectedImage = session.image("effected").toImage();
+        CurrentMask   = EffectMask(session.image("mask"));
+
+        UndoStack.clear();
+
+        for (int i = 0; i < journal.size(); i++) {
+            UndoStack.push(EffectMask(journal.at(i)));
+        }
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
+
+        IsChanged = true;
+
+        Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+        setImplicitWidth(OriginalImage.width());
+        setImplicitHeight(OriginalImage.height());
+
+        update();
+
+        emit undoAvailabilityChanged(!UndoStack.isEmpty());
+        emit imageOpened();
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void PixelateEditor::SaveSession()
+{
+    if (IsChanged) {
+        Autosaver->finish();
+    } else {
+        Autosaver->stop();
+
+        if (!SourceFile.isEmpty() && !CurrentMask.isNull()) {
+            EditSession::Remove(SourceFile);
+        }
+    }
+}
+
 void PixelateEditor::SaveUndoImage()
 {
-    UndoStack.push(CurrentImage);
+    UndoStack.push(CurrentMask);
 
     if (UndoStack.size() > UNDO_DEPTH) {
         for (int i = 0; i < UndoStack.size() - UNDO_DEPTH; i++) {
@@ -240,6 +389,8 @@ void PixelateEditor::SaveUndoImage()
 
 void PixelateEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 {
+    TRACE_SCOPE("PixelateEditor::ChangeImageAt");
+
     if (CurrentMode != ModeScroll) {
         if (save_undo) {
             SaveUndoImage();
@@ -247,35 +398,31 @@ void PixelateEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 
         qreal scale = 1.0;
 
-        if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-            scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                    width() / CurrentImage.width() : height() / CurrentImage.height();
+        if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+            scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                    width() / OriginalImage.width() : height() / OriginalImage.height();
         }
 
         int img_center_x = center_x   / scale;
         int img_center_y = center_y   / scale;
-        int radius       = BRUSH_SIZE / scale;
-
-        for (int x = img_center_x - radius; x <= img_center_x + radius; x++) {
-            for (int y = img_center_y - radius; y <= img_center_y + radius; y++) {
-                if (x >= 0 && x < CurrentImage.width() && y >= 0 && y < CurrentImage.height() && qSqrt(qPow(x - img_center_x, 2) + qPow(y - img_center_y, 2)) <= radius) {
-                    if (CurrentMode == ModeOriginal) {
-                        CurrentImage.setPixel(x, y, OriginalImage.pixel(x, y));
-                    } else {
-                        CurrentImage.setPixel(x, y, EffectedImage.pixel(x, y));
-                    }
-                }
-            }
-        }
+        int radius       = BrushSize  / scale;
+
+        CurrentMask.stamp(BrushMask::Cached(radius, BrushHardness), QPoint(img_center_x, img_center_y), CurrentMode == ModeOriginal ? 0 : BrushMask::MAX_WEIGHT);
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         IsChanged = true;
 
-        update(center_x - BRUSH_SIZE, center_y - BRUSH_SIZE, BRUSH_SIZE * 2, BRUSH_SIZE * 2);
+        Autosaver->update("mask", CurrentMask.weights());
+
+        Repainter->update(QRectF(center_x - BrushSize, center_y - BrushSize, BrushSize * 2, BrushSize * 2));
 
-        QImage helper_image = CurrentImage.copy(img_center_x - (HelperSize / scale) / 2,
-                                                img_center_y - (HelperSize / scale) / 2,
-                                                HelperSize / scale,
-                                                HelperSize / scale).scaledToWidth(HelperSize);
+        QRect helper_rect(img_center_x - (HelperSize / scale) / 2,
+                          img_center_y - (HelperSize / scale) / 2,
+                          HelperSize / scale,
+                          HelperSize / scale);
+
+        QImage helper_image = CurrentMask.composite(OriginalImage, EffectedImage, helper_rect).scaledToWidth(HelperSize);
 
         emit helperImageReady(helper_image);
     }
@@ -286,12 +433,19 @@ PixelatePreviewGenerator::PixelatePreviewGenerator(QDeclarativeItem *parent) : Q
     PixelateGeneratorRunning = false;
     RestartPixelateGenerator = false;
     PixelDenom               = 0;
+    PixelShape               = PixelateEditor::ShapeSquare;
+
+    Source = new PreviewSource(this, IMAGE_MPIX_LIMIT, this);
+
+    QObject::connect(Source, SIGNAL(retargeted()),     this, SLOT(reloadImage()));
+    QObject::connect(Source, SIGNAL(generationDue()), this, SLOT(generate()));
 
     setFlag(QGraphicsItem::ItemHasNoContents, false);
 }
 
 PixelatePreviewGenerator::~PixelatePreviewGenerator()
 {
+    EffectScheduler::Instance()->cancel(this);
 }
 
 int PixelatePreviewGenerator::pixDenom() const
@@ -304,55 +458,34 @@ void PixelatePreviewGenerator::setPixDenom(const int &pix_denom)
     PixelDenom = pix_denom;
 
     if (!LoadedImage.isNull()) {
-        if (PixelateGeneratorRunning) {
-            RestartPixelateGenerator = true;
-        } else {
-            StartPixelateGenerator();
-        }
+        Source->requestGeneration();
     }
 }
 
-void PixelatePreviewGenerator::openImage(const QString &image_url)
+int PixelatePreviewGenerator::shape() const
 {
-    QString image_file = QUrl(image_url).toLocalFile();
-
-    if (!image_file.isNull()) {
-        QImageReader reader(image_file);
-
-        if (reader.canRead()) {
-            QSize size = reader.size();
-
-            if (size.width() * size.height() > IMAGE_MPIX_LIMIT * 1000000.0) {
-                qreal factor = qSqrt((size.width() * size.height()) / (IMAGE_MPIX_LIMIT * 1000000.0));
+    return PixelShape;
+}
 
-                size.setWidth(size.width()   / factor);
-                size.setHeight(size.height() / factor);
+void PixelatePreviewGenerator::setShape(const int &shape)
+{
+    PixelShape = shape;
 
-                reader.setScaledSize(size);
-            }
+    if (!LoadedImage.isNull()) {
+        Source->requestGeneration();
+    }
+}
 
-            LoadedImage = reader.read();
+void PixelatePreviewGenerator::openImage(const QString &image_url)
+{
+    TRACE_SCOPE("PixelatePreviewGenerator::openImage");
 
-            if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+    LoadedImage = Source->load(QUrl(image_url).toLocalFile());
 
-                if (!LoadedImage.isNull()) {
-                    emit imageOpened();
+    if (!LoadedImage.isNull()) {
+        emit imageOpened();
 
-                    if (PixelateGeneratorRunning) {
-                        RestartPixelateGenerator = true;
-                    } else {
-                        StartPixelateGenerator();
-                    }
-                } else {
-                    emit imageOpenFailed();
-                }
-            } else {
-                emit imageOpenFailed();
-            }
-        } else {
-            emit imageOpenFailed();
-        }
+        Source->requestGeneration();
     } else {
         emit imageOpenFailed();
     }
@@ -360,6 +493,8 @@ void PixelatePreviewGenerator::openImage(const QString &image_url)
 
 void PixelatePreviewGenerator::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
+    TRACE_SCOPE("PixelatePreviewGenerator::paint");
+
     qreal scale = 1.0;
 
     if (PixelatedImage.width() != 0 && PixelatedImage.height() != 0) {
@@ -388,6 +523,10 @@ void PixelatePreviewGenerator::paint(QPainter *painter, const QStyleOptionGraphi
 
 void PixelatePreviewGenerator::pixelatedImageReady(const QImage &pixelated_image)
 {
+    Tracer::AsyncEnd("imageReady delivery", sender());
+
+    TRACE_SCOPE("PixelatePreviewGenerator::pixelatedImageReady");
+
     PixelateGeneratorRunning = false;
     PixelatedImage           = pixelated_image;
 
@@ -405,23 +544,49 @@ void PixelatePreviewGenerator::pixelatedImageReady(const QImage &pixelated_image
     }
 }
 
+void PixelatePreviewGenerator::reloadImage()
+{
+    TRACE_SCOPE("PixelatePreviewGenerator::reloadImage");
+
+    QImage image = Source->reload();
+
+    if (!image.isNull()) {
+        LoadedImage = image;
+
+        Source->requestGeneration();
+    }
+}
+
+void PixelatePreviewGenerator::generate()
+{
+    if (PixelateGeneratorRunning) {
+        RestartPixelateGenerator = true;
+    } else {
+        StartPixelateGenerator();
+    }
+}
+
+void PixelatePreviewGenerator::geometryChanged(const QRectF &new_geometry, const QRectF &old_geometry)
+{
+    QDeclarativeItem::geometryChanged(new_geometry, old_geometry);
+
+    if (new_geometry.size() != old_geometry.size()) {
+        Source->itemResized();
+    }
+}
+
 void PixelatePreviewGenerator::StartPixelateGenerator()
 {
-    QThread                *thread    = new QThread();
     PixelateImageGenerator *generator = new PixelateImageGenerator();
 
-    generator->moveToThread(thread);
-
-    QObject::connect(thread,    SIGNAL(started()),                  generator, SLOT(start()));
-    QObject::connect(thread,    SIGNAL(finished()),                 thread,    SLOT(deleteLater()));
     QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this,      SLOT(pixelatedImageReady(const QImage &)));
-    QObject::connect(generator, SIGNAL(finished()),                 thread,    SLOT(quit()));
     QObject::connect(generator, SIGNAL(finished()),                 generator, SLOT(deleteLater()));
 
     generator->setPixelDenom(PixelDenom);
+    generator->setPixelShape(PixelShape);
     generator->setInput(LoadedImage);
 
-    thread->start(QThread::LowPriority);
+    EffectScheduler::Instance()->schedule(generator, EffectScheduler::PriorityInteractive, this);
 
     PixelateGeneratorRunning = true;
 
@@ -431,6 +596,7 @@ void PixelatePreviewGenerator::StartPixelateGenerator()
 PixelateImageGenerator::PixelateImageGenerator(QObject *parent) : QObject(parent)
 {
     PixelDenom = 0;
+    PixelShape = CellMap::ShapeSquare;
 }
 
 PixelateImageGenerator::~PixelateImageGenerator()
@@ -442,6 +608,11 @@ void PixelateImageGenerator::setPixelDenom(const int &pix_denom)
     PixelDenom = pix_denom;
 }
 
+void PixelateImageGenerator::setPixelShape(const int &shape)
+{
+    PixelShape = shape;
+}
+
 void PixelateImageGenerator::setInput(const QImage &input_image)
 {
     InputImage = input_image;
@@ -449,44 +620,13 @@ void PixelateImageGenerator::setInput(const QImage &input_image)
 
 void PixelateImageGenerator::start()
 {
-    QImage pixelated_image = InputImage;
+    TRACE_SCOPE("PixelateImageGenerator::start");
 
-    int pix_size = pixelated_image.width() > pixelated_image.height() ? pixelated_image.width() / PixelDenom : pixelated_image.height() / PixelDenom;
+    QImage pixelated_image = ImageKernels::ToRGB16(InputImage);
 
-    if (pix_size != 0) {
-        for (int i = 0; i < pixelated_image.width() / pix_size + 1; i++) {
-            for (int j = 0; j < pixelated_image.height() / pix_size + 1; j++) {
-                int avg_r  = 0;
-                int avg_g  = 0;
-                int avg_b  = 0;
-                int pixels = 0;
+    ImageKernels::Pixelate(pixelated_image, PixelDenom, PixelShape);
 
-                for (int x = i * pix_size; x < (i + 1) * pix_size && x < pixelated_image.width(); x++) {
-                    for (int y = j * pix_size; y < (j + 1) * pix_size && y < pixelated_image.height(); y++) {
-                        int pixel = pixelated_image.pixel(x, y);
-
-                        avg_r += qRed(pixel);
-                        avg_g += qGreen(pixel);
-                        avg_b += qBlue(pixel);
-
-                        pixels++;
-                    }
-                }
-
-                if (pixels != 0) {
-                    avg_r = avg_r / pixels;
-                    avg_g = avg_g / pixels;
-                    avg_b = avg_b / pixels;
-
-                    for (int x = i * pix_size; x < (i + 1) * pix_size && x < pixelated_image.width(); x++) {
-                        for (int y = j * pix_size; y < (j + 1) * pix_size && y < pixelated_image.height(); y++) {
-                            pixelated_image.setPixel(x, y, qRgba(avg_r, avg_g, avg_b, qAlpha(pixelated_image.pixel(x, y))));
-                        }
-                    }
-                }
-            }
-        }
-    }
+    Tracer::AsyncBegin("imageReady delivery", this);
 
     emit imageReady(pixelated_image);
     emit finished();
@@ -9,17 +9,30 @@
 #include <QStyleOptionGraphicsItem>
 #include <QDeclarativeItem>
 
+#include "repaintcoalescer.h"
+#include "tilepyramid.h"
+#include "brushmask.h"
+#include "effectmask.h"
+#include "editsession.h"
+#include "autosavewriter.h"
+#include "previewsource.h"
+#include "cellmap.h"
+
 class PixelateEditor : public QDeclarativeItem
 {
     Q_OBJECT
 
-    Q_PROPERTY(int  mode       READ mode       WRITE setMode)
-    Q_PROPERTY(int  helperSize READ helperSize WRITE setHelperSize)
-    Q_PROPERTY(int  pixDenom   READ pixDenom   WRITE setPixDenom)
-    Q_PROPERTY(bool changed    READ changed)
+    Q_PROPERTY(int   mode          READ mode          WRITE setMode)
+    Q_PROPERTY(int   helperSize    READ helperSize    WRITE setHelperSize)
+    Q_PROPERTY(int   brushSize     READ brushSize     WRITE setBrushSize)
+    Q_PROPERTY(qreal brushHardness READ brushHardness WRITE setBrushHardness)
+    Q_PROPERTY(int   pixDenom      READ pixDenom      WRITE setPixDenom)
+    Q_PROPERTY(int   shape         READ shape         WRITE setShape)
+    Q_PROPERTY(bool  changed       READ changed)
 
     Q_ENUMS(Mode)
     Q_ENUMS(MouseState)
+    Q_ENUMS(Shape)
 
 public:
     explicit PixelateEditor(QDeclarativeItem *parent = 0);
@@ -31,15 +44,25 @@ public:
     int  helperSize() const;
     void setHelperSize(const int &size);
 
+    int  brushSize() const;
+    void setBrushSize(const int &size);
+
+    qreal brushHardness() const;
+    void  setBrushHardness(const qreal &hardness);
+
     int  pixDenom() const;
     void setPixDenom(const int &pix_denom);
 
+    int  shape() const;
+    void setShape(const int &shape);
+
     bool changed() const;
 
     Q_INVOKABLE void openImage(const QString &image_url);
     Q_INVOKABLE void saveImage(const QString &image_url);
 
     Q_INVOKABLE void undo();
+    Q_INVOKABLE void discard();
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*);
 
@@ -55,6 +78,13 @@ public:
         MouseReleased
     };
 
+    enum Shape {
+        ShapeSquare   = CellMap::ShapeSquare,
+        ShapeHexagon  = CellMap::ShapeHexagon,
+        ShapeCircle   = CellMap::ShapeCircle,
+        ShapeTriangle = CellMap::ShapeTriangle
+    };
+
 public slots:
     void effectedImageReady(const QImage &effected_image);
 
@@ -77,18 +107,29 @@ protected:
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
 
 private:
+    EditSession MakeSession() const;
+
+    bool ResumeSession(const QString &image_file);
+    void SaveSession();
     void SaveUndoImage();
     void ChangeImageAt(bool save_undo, int center_x, int center_y);
 
-    static const int UNDO_DEPTH  = 4,
-                     BRUSH_SIZE  = 16;
-
-    static const qreal IMAGE_MPIX_LIMIT = 1.0;
-
-    bool           IsChanged;
-    int            CurrentMode, HelperSize, PixelDenom;
-    QImage         LoadedImage, OriginalImage, EffectedImage, CurrentImage;
-    QStack<QImage> UndoStack;
+    static const int UNDO_DEPTH         = 4,
+                     DEFAULT_BRUSH_SIZE = 16;
+
+    static const qreal IMAGE_MPIX_LIMIT       = 1.0,
+                       DEFAULT_BRUSH_HARDNESS = 1.0;
+
+    bool               IsChanged;
+    int                CurrentMode, HelperSize, BrushSize, PixelDenom, PixelShape;
+    qreal              BrushHardness;
+    QString            SourceFile;
+    QImage             LoadedImage, OriginalImage, EffectedImage;
+    EffectMask         CurrentMask;
+    QStack<EffectMask> UndoStack;
+    TilePyramid        DisplayPyramid;
+    RepaintCoalescer   *Repainter;
+    AutosaveWriter     *Autosaver;
 };
 
 class PixelatePreviewGenerator : public QDeclarativeItem
@@ -96,6 +137,7 @@ class PixelatePreviewGenerator : public QDeclarativeItem
     Q_OBJECT
 
     Q_PROPERTY(int pixDenom READ pixDenom WRITE setPixDenom)
+    Q_PROPERTY(int shape    READ shape    WRITE setShape)
 
 public:
     explicit PixelatePreviewGenerator(QDeclarativeItem *parent = 0);
@@ -104,12 +146,17 @@ public:
     int  pixDenom() const;
     void setPixDenom(const int &pix_denom);
 
+    int  shape() const;
+    void setShape(const int &shape);
+
     Q_INVOKABLE void openImage(const QString &image_url);
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*);
 
 public slots:
     void pixelatedImageReady(const QImage &pixelated_image);
+    void reloadImage();
+    void generate();
 
 signals:
     void imageOpened();
@@ -118,14 +165,18 @@ signals:
     void generationStarted();
     void generationFinished();
 
+protected:
+    virtual void geometryChanged(const QRectF &new_geometry, const QRectF &old_geometry);
+
 private:
     void StartPixelateGenerator();
 
     static const qreal IMAGE_MPIX_LIMIT = 0.2;
 
-    bool   PixelateGeneratorRunning, RestartPixelateGenerator;
-    int    PixelDenom;
-    QImage LoadedImage, PixelatedImage;
+    bool           PixelateGeneratorRunning, RestartPixelateGenerator;
+    int            PixelDenom, PixelShape;
+    QImage         LoadedImage, PixelatedImage;
+    PreviewSource *Source;
 };
 
 class PixelateImageGenerator : public QObject
@@ -137,6 +188,7 @@ public:
     virtual ~PixelateImageGenerator();
 
     void setPixelDenom(const int &pix_denom);
+    void setPixelShape(const int &shape);
     void setInput(const QImage &input_image);
 
 public slots:
@@ -147,7 +199,7 @@ signals:
     void finished();
 
 private:
-    int    PixelDenom;
+    int    PixelDenom, PixelShape;
     QImage InputImage;
 };
 
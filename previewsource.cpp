@@ -0,0 +1,161 @@
+#include <qmath.h>
+#include <QList>
+#include <QTransform>
+#include <QImageReader>
+#include <QGraphicsScene>
+#include <QGraphicsView>
+
+#include "previewsource.h"
+#include "imagekernels.h"
+#include "exifthumbnail.h"
+#include "tracer.h"
+
+PreviewSource::PreviewSource(QDeclarativeItem *item, qreal mpix_limit, QObject *parent) : QObject(parent)
+{
+    MPixLimit = mpix_limit;
+    Item      = item;
+
+    RetargetTimer.setSingleShot(true);
+    FrameTimer.setSingleShot(true);
+
+    QObject::connect(&RetargetTimer, SIGNAL(timeout()), this, SLOT(checkTarget()));
+    QObject::connect(&FrameTimer,    SIGNAL(timeout()), this, SIGNAL(generationDue()));
+}
+
+PreviewSource::~PreviewSource()
+{
+}
+
+QImage PreviewSource::load(const QString &image_file)
+{
+    TRACE_SCOPE("PreviewSource::load");
+
+    QImage image;
+
+    ImageFile  = image_file;
+    ImageSize  = QSize();
+    LoadedSize = QSize();
+
+    if (!image_file.isNull()) {
+        QImageReader reader(image_file);
+
+        if (reader.canRead()) {
+            QSize size = TargetSize(reader.size());
+
+            if (size != reader.size()) {
+                reader.setScaledSize(size);
+            }
+
+            {
+                TRACE_SCOPE("QImageReader::read");
+
+                image = ExifThumbnail::Load(image_file, reader.size(), size, size);
+
+                if (image.isNull()) {
+                    image = reader.read();
+                } else if (image.size() != size) {
+                    image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+                }
+            }
+
+            if (!image.isNull()) {
+                image = ImageKernels::ConvertToFormat(image, QImage::Format_RGB16);
+
+                ImageSize  = reader.size();
+                LoadedSize = image.size();
+            }
+        }
+    }
+
+    return image;
+}
+
+QImage PreviewSource::reload()
+{
+    return load(ImageFile);
+}
+
+void PreviewSource::itemResized()
+{
+    // Act on a new size only once it has stopped changing and is out of tolerance
+
+    if (NeedsRetarget()) {
+        RetargetTimer.start(RETARGET_DELAY);
+    } else {
+        RetargetTimer.stop();
+    }
+}
+
+void PreviewSource::requestGeneration()
+{
+    // The first request in a frame arms the timer; later ones ride along
+
+    if (!FrameTimer.isActive()) {
+        FrameTimer.start(FRAME_INTERVAL);
+    }
+}
+
+void PreviewSource::checkTarget()
+{
+    if (NeedsRetarget()) {
+        emit retargeted();
+    }
+}
+
+bool PreviewSource::NeedsRetarget() const
+{
+    if (LoadedSize.isEmpty()) {
+        return false;
+    }
+
+    QSize target = TargetSize(ImageSize);
+
+    return qAbs(target.width()  - LoadedSize.width())  > LoadedSize.width()  * RETARGET_TOLERANCE ||
+           qAbs(target.height() - LoadedSize.height()) > LoadedSize.height() * RETARGET_TOLERANCE;
+}
+
+QSize PreviewSource::TargetSize(const QSize &image_size) const
+{
+    QSize size = image_size;
+
+    if (image_size.isEmpty()) {
+        return size;
+    }
+
+    if (Item->width() > 0 && Item->height() > 0) {
+        // Scaled to fit the item, keeping the aspect ratio, never up
+
+        qreal ratio = PixelRatio();
+        qreal scale = qMin(Item->width()  * ratio / image_size.width(),
+                           Item->height() * ratio / image_size.height());
+
+        if (scale < 1.0) {
+            size.setWidth(qMax(qRound(image_size.width()   * scale), 1));
+            size.setHeight(qMax(qRound(image_size.height() * scale), 1));
+        }
+    } else if (image_size.width() * image_size.height() > MPixLimit * 1000000.0) {
+        qreal factor = qSqrt((image_size.width() * image_size.height()) / (MPixLimit * 1000000.0));
+
+        size.setWidth(image_size.width()   / factor);
+        size.setHeight(image_size.height() / factor);
+    }
+
+    return size;
+}
+
+qreal PreviewSource::PixelRatio() const
+{
+    // Device pixels per item unit; a rotated view keeps the area ratio
+
+    if (Item->scene() != 0 && !Item->scene()->views().isEmpty()) {
+        QGraphicsView *view      = Item->scene()->views().first();
+        QTransform     transform = Item->deviceTransform(view->viewportTransform());
+        qreal          ratio     = qSqrt(qAbs(transform.determinant()));
+
+        if (ratio > 0.0) {
+            return ratio;
+        }
+    }
+
+    return 1.0;
+}
@@ -0,0 +1,54 @@
+#ifndef PREVIEWSOURCE_H
+#define PREVIEWSOURCE_H
+
+#include <QObject>
+#include <QString>
+#include <QSize>
+#include <QTimer>
+#include <QImage>
+#include <QDeclarativeItem>
+
+// Decodes the image of an effect preview item at the resolution the item
+// occupies on the device, asks for a reload through retargeted() once it has
+// settled at a different size, and coalesces generation requests into one
+// generationDue() per display frame.
+
+class PreviewSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PreviewSource(QDeclarativeItem *item, qreal mpix_limit, QObject *parent = 0);
+    virtual ~PreviewSource();
+
+    QImage load(const QString &image_file);
+    QImage reload();
+
+    void itemResized();
+    void requestGeneration();
+
+public slots:
+    void checkTarget();
+
+signals:
+    void retargeted();
+    void generationDue();
+
+private:
+    bool  NeedsRetarget() const;
+    QSize TargetSize(const QSize &image_size) const;
+    qreal PixelRatio() const;
+
+    static const int RETARGET_DELAY = 250,
+                     FRAME_INTERVAL = 16;
+
+    static const qreal RETARGET_TOLERANCE = 0.1;
+
+    qreal             MPixLimit;
+    QString           ImageFile;
+    QSize             ImageSize, LoadedSize;
+    QTimer            RetargetTimer, FrameTimer;
+    QDeclarativeItem *Item;
+};
+
+#endif // PREVIEWSOURCE_H
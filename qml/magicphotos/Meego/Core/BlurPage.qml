@@ -319,6 +319,16 @@ Page {
                 }
             }
 
+            ToolButton {
+                id:         brushToolButton
+                iconSource: "image://theme/icon-m-toolbar-edit"
+                flat:       true
+
+                onClicked: {
+                    brushDialog.show(blurEditor.brushSize, blurEditor.brushHardness);
+                }
+            }
+
             ToolButton {
                 iconSource: "../images/help.png"
                 flat:       true
@@ -355,6 +365,8 @@ Page {
         rejectButtonText: "No"
 
         onAccepted: {
+            blurEditor.discard();
+
             mainPageStack.pop();
         }
     }
@@ -368,4 +380,13 @@ Page {
             blurEditor.saveImage(blurPage.saveFileUrl);
         }
     }
+
+    BrushDialog {
+        id: brushDialog
+
+        onDone: {
+            blurEditor.brushSize     = brush_size;
+            blurEditor.brushHardness = brush_hardness;
+        }
+    }
 }
@@ -12,6 +12,7 @@ Page {
 
     property int    gaussianRadius:       -1
     property int    cartoonThreshold:     -1
+    property int    cartoonSmoothing:     -1
 
     property string openFileUrl:          ""
     property string saveFileUrl:          ""
@@ -21,44 +22,60 @@ Page {
     }
 
     onStatusChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && cartoonThreshold !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && cartoonThreshold !== -1 && cartoonSmoothing !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             cartoonEditor.radius    = gaussianRadius;
             cartoonEditor.threshold = cartoonThreshold;
+            cartoonEditor.smoothing = cartoonSmoothing;
 
             cartoonEditor.openImage(openFileUrl);
         }
     }
 
     onGaussianRadiusChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && cartoonThreshold !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && cartoonThreshold !== -1 && cartoonSmoothing !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             cartoonEditor.radius    = gaussianRadius;
             cartoonEditor.threshold = cartoonThreshold;
+            cartoonEditor.smoothing = cartoonSmoothing;
 
             cartoonEditor.openImage(openFileUrl);
         }
     }
 
     onCartoonThresholdChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && cartoonThreshold !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && cartoonThreshold !== -1 && cartoonSmoothing !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             cartoonEditor.radius    = gaussianRadius;
             cartoonEditor.threshold = cartoonThreshold;
+            cartoonEditor.smoothing = cartoonSmoothing;
+
+            cartoonEditor.openImage(openFileUrl);
+        }
+    }
+
+    onCartoonSmoothingChanged: {
+        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && cartoonThreshold !== -1 && cartoonSmoothing !== -1 && openFileUrl !== "") {
+            openFileOnActivation = false;
+
+            cartoonEditor.radius    = gaussianRadius;
+            cartoonEditor.threshold = cartoonThreshold;
+            cartoonEditor.smoothing = cartoonSmoothing;
 
             cartoonEditor.openImage(openFileUrl);
         }
     }
 
     onOpenFileUrlChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && cartoonThreshold !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && cartoonThreshold !== -1 && cartoonSmoothing !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             cartoonEditor.radius    = gaussianRadius;
             cartoonEditor.threshold = cartoonThreshold;
+            cartoonEditor.smoothing = cartoonSmoothing;
 
             cartoonEditor.openImage(openFileUrl);
         }
@@ -334,6 +351,16 @@ Page {
                 }
             }
 
+            ToolButton {
+                id:         brushToolButton
+                iconSource: "image://theme/icon-m-toolbar-edit"
+                flat:       true
+
+                onClicked: {
+                    brushDialog.show(cartoonEditor.brushSize, cartoonEditor.brushHardness);
+                }
+            }
+
             ToolButton {
                 iconSource: "../images/help.png"
                 flat:       true
@@ -370,6 +397,8 @@ Page {
         rejectButtonText: "No"
 
         onAccepted: {
+            cartoonEditor.discard();
+
             mainPageStack.pop();
         }
     }
@@ -383,4 +412,13 @@ Page {
             cartoonEditor.saveImage(cartoonPage.saveFileUrl);
         }
     }
+
+    BrushDialog {
+        id: brushDialog
+
+        onDone: {
+            cartoonEditor.brushSize     = brush_size;
+            cartoonEditor.brushHardness = brush_hardness;
+        }
+    }
 }
@@ -16,6 +16,7 @@ Page {
 
             cartoonPreviewGenerator.radius    = gaussianRadiusSlider.value;
             cartoonPreviewGenerator.threshold = thresholdSlider.value;
+            cartoonPreviewGenerator.smoothing = smoothingButtonRow.checkedButton.smoothing;
 
             cartoonPreviewGenerator.openImage(openFileUrl);
         }
@@ -27,6 +28,7 @@ Page {
 
             cartoonPreviewGenerator.radius    = gaussianRadiusSlider.value;
             cartoonPreviewGenerator.threshold = thresholdSlider.value;
+            cartoonPreviewGenerator.smoothing = smoothingButtonRow.checkedButton.smoothing;
 
             cartoonPreviewGenerator.openImage(openFileUrl);
         }
@@ -46,15 +48,19 @@ Page {
             property int waitRectangleUsageCounter: 0
 
             onImageOpened: {
-                gaussianRadiusSlider.enabled = true;
-                thresholdSlider.enabled      = true;
-                applyButton.enabled          = true;
+                gaussianRadiusSlider.enabled     = true;
+                thresholdSlider.enabled          = true;
+                gaussianSmoothingButton.enabled  = true;
+                bilateralSmoothingButton.enabled = true;
+                applyButton.enabled              = true;
             }
 
             onImageOpenFailed: {
-                gaussianRadiusSlider.enabled = false;
-                thresholdSlider.enabled      = false;
-                applyButton.enabled          = false;
+                gaussianRadiusSlider.enabled     = false;
+                thresholdSlider.enabled          = false;
+                gaussianSmoothingButton.enabled  = false;
+                bilateralSmoothingButton.enabled = false;
+                applyButton.enabled              = false;
 
                 imageOpenFailedQueryDialog.open();
             }
@@ -126,7 +132,7 @@ Page {
 
     Rectangle {
         id:             thresholdSliderRectangle
-        anchors.bottom: applyButtonRectangle.top
+        anchors.bottom: smoothingButtonRowRectangle.top
         anchors.left:   parent.left
         anchors.right:  parent.right
         height:         thresholdSlider.height + 16
@@ -151,6 +157,50 @@ Page {
         }
     }
 
+    Rectangle {
+        id:             smoothingButtonRowRectangle
+        anchors.bottom: applyButtonRectangle.top
+        anchors.left:   parent.left
+        anchors.right:  parent.right
+        height:         smoothingButtonRow.height + 16
+        color:          "transparent"
+
+        ButtonRow {
+            id:               smoothingButtonRow
+            anchors.centerIn: parent
+            exclusive:        true
+            checkedButton:    gaussianSmoothingButton
+
+            Button {
+                id:      gaussianSmoothingButton
+                enabled: false
+                text:    "Gaussian"
+
+                property int smoothing: CartoonEditor.SmoothingGaussian
+
+                onCheckedChanged: {
+                    if (checked) {
+                        cartoonPreviewGenerator.smoothing = smoothing;
+                    }
+                }
+            }
+
+            Button {
+                id:      bilateralSmoothingButton
+                enabled: false
+                text:    "Bilateral"
+
+                property int smoothing: CartoonEditor.SmoothingBilateral
+
+                onCheckedChanged: {
+                    if (checked) {
+                        cartoonPreviewGenerator.smoothing = smoothing;
+                    }
+                }
+            }
+        }
+    }
+
     Rectangle {
         id:             applyButtonRectangle
         anchors.bottom: bottomToolBar.top
@@ -166,7 +216,7 @@ Page {
             text:             "Apply"
 
             onClicked: {
-                mainPageStack.push(Qt.resolvedUrl("CartoonPage.qml"), {gaussianRadius: gaussianRadiusSlider.value, cartoonThreshold: thresholdSlider.value, openFileUrl: openFileUrl});
+                mainPageStack.push(Qt.resolvedUrl("CartoonPage.qml"), {gaussianRadius: gaussianRadiusSlider.value, cartoonThreshold: thresholdSlider.value, cartoonSmoothing: smoothingButtonRow.checkedButton.smoothing, openFileUrl: openFileUrl});
             }
         }
     }
@@ -303,6 +303,16 @@ Page {
                 }
             }
 
+            ToolButton {
+                id:         brushToolButton
+                iconSource: "image://theme/icon-m-toolbar-edit"
+                flat:       true
+
+                onClicked: {
+                    brushDialog.show(decolorizeEditor.brushSize, decolorizeEditor.brushHardness);
+                }
+            }
+
             ToolButton {
                 iconSource: "../images/help.png"
                 flat:       true
@@ -339,6 +349,8 @@ Page {
         rejectButtonText: "No"
 
         onAccepted: {
+            decolorizeEditor.discard();
+
             mainPageStack.pop();
         }
     }
@@ -352,4 +364,13 @@ Page {
             decolorizeEditor.saveImage(decolorizePage.saveFileUrl);
         }
     }
+
+    BrushDialog {
+        id: brushDialog
+
+        onDone: {
+            decolorizeEditor.brushSize     = brush_size;
+            decolorizeEditor.brushHardness = brush_hardness;
+        }
+    }
 }
@@ -67,6 +67,7 @@ Page {
             cellHeight:   height > width  ? Math.floor(height / 5) : Math.floor(height / 3)
             model:        documentGalleryModel
             delegate:     documentGalleryDelegate
+            cacheBuffer:  height
             visible:      false
 
             DocumentGalleryModel {
@@ -98,6 +99,14 @@ Page {
                     border.color: GridView.isCurrentItem ? "white" : "steelblue"
                     border.width: 2
 
+                    Component.onCompleted: {
+                        thumbnailCache.prefetch(fileOpenPage.utf8Decode(url));
+                    }
+
+                    Component.onDestruction: {
+                        thumbnailCache.cancelPrefetch(fileOpenPage.utf8Decode(url));
+                    }
+
                     MouseArea {
                         anchors.fill: parent
 
@@ -109,7 +118,7 @@ Page {
                             anchors.centerIn: parent
                             width:            parent.width  - galleryItemRectangle.border.width
                             height:           parent.height - galleryItemRectangle.border.width
-                            source:           fileOpenPage.utf8Decode(url)
+                            source:           "image://thumbnail/" + encodeURIComponent(fileOpenPage.utf8Decode(url))
                             sourceSize.width: width
                             cache:            false
                             asynchronous:     true
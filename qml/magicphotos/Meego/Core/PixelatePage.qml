@@ -11,6 +11,7 @@ Page {
     property bool   openFileOnActivation: true
 
     property int    pixelDenom:           -1
+    property int    pixelShape:           -1
 
     property string openFileUrl:          ""
     property string saveFileUrl:          ""
@@ -20,30 +21,44 @@ Page {
     }
 
     onStatusChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && pixelDenom !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && pixelDenom !== -1 && pixelShape !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             pixelateEditor.pixDenom = pixelDenom;
+            pixelateEditor.shape    = pixelShape;
 
             pixelateEditor.openImage(openFileUrl);
         }
     }
 
     onPixelDenomChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && pixelDenom !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && pixelDenom !== -1 && pixelShape !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             pixelateEditor.pixDenom = pixelDenom;
+            pixelateEditor.shape    = pixelShape;
+
+            pixelateEditor.openImage(openFileUrl);
+        }
+    }
+
+    onPixelShapeChanged: {
+        if (status === PageStatus.Active && openFileOnActivation && pixelDenom !== -1 && pixelShape !== -1 && openFileUrl !== "") {
+            openFileOnActivation = false;
+
+            pixelateEditor.pixDenom = pixelDenom;
+            pixelateEditor.shape    = pixelShape;
 
             pixelateEditor.openImage(openFileUrl);
         }
     }
 
     onOpenFileUrlChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && pixelDenom !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && pixelDenom !== -1 && pixelShape !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             pixelateEditor.pixDenom = pixelDenom;
+            pixelateEditor.shape    = pixelShape;
 
             pixelateEditor.openImage(openFileUrl);
         }
@@ -319,6 +334,16 @@ Page {
                 }
             }
 
+            ToolButton {
+                id:         brushToolButton
+                iconSource: "image://theme/icon-m-toolbar-edit"
+                flat:       true
+
+                onClicked: {
+                    brushDialog.show(pixelateEditor.brushSize, pixelateEditor.brushHardness);
+                }
+            }
+
             ToolButton {
                 iconSource: "../images/help.png"
                 flat:       true
@@ -355,6 +380,8 @@ Page {
         rejectButtonText: "No"
 
         onAccepted: {
+            pixelateEditor.discard();
+
             mainPageStack.pop();
         }
     }
@@ -368,4 +395,13 @@ Page {
             pixelateEditor.saveImage(pixelatePage.saveFileUrl);
         }
     }
+
+    BrushDialog {
+        id: brushDialog
+
+        onDone: {
+            pixelateEditor.brushSize     = brush_size;
+            pixelateEditor.brushHardness = brush_hardness;
+        }
+    }
 }
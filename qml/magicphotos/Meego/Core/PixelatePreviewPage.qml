@@ -15,6 +15,7 @@ Page {
             openFileOnActivation = false;
 
             pixelatePreviewGenerator.pixDenom = pixDenomSlider.value;
+            pixelatePreviewGenerator.shape    = shapeButtonRow.checkedButton.shape;
 
             pixelatePreviewGenerator.openImage(openFileUrl);
         }
@@ -25,6 +26,7 @@ Page {
             openFileOnActivation = false;
 
             pixelatePreviewGenerator.pixDenom = pixDenomSlider.value;
+            pixelatePreviewGenerator.shape    = shapeButtonRow.checkedButton.shape;
 
             pixelatePreviewGenerator.openImage(openFileUrl);
         }
@@ -44,13 +46,21 @@ Page {
             property int waitRectangleUsageCounter: 0
 
             onImageOpened: {
-                pixDenomSlider.enabled = true;
-                applyButton.enabled    = true;
+                pixDenomSlider.enabled      = true;
+                squareShapeButton.enabled   = true;
+                hexagonShapeButton.enabled  = true;
+                circleShapeButton.enabled   = true;
+                triangleShapeButton.enabled = true;
+                applyButton.enabled         = true;
             }
 
             onImageOpenFailed: {
-                pixDenomSlider.enabled = false;
-                applyButton.enabled    = false;
+                pixDenomSlider.enabled      = false;
+                squareShapeButton.enabled   = false;
+                hexagonShapeButton.enabled  = false;
+                circleShapeButton.enabled   = false;
+                triangleShapeButton.enabled = false;
+                applyButton.enabled         = false;
 
                 imageOpenFailedQueryDialog.open();
             }
@@ -95,7 +105,7 @@ Page {
 
     Rectangle {
         id:             pixDenomSliderRectangle
-        anchors.bottom: applyButtonRectangle.top
+        anchors.bottom: shapeButtonRowRectangle.top
         anchors.left:   parent.left
         anchors.right:  parent.right
         height:         pixDenomSlider.height + 16
@@ -120,6 +130,78 @@ Page {
         }
     }
 
+    Rectangle {
+        id:             shapeButtonRowRectangle
+        anchors.bottom: applyButtonRectangle.top
+        anchors.left:   parent.left
+        anchors.right:  parent.right
+        height:         shapeButtonRow.height + 16
+        color:          "transparent"
+
+        ButtonRow {
+            id:               shapeButtonRow
+            anchors.centerIn: parent
+            exclusive:        true
+            checkedButton:    squareShapeButton
+
+            Button {
+                id:      squareShapeButton
+                enabled: false
+                text:    "Square"
+
+                property int shape: PixelateEditor.ShapeSquare
+
+                onCheckedChanged: {
+                    if (checked) {
+                        pixelatePreviewGenerator.shape = shape;
+                    }
+                }
+            }
+
+            Button {
+                id:      hexagonShapeButton
+                enabled: false
+                text:    "Hexagon"
+
+                property int shape: PixelateEditor.ShapeHexagon
+
+                onCheckedChanged: {
+                    if (checked) {
+                        pixelatePreviewGenerator.shape = shape;
+                    }
+                }
+            }
+
+            Button {
+                id:      circleShapeButton
+                enabled: false
+                text:    "Circle"
+
+                property int shape: PixelateEditor.ShapeCircle
+
+                onCheckedChanged: {
+                    if (checked) {
+                        pixelatePreviewGenerator.shape = shape;
+                    }
+                }
+            }
+
+            Button {
+                id:      triangleShapeButton
+                enabled: false
+                text:    "Triangle"
+
+                property int shape: PixelateEditor.ShapeTriangle
+
+                onCheckedChanged: {
+                    if (checked) {
+                        pixelatePreviewGenerator.shape = shape;
+                    }
+                }
+            }
+        }
+    }
+
     Rectangle {
         id:             applyButtonRectangle
         anchors.bottom: bottomToolBar.top
@@ -135,7 +217,7 @@ Page {
             text:             "Apply"
 
             onClicked: {
-                mainPageStack.push(Qt.resolvedUrl("PixelatePage.qml"), {pixelDenom: pixDenomSlider.value, openFileUrl: openFileUrl});
+                mainPageStack.push(Qt.resolvedUrl("PixelatePage.qml"), {pixelDenom: pixDenomSlider.value, pixelShape: shapeButtonRow.checkedButton.shape, openFileUrl: openFileUrl});
             }
         }
     }
@@ -366,6 +366,16 @@ Page {
                 }
             }
 
+            ToolButton {
+                id:         brushToolButton
+                iconSource: "image://theme/icon-m-toolbar-edit"
+                flat:       true
+
+                onClicked: {
+                    brushDialog.show(retouchEditor.brushSize, retouchEditor.brushHardness);
+                }
+            }
+
             ToolButton {
                 iconSource: "../images/help.png"
                 flat:       true
@@ -402,6 +412,8 @@ Page {
         rejectButtonText: "No"
 
         onAccepted: {
+            retouchEditor.discard();
+
             mainPageStack.pop();
         }
     }
@@ -415,4 +427,13 @@ Page {
             retouchEditor.saveImage(retouchPage.saveFileUrl);
         }
     }
+
+    BrushDialog {
+        id: brushDialog
+
+        onDone: {
+            retouchEditor.brushSize     = brush_size;
+            retouchEditor.brushHardness = brush_hardness;
+        }
+    }
 }
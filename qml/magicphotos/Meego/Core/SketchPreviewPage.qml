@@ -15,6 +15,7 @@ Page {
             openFileOnActivation = false;
 
             sketchPreviewGenerator.radius = gaussianRadiusSlider.value;
+            sketchPreviewGenerator.style  = styleButtonRow.checkedButton.sketchStyle;
 
             sketchPreviewGenerator.openImage(openFileUrl);
         }
@@ -25,6 +26,7 @@ Page {
             openFileOnActivation = false;
 
             sketchPreviewGenerator.radius = gaussianRadiusSlider.value;
+            sketchPreviewGenerator.style  = styleButtonRow.checkedButton.sketchStyle;
 
             sketchPreviewGenerator.openImage(openFileUrl);
         }
@@ -45,11 +47,17 @@ Page {
 
             onImageOpened: {
                 gaussianRadiusSlider.enabled = true;
+                dodgeStyleButton.enabled     = true;
+                sobelStyleButton.enabled     = true;
+                dogStyleButton.enabled       = true;
                 applyButton.enabled          = true;
             }
 
             onImageOpenFailed: {
                 gaussianRadiusSlider.enabled = false;
+                dodgeStyleButton.enabled     = false;
+                sobelStyleButton.enabled     = false;
+                dogStyleButton.enabled       = false;
                 applyButton.enabled          = false;
 
                 imageOpenFailedQueryDialog.open();
@@ -95,7 +103,7 @@ Page {
 
     Rectangle {
         id:             gaussianRadiusSliderRectangle
-        anchors.bottom: applyButtonRectangle.top
+        anchors.bottom: styleButtonRowRectangle.top
         anchors.left:   parent.left
         anchors.right:  parent.right
         height:         gaussianRadiusSlider.height + 16
@@ -120,6 +128,64 @@ Page {
         }
     }
 
+    Rectangle {
+        id:             styleButtonRowRectangle
+        anchors.bottom: applyButtonRectangle.top
+        anchors.left:   parent.left
+        anchors.right:  parent.right
+        height:         styleButtonRow.height + 16
+        color:          "transparent"
+
+        ButtonRow {
+            id:               styleButtonRow
+            anchors.centerIn: parent
+            exclusive:        true
+            checkedButton:    dodgeStyleButton
+
+            Button {
+                id:      dodgeStyleButton
+                enabled: false
+                text:    "Dodge"
+
+                property int sketchStyle: SketchEditor.StyleDodge
+
+                onCheckedChanged: {
+                    if (checked) {
+                        sketchPreviewGenerator.style = sketchStyle;
+                    }
+                }
+            }
+
+            Button {
+                id:      sobelStyleButton
+                enabled: false
+                text:    "Sobel"
+
+                property int sketchStyle: SketchEditor.StyleSobel
+
+                onCheckedChanged: {
+                    if (checked) {
+                        sketchPreviewGenerator.style = sketchStyle;
+                    }
+                }
+            }
+
+            Button {
+                id:      dogStyleButton
+                enabled: false
+                text:    "DoG"
+
+                property int sketchStyle: SketchEditor.StyleDoG
+
+                onCheckedChanged: {
+                    if (checked) {
+                        sketchPreviewGenerator.style = sketchStyle;
+                    }
+                }
+            }
+        }
+    }
+
     Rectangle {
         id:             applyButtonRectangle
         anchors.bottom: bottomToolBar.top
@@ -135,7 +201,7 @@ Page {
             text:             "Apply"
 
             onClicked: {
-                mainPageStack.push(Qt.resolvedUrl("SketchPage.qml"), {gaussianRadius: gaussianRadiusSlider.value, openFileUrl: openFileUrl});
+                mainPageStack.push(Qt.resolvedUrl("SketchPage.qml"), {gaussianRadius: gaussianRadiusSlider.value, sketchStyle: styleButtonRow.checkedButton.sketchStyle, openFileUrl: openFileUrl});
             }
         }
     }
@@ -0,0 +1,97 @@
+import QtQuick 1.1
+import com.nokia.meego 1.0
+
+Dialog {
+    id: brushDialog
+
+    signal done(int brush_size, real brush_hardness)
+
+    function show(brush_size, brush_hardness) {
+        brushSizeSlider.value     = brush_size;
+        brushHardnessSlider.value = brush_hardness;
+
+        open();
+    }
+
+    title: [
+        Text {
+            id:                     brushDialogTitleText
+            anchors.verticalCenter: parent.verticalCenter
+            x:                      10
+            color:                  "steelblue"
+            font.pointSize:         18
+            text:                   "Brush"
+        },
+        Image {
+            anchors.verticalCenter: parent.verticalCenter
+            x:                      parent.width - width - 10
+            source:                 "../../../images/dialog_question.png"
+        }
+    ]
+
+    content: [
+        Column {
+            anchors.verticalCenter: parent.verticalCenter
+            anchors.left:           parent.left
+            anchors.right:          parent.right
+            spacing:                8
+
+            Text {
+                color:          "white"
+                font.pointSize: 16
+                text:           "Size"
+            }
+
+            Slider {
+                id:            brushSizeSlider
+                anchors.left:  parent.left
+                anchors.right: parent.right
+                minimumValue:  4
+                maximumValue:  64
+                value:         16
+                stepSize:      1.0
+            }
+
+            Text {
+                color:          "white"
+                font.pointSize: 16
+                text:           "Hardness"
+            }
+
+            Slider {
+                id:            brushHardnessSlider
+                anchors.left:  parent.left
+                anchors.right: parent.right
+                minimumValue:  0.0
+                maximumValue:  1.0
+                value:         1.0
+                stepSize:      0.05
+            }
+        }
+    ]
+
+    buttons: [
+        Button {
+            anchors.verticalCenter: parent.verticalCenter
+            anchors.left:           parent.left
+            width:                  parent.width / 2 - 4
+            text:                   "OK"
+
+            onClicked: {
+                brushDialog.done(brushSizeSlider.value, brushHardnessSlider.value);
+
+                brushDialog.accept();
+            }
+        },
+        Button {
+            anchors.verticalCenter: parent.verticalCenter
+            anchors.right:          parent.right
+            width:                  parent.width / 2 - 4
+            text:                   "Cancel"
+
+            onClicked: {
+                brushDialog.reject();
+            }
+        }
+    ]
+}
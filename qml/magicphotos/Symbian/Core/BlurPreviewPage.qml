@@ -108,7 +108,7 @@ Page {
             anchors.right:          parent.right
             enabled:                false
             minimumValue:           4
-            maximumValue:           18
+            maximumValue:           36
             value:                  11
             stepSize:               1.0
 
@@ -40,6 +40,7 @@ Page {
             cellHeight:   height > width  ? Math.floor(height / 5) : Math.floor(height / 3)
             model:        documentGalleryModel
             delegate:     documentGalleryDelegate
+            cacheBuffer:  height
             visible:      false
 
             DocumentGalleryModel {
@@ -71,6 +72,14 @@ Page {
                     border.color: GridView.isCurrentItem ? "white" : "steelblue"
                     border.width: 2
 
+                    Component.onCompleted: {
+                        thumbnailCache.prefetch(url);
+                    }
+
+                    Component.onDestruction: {
+                        thumbnailCache.cancelPrefetch(url);
+                    }
+
                     MouseArea {
                         anchors.fill: parent
 
@@ -82,7 +91,7 @@ Page {
                             anchors.centerIn: parent
                             width:            parent.width  - galleryItemRectangle.border.width
                             height:           parent.height - galleryItemRectangle.border.width
-                            source:           url
+                            source:           "image://thumbnail/" + encodeURIComponent(url)
                             sourceSize.width: width
                             cache:            false
                             asynchronous:     true
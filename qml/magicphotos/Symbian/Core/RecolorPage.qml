@@ -374,6 +374,16 @@ Page {
                 }
             }
 
+            ToolButton {
+                id:         brushToolButton
+                iconSource: "toolbar-settings"
+                flat:       true
+
+                onClicked: {
+                    brushDialog.show(recolorEditor.brushSize, recolorEditor.brushHardness);
+                }
+            }
+
             ToolButton {
                 iconSource: "../images/help.png"
                 flat:       true
@@ -410,6 +420,8 @@ Page {
         rejectButtonText: "No"
 
         onAccepted: {
+            recolorEditor.discard();
+
             mainPageStack.pop();
         }
     }
@@ -423,4 +435,13 @@ Page {
             recolorEditor.saveImage(recolorPage.saveFileUrl);
         }
     }
+
+    BrushDialog {
+        id: brushDialog
+
+        onDone: {
+            recolorEditor.brushSize     = brush_size;
+            recolorEditor.brushHardness = brush_hardness;
+        }
+    }
 }
@@ -11,6 +11,7 @@ Page {
     property bool   openFileOnActivation: true
 
     property int    gaussianRadius:       -1
+    property int    sketchStyle:          -1
 
     property string openFileUrl:          ""
     property string saveFileUrl:          ""
@@ -20,30 +21,44 @@ Page {
     }
 
     onStatusChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && sketchStyle !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             sketchEditor.radius = gaussianRadius;
+            sketchEditor.style  = sketchStyle;
 
             sketchEditor.openImage(openFileUrl);
         }
     }
 
     onGaussianRadiusChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && sketchStyle !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             sketchEditor.radius = gaussianRadius;
+            sketchEditor.style  = sketchStyle;
+
+            sketchEditor.openImage(openFileUrl);
+        }
+    }
+
+    onSketchStyleChanged: {
+        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && sketchStyle !== -1 && openFileUrl !== "") {
+            openFileOnActivation = false;
+
+            sketchEditor.radius = gaussianRadius;
+            sketchEditor.style  = sketchStyle;
 
             sketchEditor.openImage(openFileUrl);
         }
     }
 
     onOpenFileUrlChanged: {
-        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && openFileUrl !== "") {
+        if (status === PageStatus.Active && openFileOnActivation && gaussianRadius !== -1 && sketchStyle !== -1 && openFileUrl !== "") {
             openFileOnActivation = false;
 
             sketchEditor.radius = gaussianRadius;
+            sketchEditor.style  = sketchStyle;
 
             sketchEditor.openImage(openFileUrl);
         }
@@ -319,6 +334,16 @@ Page {
                 }
             }
 
+            ToolButton {
+                id:         brushToolButton
+                iconSource: "toolbar-settings"
+                flat:       true
+
+                onClicked: {
+                    brushDialog.show(sketchEditor.brushSize, sketchEditor.brushHardness);
+                }
+            }
+
             ToolButton {
                 iconSource: "../images/help.png"
                 flat:       true
@@ -355,6 +380,8 @@ Page {
         rejectButtonText: "No"
 
         onAccepted: {
+            sketchEditor.discard();
+
             mainPageStack.pop();
         }
     }
@@ -368,4 +395,13 @@ Page {
             sketchEditor.saveImage(sketchPage.saveFileUrl);
         }
     }
+
+    BrushDialog {
+        id: brushDialog
+
+        onDone: {
+            sketchEditor.brushSize     = brush_size;
+            sketchEditor.brushHardness = brush_hardness;
+        }
+    }
 }
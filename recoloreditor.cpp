@@ -1,36 +1,23 @@
 #include <qmath.h>
 #include <QFileInfo>
-#include <QColor>
 #include <QImageReader>
 #include <QPainter>
 
 #include "recoloreditor.h"
+#include "imagekernels.h"
+#include "tracer.h"
 
 RecolorEditor::RecolorEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 {
-    IsChanged   = false;
-    CurrentMode = ModeScroll;
-    HelperSize  = 0;
-    CurrentHue  = 0;
+    IsChanged     = false;
+    CurrentMode   = ModeScroll;
+    HelperSize    = 0;
+    BrushSize     = DEFAULT_BRUSH_SIZE;
+    BrushHardness = DEFAULT_BRUSH_HARDNESS;
+    CurrentHue    = 0;
 
-    RGB16  rgb16;
-    HSV    hsv;
-    QRgb   rgb;
-    QColor color;
-
-    for (int i = 0; i < 65536; i++) {
-        rgb16.rgb = i;
-
-        rgb = qRgb(rgb16.r << 3, rgb16.g << 2, rgb16.b << 3);
-
-        color.setRgb(rgb);
-
-        hsv.h = color.hue();
-        hsv.s = color.saturation();
-        hsv.v = color.value();
-
-        RGB16ToHSVMap[rgb16.rgb] = hsv.hsv;
-    }
+    Repainter = new RepaintCoalescer(this, this);
+    Autosaver = new AutosaveWriter(this);
 
     setAcceptedMouseButtons(Qt::LeftButton | Qt::RightButton | Qt::MiddleButton);
 
@@ -40,6 +27,7 @@ RecolorEditor::RecolorEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent
 
 RecolorEditor::~RecolorEditor()
 {
+    SaveSession();
 }
 
 int RecolorEditor::mode() const
@@ -62,6 +50,26 @@ void RecolorEditor::setHelperSize(const int &size)
     HelperSize = size;
 }
 
+int RecolorEditor::brushSize() const
+{
+    return BrushSize;
+}
+
+void RecolorEditor::setBrushSize(const int &size)
+{
+    BrushSize = qMax(size, 1);
+}
+
+qreal RecolorEditor::brushHardness() const
+{
+    return BrushHardness;
+}
+
+void RecolorEditor::setBrushHardness(const qreal &hardness)
+{
+    BrushHardness = qBound((qreal)0.0, hardness, (qreal)1.0);
+}
+
 int RecolorEditor::hue() const
 {
     return CurrentHue;
@@ -79,8 +87,14 @@ bool RecolorEditor::changed() const
 
 void RecolorEditor::openImage(const QString &image_url)
 {
+    TRACE_SCOPE("RecolorEditor::openImage");
+
     QString image_file = QUrl(image_url).toLocalFile();
 
+    if (!image_file.isNull() && ResumeSession(image_file)) {
+        return;
+    }
+
     if (!image_file.isNull()) {
         QImageReader reader(image_file);
 
@@ -96,14 +110,22 @@ void RecolorEditor::openImage(const QString &image_url)
                 reader.setScaledSize(size);
             }
 
-            LoadedImage = reader.read();
+            {
+                TRACE_SCOPE("QImageReader::read");
+
+                LoadedImage = reader.read();
+            }
 
             if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+                LoadedImage = ImageKernels::ConvertToFormat(LoadedImage, QImage::Format_RGB16);
 
                 if (!LoadedImage.isNull()) {
+                    SourceFile = image_file;
+
                     OriginalImage = LoadedImage;
-                    CurrentImage  = LoadedImage;
+                    CurrentImage  = TiledImage(LoadedImage);
+
+                    DisplayPyramid.setImage(CurrentImage);
 
                     LoadedImage = QImage();
 
@@ -111,6 +133,8 @@ void RecolorEditor::openImage(const QString &image_url)
 
                     IsChanged = false;
 
+                    Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
                     setImplicitWidth(CurrentImage.width());
                     setImplicitHeight(CurrentImage.height());
 
@@ -134,6 +158,8 @@ void RecolorEditor::openImage(const QString &image_url)
 
 void RecolorEditor::saveImage(const QString &image_url)
 {
+    TRACE_SCOPE("RecolorEditor::saveImage");
+
     QString file_name = QUrl(image_url).toLocalFile();
 
     if (!file_name.isNull()) {
@@ -144,7 +170,7 @@ void RecolorEditor::saveImage(const QString &image_url)
                 file_name = file_name + ".jpg";
             }
 
-            if (CurrentImage.convertToFormat(QImage::Format_ARGB32).save(file_name)) {
+            if (CurrentImage.toImage().save(file_name)) {
                 IsChanged = false;
 
                 emit imageSaved();
@@ -164,18 +190,35 @@ void RecolorEditor::undo()
     if (UndoStack.size() > 0) {
         CurrentImage = UndoStack.pop();
 
+        DisplayPyramid.setImage(CurrentImage);
+
         if (UndoStack.size() == 0) {
             emit undoAvailabilityChanged(false);
         }
 
         IsChanged = true;
 
+        Autosaver->update("current", CurrentImage);
+
         update();
     }
 }
 
+void RecolorEditor::discard()
+{
+    Autosaver->stop();
+
+    IsChanged = false;
+
+    if (!SourceFile.isEmpty()) {
+        EditSession::Remove(SourceFile);
+    }
+}
+
 void RecolorEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*)
 {
+    TRACE_SCOPE("RecolorEditor::paint");
+
     qreal scale = 1.0;
 
     if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
@@ -189,12 +232,7 @@ void RecolorEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *opt
         painter->setRenderHint(QPainter::Antialiasing, true);
     }
 
-    QRectF src_rect(option->exposedRect.left()   / scale,
-                    option->exposedRect.top()    / scale,
-                    option->exposedRect.width()  / scale,
-                    option->exposedRect.height() / scale);
-
-    painter->drawImage(option->exposedRect, CurrentImage.copy(src_rect.toRect()));
+    DisplayPyramid.draw(painter, option->exposedRect, scale);
 
     painter->setRenderHint(QPainter::Antialiasing, antialiasing);
 }
@@ -224,18 +262,70 @@ void RecolorEditor::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     }
 }
 
-QRgb RecolorEditor::AdjustHue(QRgb rgb)
+EditSession RecolorEditor::MakeSession() const
+{
+    EditSession session;
+
+    session.setEditor("recolor");
+    session.setSourceFile(SourceFile);
+    session.setImage("original", TiledImage(OriginalImage));
+    session.setImage("current",  CurrentImage);
+    session.setJournal(UndoStack.toList());
+
+    return session;
+}
+
+bool RecolorEditor::ResumeSession(const QString &image_file)
 {
-    RGB16 rgb16;
-    HSV   hsv;
+    TRACE_SCOPE("RecolorEditor::ResumeSession");
+
+    EditSession session;
+
+    if (session.load(EditSession::FileFor(image_file)) && session.editor() == "recolor" && session.sourceUnchanged() &&
+        session.image("original").size() == session.image("current").size() && !session.image("current").isNull()) {
+        QList<TiledImage> journal = session.journal();
+
+        SourceFile    = image_file;
+        OriginalImage = session.image("original").toImage();
+        CurrentImage  = session.image("current");
+
+        UndoStack.clear();
+
+        for (int i = 0; i < journal.size(); i++) {
+            UndoStack.push(journal.at(i));
+        }
 
-    rgb16.r = (qRed(rgb)   & 0xf8) >> 3;
-    rgb16.g = (qGreen(rgb) & 0xfc) >> 2;
-    rgb16.b = (qBlue(rgb)  & 0xf8) >> 3;
+        DisplayPyramid.setImage(CurrentImage);
+
+        IsChanged = true;
+
+        Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+        setImplicitWidth(CurrentImage.width());
+        setImplicitHeight(CurrentImage.height());
+
+        update();
+
+        emit undoAvailabilityChanged(!UndoStack.isEmpty());
+        emit imageOpened();
+
+        return true;
+    } else {
+        return false;
+    }
+}
 
-    hsv.hsv = RGB16ToHSVMap[rgb16.rgb];
+void RecolorEditor::SaveSession()
+{
+    if (IsChanged) {
+        Autosaver->finish();
+    } else {
+        Autosaver->stop();
 
-    return QColor::fromHsv(CurrentHue, hsv.s, hsv.v, qAlpha(rgb)).rgba();
+        if (!SourceFile.isEmpty() && !CurrentImage.isNull()) {
+            EditSession::Remove(SourceFile);
+        }
+    }
 }
 
 void RecolorEditor::SaveUndoImage()
@@ -253,6 +343,8 @@ void RecolorEditor::SaveUndoImage()
 
 void RecolorEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 {
+    TRACE_SCOPE("RecolorEditor::ChangeImageAt");
+
     if (CurrentMode != ModeScroll) {
         if (save_undo) {
             SaveUndoImage();
@@ -267,23 +359,49 @@ void RecolorEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 
         int img_center_x = center_x   / scale;
         int img_center_y = center_y   / scale;
-        int radius       = BRUSH_SIZE / scale;
-
-        for (int x = img_center_x - radius; x <= img_center_x + radius; x++) {
-            for (int y = img_center_y - radius; y <= img_center_y + radius; y++) {
-                if (x >= 0 && x < CurrentImage.width() && y >= 0 && y < CurrentImage.height() && qSqrt(qPow(x - img_center_x, 2) + qPow(y - img_center_y, 2)) <= radius) {
-                    if (CurrentMode == ModeOriginal) {
-                        CurrentImage.setPixel(x, y, OriginalImage.pixel(x, y));
-                    } else {
-                        CurrentImage.setPixel(x, y, AdjustHue(OriginalImage.pixel(x, y)));
+        int radius       = BrushSize  / scale;
+
+        BrushMask brush_mask = BrushMask::Cached(radius, BrushHardness);
+
+        for (int dy = -radius; dy <= radius; dy++) {
+            int y = img_center_y + dy;
+
+            if (y >= 0 && y < CurrentImage.height()) {
+                int from_x = qMax(img_center_x - brush_mask.halfWidth(dy), 0);
+                int to_x   = qMin(img_center_x + brush_mask.halfWidth(dy), CurrentImage.width() - 1);
+
+                const quint8  *weight   = brush_mask.weights(dy) - img_center_x;
+                const quint16 *original = (const quint16 *)OriginalImage.constScanLine(y);
+
+                while (from_x <= to_x) {
+                    int tile_x    = from_x / TiledImage::TILE_SIZE;
+                    int tile_left = tile_x * TiledImage::TILE_SIZE;
+                    int span_end  = qMin(to_x, tile_left + TiledImage::TILE_SIZE - 1);
+
+                    quint16 *current = (quint16 *)CurrentImage.scanLine(tile_x, y) - tile_left;
+
+                    for (int x = from_x; x <= span_end; x++) {
+                        quint16 target = original[x];
+
+                        if (CurrentMode != ModeOriginal) {
+                            target = ImageKernels::AdjustHue(target, CurrentHue);
+                        }
+
+                        current[x] = BrushMask::Blend(target, current[x], weight[x]);
                     }
+
+                    from_x = span_end + 1;
                 }
             }
         }
 
+        DisplayPyramid.setImage(CurrentImage);
+
         IsChanged = true;
 
-        update(center_x - BRUSH_SIZE, center_y - BRUSH_SIZE, BRUSH_SIZE * 2, BRUSH_SIZE * 2);
+        Autosaver->update("current", CurrentImage);
+
+        Repainter->update(QRectF(center_x - BrushSize, center_y - BrushSize, BrushSize * 2, BrushSize * 2));
 
         QImage helper_image = CurrentImage.copy(img_center_x - (HelperSize / scale) / 2,
                                                 img_center_y - (HelperSize / scale) / 2,
@@ -4,20 +4,28 @@
 #include <QObject>
 #include <QString>
 #include <QStack>
-#include <QHash>
 #include <QImage>
 #include <QGraphicsSceneMouseEvent>
 #include <QStyleOptionGraphicsItem>
 #include <QDeclarativeItem>
 
+#include "repaintcoalescer.h"
+#include "tilepyramid.h"
+#include "tiledimage.h"
+#include "brushmask.h"
+#include "editsession.h"
+#include "autosavewriter.h"
+
 class RecolorEditor : public QDeclarativeItem
 {
     Q_OBJECT
 
-    Q_PROPERTY(int  mode       READ mode       WRITE setMode)
-    Q_PROPERTY(int  helperSize READ helperSize WRITE setHelperSize)
-    Q_PROPERTY(int  hue        READ hue        WRITE setHue)
-    Q_PROPERTY(bool changed    READ changed)
+    Q_PROPERTY(int   mode          READ mode          WRITE setMode)
+    Q_PROPERTY(int   helperSize    READ helperSize    WRITE setHelperSize)
+    Q_PROPERTY(int   brushSize     READ brushSize     WRITE setBrushSize)
+    Q_PROPERTY(qreal brushHardness READ brushHardness WRITE setBrushHardness)
+    Q_PROPERTY(int   hue           READ hue           WRITE setHue)
+    Q_PROPERTY(bool  changed       READ changed)
 
     Q_ENUMS(Mode)
     Q_ENUMS(MouseState)
@@ -32,6 +40,12 @@ public:
     int  helperSize() const;
     void setHelperSize(const int &size);
 
+    int  brushSize() const;
+    void setBrushSize(const int &size);
+
+    qreal brushHardness() const;
+    void  setBrushHardness(const qreal &hardness);
+
     int  hue() const;
     void setHue(const int &hue);
 
@@ -41,6 +55,7 @@ public:
     Q_INVOKABLE void saveImage(const QString &image_url);
 
     Q_INVOKABLE void undo();
+    Q_INVOKABLE void discard();
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*);
 
@@ -75,39 +90,30 @@ protected:
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
 
 private:
-    union RGB16 {
-        quint16 rgb;
-        struct {
-            unsigned r : 5;
-            unsigned g : 6;
-            unsigned b : 5;
-        };
-    };
+    EditSession MakeSession() const;
 
-    union HSV {
-        quint32 hsv;
-        struct {
-            qint16 h;
-            quint8 s;
-            quint8 v;
-        };
-    };
-
-    QRgb AdjustHue(QRgb rgb);
+    bool ResumeSession(const QString &image_file);
+    void SaveSession();
 
     void SaveUndoImage();
     void ChangeImageAt(bool save_undo, int center_x, int center_y);
 
-    static const int UNDO_DEPTH  = 4,
-                     BRUSH_SIZE  = 16;
-
-    static const qreal IMAGE_MPIX_LIMIT = 1.0;
-
-    bool                    IsChanged;
-    int                     CurrentMode, HelperSize, CurrentHue;
-    QImage                  LoadedImage, OriginalImage, CurrentImage;
-    QStack<QImage>          UndoStack;
-    QHash<quint16, quint32> RGB16ToHSVMap;
+    static const int UNDO_DEPTH         = 4,
+                     DEFAULT_BRUSH_SIZE = 16;
+
+    static const qreal IMAGE_MPIX_LIMIT       = 1.0,
+                       DEFAULT_BRUSH_HARDNESS = 1.0;
+
+    bool               IsChanged;
+    int                CurrentMode, HelperSize, BrushSize, CurrentHue;
+    qreal              BrushHardness;
+    QString            SourceFile;
+    QImage             LoadedImage, OriginalImage;
+    TiledImage         CurrentImage;
+    QStack<TiledImage> UndoStack;
+    TilePyramid        DisplayPyramid;
+    RepaintCoalescer  *Repainter;
+    AutosaveWriter    *Autosaver;
 };
 
 #endif // RECOLOREDITOR_H
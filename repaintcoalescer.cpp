@@ -0,0 +1,65 @@
+#include "repaintcoalescer.h"
+#include "tracer.h"
+
+RepaintCoalescer::RepaintCoalescer(QGraphicsItem *item, QObject *parent) : QObject(parent)
+{
+    PendingStamps = 0;
+    StampsCount   = 0;
+    RepaintsCount = 0;
+    Item          = item;
+
+    FrameTimer.setSingleShot(true);
+
+    QObject::connect(&FrameTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+RepaintCoalescer::~RepaintCoalescer()
+{
+}
+
+int RepaintCoalescer::stamps() const
+{
+    return StampsCount;
+}
+
+int RepaintCoalescer::repaints() const
+{
+    return RepaintsCount;
+}
+
+void RepaintCoalescer::update(const QRectF &rect)
+{
+    DirtyRect = DirtyRect.united(rect);
+
+    PendingStamps++;
+    StampsCount++;
+
+    if (!FrameTimer.isActive()) {
+        qint64 elapsed = LastFlushTimer.isValid() ? LastFlushTimer.elapsed() : FRAME_INTERVAL;
+
+        if (elapsed >= FRAME_INTERVAL) {
+            flush();
+        } else {
+            FrameTimer.start(FRAME_INTERVAL - elapsed);
+        }
+    }
+}
+
+void RepaintCoalescer::flush()
+{
+    FrameTimer.stop();
+
+    if (PendingStamps != 0) {
+        Item->update(DirtyRect);
+
+        RepaintsCount++;
+
+        Tracer::Counter("stamps per repaint",  PendingStamps);
+        Tracer::Counter("stamps merged total", StampsCount - RepaintsCount);
+
+        PendingStamps = 0;
+        DirtyRect     = QRectF();
+
+        LastFlushTimer.start();
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef REPAINTCOALESCER_H
+#define REPAINTCOALESCER_H
+
+#include <QObject>
+#include <QRectF>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QGraphicsItem>
+
+// Collects the dirty rectangles of brush stamps and repaints their union at
+// most once per display frame.
+
+class RepaintCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RepaintCoalescer(QGraphicsItem *item, QObject *parent = 0);
+    virtual ~RepaintCoalescer();
+
+    int stamps() const;
+    int repaints() const;
+
+    void update(const QRectF &rect);
+
+public slots:
+    void flush();
+
+private:
+    static const int FRAME_INTERVAL = 16;
+
+    int            PendingStamps, StampsCount, RepaintsCount;
+    QRectF         DirtyRect;
+    QTimer         FrameTimer;
+    QElapsedTimer  LastFlushTimer;
+    QGraphicsItem *Item;
+};
+
+#endif // REPAINTCOALESCER_H
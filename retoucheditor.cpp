@@ -4,14 +4,20 @@
 #include <QPainter>
 
 #include "retoucheditor.h"
+#include "imagekernels.h"
+#include "tracer.h"
 
 RetouchEditor::RetouchEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 {
     IsChanged            = false;
     IsSamplingPointValid = false;
-    IsLastBlurPointValid = false;
     CurrentMode          = ModeScroll;
     HelperSize           = 0;
+    BrushSize            = DEFAULT_BRUSH_SIZE;
+    BrushHardness        = DEFAULT_BRUSH_HARDNESS;
+
+    Repainter = new RepaintCoalescer(this, this);
+    Autosaver = new AutosaveWriter(this);
 
     setAcceptedMouseButtons(Qt::LeftButton | Qt::RightButton | Qt::MiddleButton);
 
@@ -21,6 +27,7 @@ RetouchEditor::RetouchEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent
 
 RetouchEditor::~RetouchEditor()
 {
+    SaveSession();
 }
 
 int RetouchEditor::mode() const
@@ -43,6 +50,26 @@ void RetouchEditor::setHelperSize(const int &size)
     HelperSize = size;
 }
 
+int RetouchEditor::brushSize() const
+{
+    return BrushSize;
+}
+
+void RetouchEditor::setBrushSize(const int &size)
+{
+    BrushSize = qMax(size, 1);
+}
+
+qreal RetouchEditor::brushHardness() const
+{
+    return BrushHardness;
+}
+
+void RetouchEditor::setBrushHardness(const qreal &hardness)
+{
+    BrushHardness = qBound((qreal)0.0, hardness, (qreal)1.0);
+}
+
 bool RetouchEditor::changed() const
 {
     return IsChanged;
@@ -60,8 +87,14 @@ QPoint RetouchEditor::samplingPoint() const
 
 void RetouchEditor::openImage(const QString &image_url)
 {
+    TRACE_SCOPE("RetouchEditor::openImage");
+
     QString image_file = QUrl(image_url).toLocalFile();
 
+    if (!image_file.isNull() && ResumeSession(image_file)) {
+        return;
+    }
+
     if (!image_file.isNull()) {
         QImageReader reader(image_file);
 
@@ -77,13 +110,21 @@ void RetouchEditor::openImage(const QString &image_url)
                 reader.setScaledSize(size);
             }
 
-            LoadedImage = reader.read();
+            {
+                TRACE_SCOPE("QImageReader::read");
+
+                LoadedImage = reader.read();
+            }
 
             if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+                LoadedImage = ImageKernels::ConvertToFormat(LoadedImage, QImage::Format_RGB16);
 
                 if (!LoadedImage.isNull()) {
-                    CurrentImage = LoadedImage;
+                    SourceFile = image_file;
+
+                    CurrentImage = TiledImage(LoadedImage);
+
+                    DisplayPyramid.setImage(CurrentImage);
 
                     LoadedImage = QImage();
 
@@ -92,6 +133,8 @@ void RetouchEditor::openImage(const QString &image_url)
                     IsChanged            = false;
                     IsSamplingPointValid = false;
 
+                    Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
                     setImplicitWidth(CurrentImage.width());
                     setImplicitHeight(CurrentImage.height());
 
@@ -116,6 +159,8 @@ void RetouchEditor::openImage(const QString &image_url)
 
 void RetouchEditor::saveImage(const QString &image_url)
 {
+    TRACE_SCOPE("RetouchEditor::saveImage");
+
     QString file_name = QUrl(image_url).toLocalFile();
 
     if (!file_name.isNull()) {
@@ -126,7 +171,7 @@ void RetouchEditor::saveImage(const QString &image_url)
                 file_name = file_name + ".jpg";
             }
 
-            if (CurrentImage.convertToFormat(QImage::Format_ARGB32).save(file_name)) {
+            if (CurrentImage.toImage().save(file_name)) {
                 IsChanged = false;
 
                 emit imageSaved();
@@ -146,18 +191,35 @@ void RetouchEditor::undo()
     if (UndoStack.size() > 0) {
         CurrentImage = UndoStack.pop();
 
+        DisplayPyramid.setImage(CurrentImage);
+
         if (UndoStack.size() == 0) {
             emit undoAvailabilityChanged(false);
         }
 
         IsChanged = true;
 
+        Autosaver->update("current", CurrentImage);
+
         update();
     }
 }
 
+void RetouchEditor::discard()
+{
+    Autosaver->stop();
+
+    IsChanged = false;
+
+    if (!SourceFile.isEmpty()) {
+        EditSession::Remove(SourceFile);
+    }
+}
+
 void RetouchEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*)
 {
+    TRACE_SCOPE("RetouchEditor::paint");
+
     qreal scale = 1.0;
 
     if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
@@ -171,12 +233,7 @@ void RetouchEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *opt
         painter->setRenderHint(QPainter::Antialiasing, true);
     }
 
-    QRectF src_rect(option->exposedRect.left()   / scale,
-                    option->exposedRect.top()    / scale,
-                    option->exposedRect.width()  / scale,
-                    option->exposedRect.height() / scale);
-
-    painter->drawImage(option->exposedRect, CurrentImage.copy(src_rect.toRect()));
+    DisplayPyramid.draw(painter, option->exposedRect, scale);
 
     painter->setRenderHint(QPainter::Antialiasing, antialiasing);
 }
@@ -227,12 +284,9 @@ void RetouchEditor::mousePressEvent(QGraphicsSceneMouseEvent *event)
             emit mouseEvent(MousePressed, event->pos().x(), event->pos().y());
         }
     } else if (CurrentMode == ModeBlur) {
-        ChangeImageAt(true, event->pos().x(), event->pos().y());
+        BrushBlurLayer.setSource(CurrentImage, GAUSSIAN_RADIUS);
 
-        IsLastBlurPointValid = true;
-
-        LastBlurPoint.setX(event->pos().x() / scale);
-        LastBlurPoint.setY(event->pos().y() / scale);
+        ChangeImageAt(true, event->pos().x(), event->pos().y());
 
         emit mouseEvent(MousePressed, event->pos().x(), event->pos().y());
     }
@@ -301,9 +355,6 @@ void RetouchEditor::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
     } else if (CurrentMode == ModeBlur) {
         ChangeImageAt(false, event->pos().x(), event->pos().y());
 
-        LastBlurPoint.setX(event->pos().x() / scale);
-        LastBlurPoint.setY(event->pos().y() / scale);
-
         emit mouseEvent(MouseMoved, event->pos().x(), event->pos().y());
     }
 }
@@ -313,12 +364,78 @@ void RetouchEditor::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     if (CurrentMode == ModeClone) {
         emit mouseEvent(MouseReleased, event->pos().x(), event->pos().y());
     } else if (CurrentMode == ModeBlur) {
-        IsLastBlurPointValid = false;
+        BrushBlurLayer.clear();
 
         emit mouseEvent(MouseReleased, event->pos().x(), event->pos().y());
     }
 }
 
+EditSession RetouchEditor::MakeSession() const
+{
+    EditSession session;
+
+    session.setEditor("retouch");
+    session.setSourceFile(SourceFile);
+    session.setImage("current", CurrentImage);
+    session.setJournal(UndoStack.toList());
+
+    return session;
+}
+
+bool RetouchEditor::ResumeSession(const QString &image_file)
+{
+    TRACE_SCOPE("RetouchEditor::ResumeSession");
+
+    EditSession session;
+
+    if (session.load(EditSession::FileFor(image_file)) && session.editor() == "retouch" && session.sourceUnchanged() &&
+        !session.image("current").isNull()) {
+        QList<TiledImage> journal = session.journal();
+
+        SourceFile   = image_file;
+        CurrentImage = session.image("current");
+
+        UndoStack.clear();
+
+        for (int i = 0; i < journal.size(); i++) {
+            UndoStack.push(journal.at(i));
+        }
+
+        DisplayPyramid.setImage(CurrentImage);
+
+        IsChanged            = true;
+        IsSamplingPointValid = false;
+
+        Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+        setImplicitWidth(CurrentImage.width());
+        setImplicitHeight(CurrentImage.height());
+
+        update();
+
+        emit samplingPointValidChanged();
+        emit undoAvailabilityChanged(!UndoStack.isEmpty());
+        emit imageOpened();
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void RetouchEditor::SaveSession()
+{
+    if (IsChanged) {
+        Autosaver->finish();
+    } else {
+        Autosaver->stop();
+
+        if (!SourceFile.isEmpty() && !CurrentImage.isNull()) {
+            EditSession::Remove(SourceFile);
+        }
+    }
+}
+
 void RetouchEditor::SaveUndoImage()
 {
     UndoStack.push(CurrentImage);
@@ -334,6 +451,8 @@ void RetouchEditor::SaveUndoImage()
 
 void RetouchEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 {
+    TRACE_SCOPE("RetouchEditor::ChangeImageAt");
+
     if (CurrentMode == ModeClone || CurrentMode == ModeBlur) {
         if (save_undo) {
             SaveUndoImage();
@@ -348,160 +467,23 @@ void RetouchEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 
         int img_center_x = center_x   / scale;
         int img_center_y = center_y   / scale;
-        int radius       = BRUSH_SIZE / scale;
+        int radius       = BrushSize  / scale;
+
+        BrushMask brush_mask = BrushMask::Cached(radius, BrushHardness);
 
         if (CurrentMode == ModeClone) {
-            for (int from_x = SamplingPoint.x() - radius, to_x = img_center_x - radius; from_x <= SamplingPoint.x() + radius && to_x <= img_center_x + radius; from_x++, to_x++) {
-                for (int from_y = SamplingPoint.y() - radius, to_y = img_center_y - radius; from_y <= SamplingPoint.y() + radius && to_y <= img_center_y + radius; from_y++, to_y++) {
-                    if (from_x >= 0 && from_x < CurrentImage.width() && from_y >= 0 && from_y < CurrentImage.height() && qSqrt(qPow(from_x - SamplingPoint.x(), 2) + qPow(from_y - SamplingPoint.y(), 2)) <= radius &&
-                        to_x   >= 0 && to_x   < CurrentImage.width() && to_y   >= 0 && to_y   < CurrentImage.height() && qSqrt(qPow(to_x   - img_center_x,      2) + qPow(to_y   - img_center_y,      2)) <= radius) {
-                        CurrentImage.setPixel(to_x, to_y, CurrentImage.pixel(from_x, from_y));
-                    }
-                }
-            }
+            brush_mask.clone(CurrentImage, SamplingPoint, QPoint(img_center_x, img_center_y));
         } else if (CurrentMode == ModeBlur) {
-            QRect  last_blur_rect(LastBlurPoint.x() - radius, LastBlurPoint.y() - radius, radius * 2, radius * 2);
-            QImage last_blur_image;
-
-            if (IsLastBlurPointValid) {
-                if (last_blur_rect.x() >= CurrentImage.width()) {
-                    last_blur_rect.setX(CurrentImage.width() - 1);
-                }
-                if (last_blur_rect.y() >= CurrentImage.height()) {
-                    last_blur_rect.setY(CurrentImage.height() - 1);
-                }
-                if (last_blur_rect.x() < 0) {
-                    last_blur_rect.setX(0);
-                }
-                if (last_blur_rect.y() < 0) {
-                    last_blur_rect.setY(0);
-                }
-                if (last_blur_rect.x() + last_blur_rect.width() > CurrentImage.width()) {
-                    last_blur_rect.setWidth(CurrentImage.width() - last_blur_rect.x());
-                }
-                if (last_blur_rect.y() + last_blur_rect.height() > CurrentImage.height()) {
-                    last_blur_rect.setHeight(CurrentImage.height() - last_blur_rect.y());
-                }
-
-                last_blur_image = CurrentImage.copy(last_blur_rect);
-            }
-
-            QRect blur_rect(img_center_x - radius, img_center_y - radius, radius * 2, radius * 2);
-
-            if (blur_rect.x() >= CurrentImage.width()) {
-                blur_rect.setX(CurrentImage.width() - 1);
-            }
-            if (blur_rect.y() >= CurrentImage.height()) {
-                blur_rect.setY(CurrentImage.height() - 1);
-            }
-            if (blur_rect.x() < 0) {
-                blur_rect.setX(0);
-            }
-            if (blur_rect.y() < 0) {
-                blur_rect.setY(0);
-            }
-            if (blur_rect.x() + blur_rect.width() > CurrentImage.width()) {
-                blur_rect.setWidth(CurrentImage.width() - blur_rect.x());
-            }
-            if (blur_rect.y() + blur_rect.height() > CurrentImage.height()) {
-                blur_rect.setHeight(CurrentImage.height() - blur_rect.y());
-            }
-
-            QImage blur_image = CurrentImage.copy(blur_rect).convertToFormat(QImage::Format_ARGB32_Premultiplied);
-
-            int tab[] = { 14, 10, 8, 6, 5, 5, 4, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2 };
-            int alpha = (GAUSSIAN_RADIUS < 1) ? 16 : (GAUSSIAN_RADIUS > 17) ? 1 : tab[GAUSSIAN_RADIUS - 1];
-
-            int r1 = blur_image.rect().top();
-            int r2 = blur_image.rect().bottom();
-            int c1 = blur_image.rect().left();
-            int c2 = blur_image.rect().right();
-
-            int bpl = blur_image.bytesPerLine();
-
-            int           rgba[4];
-            unsigned char *p;
-
-            for (int col = c1; col <= c2; col++) {
-                p = blur_image.scanLine(r1) + col * 4;
-
-                for (int i = 0; i < 4; i++) {
-                    rgba[i] = p[i] << 4;
-                }
-
-                p += bpl;
-
-                for (int j = r1; j < r2; j++, p += bpl) {
-                    for (int i = 0; i < 4; i++) {
-                        p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-                    }
-                }
-            }
-
-            for (int row = r1; row <= r2; row++) {
-                p = blur_image.scanLine(row) + c1 * 4;
-
-                for (int i = 0; i < 4; i++) {
-                    rgba[i] = p[i] << 4;
-                }
-
-                p += 4;
-
-                for (int j = c1; j < c2; j++, p += 4) {
-                    for (int i = 0; i < 4; i++) {
-                        p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-                    }
-                }
-            }
-
-            for (int col = c1; col <= c2; col++) {
-                p = blur_image.scanLine(r2) + col * 4;
-
-                for (int i = 0; i < 4; i++) {
-                    rgba[i] = p[i] << 4;
-                }
-
-                p -= bpl;
-
-                for (int j = r1; j < r2; j++, p -= bpl) {
-                    for (int i = 0; i < 4; i++) {
-                        p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-                    }
-                }
-            }
-
-            for (int row = r1; row <= r2; row++) {
-                p = blur_image.scanLine(row) + c2 * 4;
-
-                for (int i = 0; i < 4; i++) {
-                    rgba[i] = p[i] << 4;
-                }
-
-                p -= 4;
-
-                for (int j = c1; j < c2; j++, p -= 4) {
-                    for (int i = 0; i < 4; i++) {
-                        p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-                    }
-                }
-            }
-
-            QPainter painter(&CurrentImage);
-
-            painter.setClipRegion(QRegion(blur_rect, QRegion::Ellipse));
-
-            painter.drawImage(blur_rect, blur_image);
-
-            if (IsLastBlurPointValid) {
-                painter.setClipRegion(QRegion(last_blur_rect, QRegion::Ellipse));
-
-                painter.drawImage(last_blur_rect, last_blur_image);
-            }
+            BrushBlurLayer.stamp(CurrentImage, brush_mask, QPoint(img_center_x, img_center_y));
         }
 
+        DisplayPyramid.setImage(CurrentImage);
+
         IsChanged = true;
 
-        update(center_x - BRUSH_SIZE, center_y - BRUSH_SIZE, BRUSH_SIZE * 2, BRUSH_SIZE * 2);
+        Autosaver->update("current", CurrentImage);
+
+        Repainter->update(QRectF(center_x - BrushSize, center_y - BrushSize, BrushSize * 2, BrushSize * 2));
 
         QImage helper_image = CurrentImage.copy(img_center_x - (HelperSize / scale) / 2,
                                                 img_center_y - (HelperSize / scale) / 2,
@@ -10,12 +10,22 @@
 #include <QStyleOptionGraphicsItem>
 #include <QDeclarativeItem>
 
+#include "repaintcoalescer.h"
+#include "tilepyramid.h"
+#include "tiledimage.h"
+#include "brushmask.h"
+#include "blurlayer.h"
+#include "editsession.h"
+#include "autosavewriter.h"
+
 class RetouchEditor : public QDeclarativeItem
 {
     Q_OBJECT
 
     Q_PROPERTY(int    mode               READ mode               WRITE  setMode)
     Q_PROPERTY(int    helperSize         READ helperSize         WRITE  setHelperSize)
+    Q_PROPERTY(int    brushSize          READ brushSize          WRITE  setBrushSize)
+    Q_PROPERTY(qreal  brushHardness      READ brushHardness      WRITE  setBrushHardness)
     Q_PROPERTY(bool   changed            READ changed)
     Q_PROPERTY(bool   samplingPointValid READ samplingPointValid NOTIFY samplingPointValidChanged)
     Q_PROPERTY(QPoint samplingPoint      READ samplingPoint      NOTIFY samplingPointChanged)
@@ -33,6 +43,12 @@ public:
     int  helperSize() const;
     void setHelperSize(const int &size);
 
+    int  brushSize() const;
+    void setBrushSize(const int &size);
+
+    qreal brushHardness() const;
+    void  setBrushHardness(const qreal &hardness);
+
     bool   changed() const;
     bool   samplingPointValid() const;
     QPoint samplingPoint() const;
@@ -41,6 +57,7 @@ public:
     Q_INVOKABLE void saveImage(const QString &image_url);
 
     Q_INVOKABLE void undo();
+    Q_INVOKABLE void discard();
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*);
 
@@ -79,20 +96,32 @@ protected:
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
 
 private:
+    EditSession MakeSession() const;
+
+    bool ResumeSession(const QString &image_file);
+    void SaveSession();
     void SaveUndoImage();
     void ChangeImageAt(bool save_undo, int center_x, int center_y);
 
-    static const int UNDO_DEPTH      = 4,
-                     BRUSH_SIZE      = 16,
-                     GAUSSIAN_RADIUS = 4;
-
-    static const qreal IMAGE_MPIX_LIMIT = 1.0;
-
-    bool           IsChanged, IsSamplingPointValid, IsLastBlurPointValid;
-    int            CurrentMode, HelperSize;
-    QPoint         SamplingPoint, InitialSamplingPoint, LastBlurPoint, InitialTouchPoint;
-    QImage         LoadedImage, CurrentImage;
-    QStack<QImage> UndoStack;
+    static const int UNDO_DEPTH         = 4,
+                     DEFAULT_BRUSH_SIZE = 16,
+                     GAUSSIAN_RADIUS    = 5;
+
+    static const qreal IMAGE_MPIX_LIMIT       = 1.0,
+                       DEFAULT_BRUSH_HARDNESS = 0.75;
+
+    bool               IsChanged, IsSamplingPointValid;
+    int                CurrentMode, HelperSize, BrushSize;
+    qreal              BrushHardness;
+    QPoint             SamplingPoint, InitialSamplingPoint, InitialTouchPoint;
+    QString            SourceFile;
+    QImage             LoadedImage;
+    TiledImage         CurrentImage;
+    QStack<TiledImage> UndoStack;
+    BlurLayer          BrushBlurLayer;
+    TilePyramid        DisplayPyramid;
+    RepaintCoalescer   *Repainter;
+    AutosaveWriter     *Autosaver;
 };
 
 #endif // RETOUCHEDITOR_H
@@ -1,17 +1,26 @@
 #include <qmath.h>
 #include <QFileInfo>
-#include <QThread>
 #include <QImageReader>
 #include <QPainter>
 
 #include "sketcheditor.h"
+#include "imagekernels.h"
+#include "exifthumbnail.h"
+#include "effectscheduler.h"
+#include "tracer.h"
 
 SketchEditor::SketchEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 {
     IsChanged      = false;
     CurrentMode    = ModeScroll;
     HelperSize     = 0;
+    BrushSize      = DEFAULT_BRUSH_SIZE;
+    BrushHardness  = DEFAULT_BRUSH_HARDNESS;
     GaussianRadius = 0;
+    SketchStyle    = StyleDodge;
+
+    Repainter = new RepaintCoalescer(this, this);
+    Autosaver = new AutosaveWriter(this);
 
     setAcceptedMouseButtons(Qt::LeftButton | Qt::RightButton | Qt::MiddleButton);
 
@@ -21,6 +30,9 @@ SketchEditor::SketchEditor(QDeclarativeItem *parent) : QDeclarativeItem(parent)
 
 SketchEditor::~SketchEditor()
 {
+    EffectScheduler::Instance()->cancel(this);
+
+    SaveSession();
 }
 
 int SketchEditor::mode() const
@@ -43,6 +55,26 @@ void SketchEditor::setHelperSize(const int &size)
     HelperSize = size;
 }
 
+int SketchEditor::brushSize() const
+{
+    return BrushSize;
+}
+
+void SketchEditor::setBrushSize(const int &size)
+{
+    BrushSize = qMax(size, 1);
+}
+
+qreal SketchEditor::brushHardness() const
+{
+    return BrushHardness;
+}
+
+void SketchEditor::setBrushHardness(const qreal &hardness)
+{
+    BrushHardness = qBound((qreal)0.0, hardness, (qreal)1.0);
+}
+
 int SketchEditor::radius() const
 {
     return GaussianRadius;
@@ -53,6 +85,16 @@ void SketchEditor::setRadius(const int &radius)
     GaussianRadius = radius;
 }
 
+int SketchEditor::style() const
+{
+    return SketchStyle;
+}
+
+void SketchEditor::setStyle(const int &style)
+{
+    SketchStyle = style;
+}
+
 bool SketchEditor::changed() const
 {
     return IsChanged;
@@ -60,8 +102,14 @@ bool SketchEditor::changed() const
 
 void SketchEditor::openImage(const QString &image_url)
 {
+    TRACE_SCOPE("SketchEditor::openImage");
+
     QString image_file = QUrl(image_url).toLocalFile();
 
+    if (!image_file.isNull() && ResumeSession(image_file)) {
+        return;
+    }
+
     if (!image_file.isNull()) {
         QImageReader reader(image_file);
 
@@ -77,27 +125,29 @@ void SketchEditor::openImage(const QString &image_url)
                 reader.setScaledSize(size);
             }
 
-            LoadedImage = reader.read();
+            {
+                TRACE_SCOPE("QImageReader::read");
+
+                LoadedImage = reader.read();
+            }
 
             if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+                LoadedImage = ImageKernels::ConvertToFormat(LoadedImage, QImage::Format_RGB16);
 
                 if (!LoadedImage.isNull()) {
-                    QThread              *thread    = new QThread();
-                    SketchImageGenerator *generator = new SketchImageGenerator();
+                    SourceFile = image_file;
 
-                    generator->moveToThread(thread);
+                    SketchImageGenerator *generator = new SketchImageGenerator();
 
-                    QObject::connect(thread,    SIGNAL(started()),                  generator, SLOT(start()));
-                    QObject::connect(thread,    SIGNAL(finished()),                 thread,    SLOT(deleteLater()));
                     QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this,      SLOT(effectedImageReady(const QImage &)));
-                    QObject::connect(generator, SIGNAL(finished()),                 thread,    SLOT(quit()));
                     QObject::connect(generator, SIGNAL(finished()),                 generator, SLOT(deleteLater()));
 
                     generator->setGaussianRadius(GaussianRadius);
+                    generator->setSketchStyle(SketchStyle);
                     generator->setInput(LoadedImage);
 
-                    thread->start(QThread::LowPriority);
+                    EffectScheduler::Instance()->cancel(this);
+                    EffectScheduler::Instance()->schedule(generator, EffectScheduler::PriorityBackground, this);
                 } else {
                     emit imageOpenFailed();
                 }
@@ -114,17 +164,19 @@ void SketchEditor::openImage(const QString &image_url)
 
 void SketchEditor::saveImage(const QString &image_url)
 {
+    TRACE_SCOPE("SketchEditor::saveImage");
+
     QString file_name = QUrl(image_url).toLocalFile();
 
     if (!file_name.isNull()) {
-        if (!CurrentImage.isNull()) {
+        if (!CurrentMask.isNull()) {
             if (QFileInfo(file_name).suffix().compare("png", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("jpg", Qt::CaseInsensitive) != 0 &&
                 QFileInfo(file_name).suffix().compare("bmp", Qt::CaseInsensitive) != 0) {
                 file_name = file_name + ".jpg";
             }
 
-            if (CurrentImage.convertToFormat(QImage::Format_ARGB32).save(file_name)) {
+            if (CurrentMask.composite(OriginalImage, EffectedImage, OriginalImage.rect()).save(file_name)) {
                 IsChanged = false;
 
                 emit imageSaved();
@@ -142,7 +194,9 @@ void SketchEditor::saveImage(const QString &image_url)
 void SketchEditor::undo()
 {
     if (UndoStack.size() > 0) {
-        CurrentImage = UndoStack.pop();
+        CurrentMask = UndoStack.pop();
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         if (UndoStack.size() == 0) {
             emit undoAvailabilityChanged(false);
@@ -150,17 +204,32 @@ void SketchEditor::undo()
 
         IsChanged = true;
 
+        Autosaver->update("mask", CurrentMask.weights());
+
         update();
     }
 }
 
+void SketchEditor::discard()
+{
+    Autosaver->stop();
+
+    IsChanged = false;
+
+    if (!SourceFile.isEmpty()) {
+        EditSession::Remove(SourceFile);
+    }
+}
+
 void SketchEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*)
 {
+    TRACE_SCOPE("SketchEditor::paint");
+
     qreal scale = 1.0;
 
-    if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-        scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                width() / CurrentImage.width() : height() / CurrentImage.height();
+    if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+        scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                width() / OriginalImage.width() : height() / OriginalImage.height();
     }
 
     bool antialiasing = painter->testRenderHint(QPainter::Antialiasing);
@@ -169,21 +238,22 @@ void SketchEditor::paint(QPainter *painter, const QStyleOptionGraphicsItem *opti
         painter->setRenderHint(QPainter::Antialiasing, true);
     }
 
-    QRectF src_rect(option->exposedRect.left()   / scale,
-                    option->exposedRect.top()    / scale,
-                    option->exposedRect.width()  / scale,
-                    option->exposedRect.height() / scale);
-
-    painter->drawImage(option->exposedRect, CurrentImage.copy(src_rect.toRect()));
+    DisplayPyramid.draw(painter, option->exposedRect, scale);
 
     painter->setRenderHint(QPainter::Antialiasing, antialiasing);
 }
 
 void SketchEditor::effectedImageReady(const QImage &effected_image)
 {
+    Tracer::AsyncEnd("imageReady delivery", sender());
+
+    TRACE_SCOPE("SketchEditor::effectedImageReady");
+
     OriginalImage = LoadedImage;
     EffectedImage = effected_image;
-    CurrentImage  = EffectedImage;
+    CurrentMask   = EffectMask(EffectedImage.size());
+
+    DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
     LoadedImage = QImage();
 
@@ -191,8 +261,10 @@ void SketchEditor::effectedImageReady(const QImage &effected_image)
 
     IsChanged = true;
 
-    setImplicitWidth(CurrentImage.width());
-    setImplicitHeight(CurrentImage.height());
+    Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+    setImplicitWidth(EffectedImage.width());
+    setImplicitHeight(EffectedImage.height());
 
     update();
 
@@ -225,9 +297,86 @@ void SketchEditor::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     }
 }
 
+EditSession SketchEditor::MakeSession() const
+{
+    EditSession       session;
+    QList<TiledImage> journal;
+
+    for (int i = 0; i < UndoStack.size(); i++) {
+        journal.append(UndoStack.at(i).weights());
+    }
+
+    session.setEditor("sketch");
+    session.setSourceFile(SourceFile);
+    session.setParameter("radius", GaussianRadius);
+    session.setParameter("style",  SketchStyle);
+    session.setImage("mask",     CurrentMask.weights());
+    session.setImage("original", TiledImage(OriginalImage));
+    session.setImage("effected", TiledImage(EffectedImage));
+    session.setJournal(journal);
+
+    return session;
+}
+
+bool SketchEditor::ResumeSession(const QString &image_file)
+{
+    TRACE_SCOPE("SketchEditor::ResumeSession");
+
+    EditSession session;
+
+    if (session.load(EditSession::FileFor(image_file)) && session.editor() == "sketch" && session.sourceUnchanged() &&
+        session.parameter("radius") == GaussianRadius && session.parameter("style") == SketchStyle &&
+        session.image("original").size() == session.image("mask").size() &&
+        session.image("effected").size() == session.image("mask").size() && !session.image("mask").isNull()) {
+        QList<TiledImage> journal = session.journal();
+
+        SourceFile    = image_file;
+        OriginalImage = session.image("original").toImage();
+        EffectedImage = session.image("effected").toImage();
+        CurrentMask   = EffectMask(session.image("mask"));
+
+        UndoStack.clear();
+
+        for (int i = 0; i < journal.size(); i++) {
+            UndoStack.push(EffectMask(journal.at(i)));
+        }
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
+
+        IsChanged = true;
+
+        Autosaver->start(EditSession::FileFor(SourceFile), MakeSession());
+
+        setImplicitWidth(OriginalImage.width());
+        setImplicitHeight(OriginalImage.height());
+
+        update();
+
+        emit undoAvailabilityChanged(!UndoStack.isEmpty());
+        emit imageOpened();
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void SketchEditor::SaveSession()
+{
+    if (IsChanged) {
+        Autosaver->finish();
+    } else {
+        Autosaver->stop();
+
+        if (!SourceFile.isEmpty() && !CurrentMask.isNull()) {
+            EditSession::Remove(SourceFile);
+        }
+    }
+}
+
 void SketchEditor::SaveUndoImage()
 {
-    UndoStack.push(CurrentImage);
+    UndoStack.push(CurrentMask);
 
     if (UndoStack.size() > UNDO_DEPTH) {
         for (int i = 0; i < UndoStack.size() - UNDO_DEPTH; i++) {
@@ -240,6 +389,8 @@ void SketchEditor::SaveUndoImage()
 
 void SketchEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 {
+    TRACE_SCOPE("SketchEditor::ChangeImageAt");
+
     if (CurrentMode != ModeScroll) {
         if (save_undo) {
             SaveUndoImage();
@@ -247,35 +398,31 @@ void SketchEditor::ChangeImageAt(bool save_undo, int center_x, int center_y)
 
         qreal scale = 1.0;
 
-        if (CurrentImage.width() != 0 && CurrentImage.height() != 0) {
-            scale = width() / CurrentImage.width() < height() / CurrentImage.height() ?
-                    width() / CurrentImage.width() : height() / CurrentImage.height();
+        if (OriginalImage.width() != 0 && OriginalImage.height() != 0) {
+            scale = width() / OriginalImage.width() < height() / OriginalImage.height() ?
+                    width() / OriginalImage.width() : height() / OriginalImage.height();
         }
 
         int img_center_x = center_x   / scale;
         int img_center_y = center_y   / scale;
-        int radius       = BRUSH_SIZE / scale;
-
-        for (int x = img_center_x - radius; x <= img_center_x + radius; x++) {
-            for (int y = img_center_y - radius; y <= img_center_y + radius; y++) {
-                if (x >= 0 && x < CurrentImage.width() && y >= 0 && y < CurrentImage.height() && qSqrt(qPow(x - img_center_x, 2) + qPow(y - img_center_y, 2)) <= radius) {
-                    if (CurrentMode == ModeOriginal) {
-                        CurrentImage.setPixel(x, y, OriginalImage.pixel(x, y));
-                    } else {
-                        CurrentImage.setPixel(x, y, EffectedImage.pixel(x, y));
-                    }
-                }
-            }
-        }
+        int radius       = BrushSize  / scale;
+
+        CurrentMask.stamp(BrushMask::Cached(radius, BrushHardness), QPoint(img_center_x, img_center_y), CurrentMode == ModeOriginal ? 0 : BrushMask::MAX_WEIGHT);
+
+        DisplayPyramid.setComposite(CurrentMask, OriginalImage, EffectedImage);
 
         IsChanged = true;
 
-        update(center_x - BRUSH_SIZE, center_y - BRUSH_SIZE, BRUSH_SIZE * 2, BRUSH_SIZE * 2);
+        Autosaver->update("mask", CurrentMask.weights());
+
+        Repainter->update(QRectF(center_x - BrushSize, center_y - BrushSize, BrushSize * 2, BrushSize * 2));
+
+        QRect helper_rect(img_center_x - (HelperSize / scale) / 2,
+                          img_center_y - (HelperSize / scale) / 2,
+                          HelperSize / scale,
+                          HelperSize / scale);
 
-        QImage helper_image = CurrentImage.copy(img_center_x - (HelperSize / scale) / 2,
-                                                img_center_y - (HelperSize / scale) / 2,
-                                                HelperSize / scale,
-                                                HelperSize / scale).scaledToWidth(HelperSize);
+        QImage helper_image = CurrentMask.composite(OriginalImage, EffectedImage, helper_rect).scaledToWidth(HelperSize);
 
         emit helperImageReady(helper_image);
     }
@@ -286,12 +433,19 @@ SketchPreviewGenerator::SketchPreviewGenerator(QDeclarativeItem *parent) : QDecl
     SketchGeneratorRunning = false;
     RestartSketchGenerator = false;
     GaussianRadius         = 0;
+    SketchStyle            = SketchEditor::StyleDodge;
+
+    Source = new PreviewSource(this, IMAGE_MPIX_LIMIT, this);
+
+    QObject::connect(Source, SIGNAL(retargeted()),     this, SLOT(reloadImage()));
+    QObject::connect(Source, SIGNAL(generationDue()), this, SLOT(generate()));
 
     setFlag(QGraphicsItem::ItemHasNoContents, false);
 }
 
 SketchPreviewGenerator::~SketchPreviewGenerator()
 {
+    EffectScheduler::Instance()->cancel(this);
 }
 
 int SketchPreviewGenerator::radius() const
@@ -304,55 +458,34 @@ void SketchPreviewGenerator::setRadius(const int &radius)
     GaussianRadius = radius;
 
     if (!LoadedImage.isNull()) {
-        if (SketchGeneratorRunning) {
-            RestartSketchGenerator = true;
-        } else {
-            StartSketchGenerator();
-        }
+        Source->requestGeneration();
     }
 }
 
-void SketchPreviewGenerator::openImage(const QString &image_url)
+int SketchPreviewGenerator::style() const
 {
-    QString image_file = QUrl(image_url).toLocalFile();
-
-    if (!image_file.isNull()) {
-        QImageReader reader(image_file);
-
-        if (reader.canRead()) {
-            QSize size = reader.size();
-
-            if (size.width() * size.height() > IMAGE_MPIX_LIMIT * 1000000.0) {
-                qreal factor = qSqrt((size.width() * size.height()) / (IMAGE_MPIX_LIMIT * 1000000.0));
+    return SketchStyle;
+}
 
-                size.setWidth(size.width()   / factor);
-                size.setHeight(size.height() / factor);
+void SketchPreviewGenerator::setStyle(const int &style)
+{
+    SketchStyle = style;
 
-                reader.setScaledSize(size);
-            }
+    if (!LoadedImage.isNull()) {
+        Source->requestGeneration();
+    }
+}
 
-            LoadedImage = reader.read();
+void SketchPreviewGenerator::openImage(const QString &image_url)
+{
+    TRACE_SCOPE("SketchPreviewGenerator::openImage");
 
-            if (!LoadedImage.isNull()) {
-                LoadedImage = LoadedImage.convertToFormat(QImage::Format_RGB16);
+    LoadedImage = Source->load(QUrl(image_url).toLocalFile());
 
-                if (!LoadedImage.isNull()) {
-                    emit imageOpened();
+    if (!LoadedImage.isNull()) {
+        emit imageOpened();
 
-                    if (SketchGeneratorRunning) {
-                        RestartSketchGenerator = true;
-                    } else {
-                        StartSketchGenerator();
-                    }
-                } else {
-                    emit imageOpenFailed();
-                }
-            } else {
-                emit imageOpenFailed();
-            }
-        } else {
-            emit imageOpenFailed();
-        }
+        Source->requestGeneration();
     } else {
         emit imageOpenFailed();
     }
@@ -360,6 +493,8 @@ void SketchPreviewGenerator::openImage(const QString &image_url)
 
 void SketchPreviewGenerator::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
+    TRACE_SCOPE("SketchPreviewGenerator::paint");
+
     qreal scale = 1.0;
 
     if (SketchImage.width() != 0 && SketchImage.height() != 0) {
@@ -388,6 +523,10 @@ void SketchPreviewGenerator::paint(QPainter *painter, const QStyleOptionGraphics
 
 void SketchPreviewGenerator::sketchImageReady(const QImage &sketch_image)
 {
+    Tracer::AsyncEnd("imageReady delivery", sender());
+
+    TRACE_SCOPE("SketchPreviewGenerator::sketchImageReady");
+
     SketchGeneratorRunning = false;
     SketchImage            = sketch_image;
 
@@ -405,23 +544,49 @@ void SketchPreviewGenerator::sketchImageReady(const QImage &sketch_image)
     }
 }
 
+void SketchPreviewGenerator::reloadImage()
+{
+    TRACE_SCOPE("SketchPreviewGenerator::reloadImage");
+
+    QImage image = Source->reload();
+
+    if (!image.isNull()) {
+        LoadedImage = image;
+
+        Source->requestGeneration();
+    }
+}
+
+void SketchPreviewGenerator::generate()
+{
+    if (SketchGeneratorRunning) {
+        RestartSketchGenerator = true;
+    } else {
+        StartSketchGenerator();
+    }
+}
+
+void SketchPreviewGenerator::geometryChanged(const QRectF &new_geometry, const QRectF &old_geometry)
+{
+    QDeclarativeItem::geometryChanged(new_geometry, old_geometry);
+
+    if (new_geometry.size() != old_geometry.size()) {
+        Source->itemResized();
+    }
+}
+
 void SketchPreviewGenerator::StartSketchGenerator()
 {
-    QThread              *thread    = new QThread();
     SketchImageGenerator *generator = new SketchImageGenerator();
 
-    generator->moveToThread(thread);
-
-    QObject::connect(thread,    SIGNAL(started()),                  generator, SLOT(start()));
-    QObject::connect(thread,    SIGNAL(finished()),                 thread,    SLOT(deleteLater()));
     QObject::connect(generator, SIGNAL(imageReady(const QImage &)), this,      SLOT(sketchImageReady(const QImage &)));
-    QObject::connect(generator, SIGNAL(finished()),                 thread,    SLOT(quit()));
     QObject::connect(generator, SIGNAL(finished()),                 generator, SLOT(deleteLater()));
 
     generator->setGaussianRadius(GaussianRadius);
+    generator->setSketchStyle(SketchStyle);
     generator->setInput(LoadedImage);
 
-    thread->start(QThread::LowPriority);
+    EffectScheduler::Instance()->schedule(generator, EffectScheduler::PriorityInteractive, this);
 
     SketchGeneratorRunning = true;
 
@@ -431,6 +596,7 @@ void SketchPreviewGenerator::StartSketchGenerator()
 SketchImageGenerator::SketchImageGenerator(QObject *parent) : QObject(parent)
 {
     GaussianRadius = 0;
+    SketchStyle    = ImageKernels::StyleDodge;
 }
 
 SketchImageGenerator::~SketchImageGenerator()
@@ -442,6 +608,11 @@ void SketchImageGenerator::setGaussianRadius(const int &radius)
     GaussianRadius = radius;
 }
 
+void SketchImageGenerator::setSketchStyle(const int &style)
+{
+    SketchStyle = style;
+}
+
 void SketchImageGenerator::setInput(const QImage &input_image)
 {
     InputImage = input_image;
@@ -449,123 +620,13 @@ void SketchImageGenerator::setInput(const QImage &input_image)
 
 void SketchImageGenerator::start()
 {
-    QImage grayscale_image = InputImage;
-    QImage sketch_image    = InputImage;
-
-    // Make Gaussian blur of original image
+    TRACE_SCOPE("SketchImageGenerator::start");
 
-    QImage::Format format = sketch_image.format();
+    QImage sketch_image = ImageKernels::ToRGB16(InputImage);
 
-    sketch_image = sketch_image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    ImageKernels::Sketch(sketch_image, GaussianRadius, SketchStyle);
 
-    int tab[] = { 14, 10, 8, 6, 5, 5, 4, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2 };
-    int alpha = (GaussianRadius < 1) ? 16 : (GaussianRadius > 17) ? 1 : tab[GaussianRadius - 1];
-
-    int r1 = sketch_image.rect().top();
-    int r2 = sketch_image.rect().bottom();
-    int c1 = sketch_image.rect().left();
-    int c2 = sketch_image.rect().right();
-
-    int bpl = sketch_image.bytesPerLine();
-
-    int           rgba[4];
-    unsigned char *p;
-
-    for (int col = c1; col <= c2; col++) {
-        p = sketch_image.scanLine(r1) + col * 4;
-
-        for (int i = 0; i < 4; i++) {
-            rgba[i] = p[i] << 4;
-        }
-
-        p += bpl;
-
-        for (int j = r1; j < r2; j++, p += bpl) {
-            for (int i = 0; i < 4; i++) {
-                p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-            }
-        }
-    }
-
-    for (int row = r1; row <= r2; row++) {
-        p = sketch_image.scanLine(row) + c1 * 4;
-
-        for (int i = 0; i < 4; i++) {
-            rgba[i] = p[i] << 4;
-        }
-
-        p += 4;
-
-        for (int j = c1; j < c2; j++, p += 4) {
-            for (int i = 0; i < 4; i++) {
-                p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-            }
-        }
-    }
-
-    for (int col = c1; col <= c2; col++) {
-        p = sketch_image.scanLine(r2) + col * 4;
-
-        for (int i = 0; i < 4; i++) {
-            rgba[i] = p[i] << 4;
-        }
-
-        p -= bpl;
-
-        for (int j = r1; j < r2; j++, p -= bpl) {
-            for (int i = 0; i < 4; i++) {
-                p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-            }
-        }
-    }
-
-    for (int row = r1; row <= r2; row++) {
-        p = sketch_image.scanLine(row) + c2 * 4;
-
-        for (int i = 0; i < 4; i++) {
-            rgba[i] = p[i] << 4;
-        }
-
-        p -= 4;
-
-        for (int j = c1; j < c2; j++, p -= 4) {
-            for (int i = 0; i < 4; i++) {
-                p[i] = (rgba[i] += ((p[i] << 4) - rgba[i]) * alpha / 16) >> 4;
-            }
-        }
-    }
-
-    sketch_image = sketch_image.convertToFormat(format);
-
-    // Make grayscale image from original image & inverted grayscale from blurred
-
-    for (int x = 0; x < InputImage.width(); x++) {
-        for (int y = 0; y < InputImage.height(); y++) {
-            int gray  = qGray(InputImage.pixel(x, y));
-            int alpha = qAlpha(InputImage.pixel(x, y));
-
-            grayscale_image.setPixel(x, y, qRgba(gray, gray, gray, alpha));
-
-            int blr_gray = qGray(sketch_image.pixel(x, y));
-            int inv_gray = blr_gray >= 255 ? 0 : 255 - blr_gray;
-
-            sketch_image.setPixel(x, y, qRgba(inv_gray, inv_gray, inv_gray, alpha));
-        }
-    }
-
-    // Apply Color Dodge mixing to grayscale & inverted blurred grayscale images for sketch
-
-    for (int x = 0; x < sketch_image.width(); x++) {
-        for (int y = 0; y < sketch_image.height(); y++) {
-            int top_gray = qGray(sketch_image.pixel(x, y));
-            int btm_gray = qGray(grayscale_image.pixel(x, y));
-            int res_gray = top_gray >= 255 ? 255 : qMin(btm_gray * 255 / (255 - top_gray), 255);
-
-            int alpha    = qAlpha(sketch_image.pixel(x, y));
-
-            sketch_image.setPixel(x, y, qRgba(res_gray, res_gray, res_gray, alpha));
-        }
-    }
+    Tracer::AsyncBegin("imageReady delivery", this);
 
     emit imageReady(sketch_image);
     emit finished();
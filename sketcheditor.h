@@ -9,17 +9,30 @@
 #include <QStyleOptionGraphicsItem>
 #include <QDeclarativeItem>
 
+#include "repaintcoalescer.h"
+#include "tilepyramid.h"
+#include "brushmask.h"
+#include "effectmask.h"
+#include "editsession.h"
+#include "autosavewriter.h"
+#include "previewsource.h"
+#include "imagekernels.h"
+
 class SketchEditor : public QDeclarativeItem
 {
     Q_OBJECT
 
-    Q_PROPERTY(int  mode       READ mode       WRITE setMode)
-    Q_PROPERTY(int  helperSize READ helperSize WRITE setHelperSize)
-    Q_PROPERTY(int  radius     READ radius     WRITE setRadius)
-    Q_PROPERTY(bool changed    READ changed)
+    Q_PROPERTY(int   mode          READ mode          WRITE setMode)
+    Q_PROPERTY(int   helperSize    READ helperSize    WRITE setHelperSize)
+    Q_PROPERTY(int   brushSize     READ brushSize     WRITE setBrushSize)
+    Q_PROPERTY(qreal brushHardness READ brushHardness WRITE setBrushHardness)
+    Q_PROPERTY(int   radius        READ radius        WRITE setRadius)
+    Q_PROPERTY(int   style         READ style         WRITE setStyle)
+    Q_PROPERTY(bool  changed       READ changed)
 
     Q_ENUMS(Mode)
     Q_ENUMS(MouseState)
+    Q_ENUMS(Style)
 
 public:
     explicit SketchEditor(QDeclarativeItem *parent = 0);
@@ -31,15 +44,25 @@ public:
     int  helperSize() const;
     void setHelperSize(const int &size);
 
+    int  brushSize() const;
+    void setBrushSize(const int &size);
+
+    qreal brushHardness() const;
+    void  setBrushHardness(const qreal &hardness);
+
     int  radius() const;
     void setRadius(const int &radius);
 
+    int  style() const;
+    void setStyle(const int &style);
+
     bool changed() const;
 
     Q_INVOKABLE void openImage(const QString &image_url);
     Q_INVOKABLE void saveImage(const QString &image_url);
 
     Q_INVOKABLE void undo();
+    Q_INVOKABLE void discard();
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget*);
 
@@ -55,6 +78,12 @@ public:
         MouseReleased
     };
 
+    enum Style {
+        StyleDodge = ImageKernels::StyleDodge,
+        StyleSobel = ImageKernels::StyleSobel,
+        StyleDoG   = ImageKernels::StyleDoG
+    };
+
 public slots:
     void effectedImageReady(const QImage &effected_image);
 
@@ -77,18 +106,29 @@ protected:
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
 
 private:
+    EditSession MakeSession() const;
+
+    bool ResumeSession(const QString &image_file);
+    void SaveSession();
     void SaveUndoImage();
     void ChangeImageAt(bool save_undo, int center_x, int center_y);
 
-    static const int UNDO_DEPTH  = 4,
-                     BRUSH_SIZE  = 16;
-
-    static const qreal IMAGE_MPIX_LIMIT = 1.0;
-
-    bool           IsChanged;
-    int            CurrentMode, HelperSize, GaussianRadius;
-    QImage         LoadedImage, OriginalImage, EffectedImage, CurrentImage;
-    QStack<QImage> UndoStack;
+    static const int UNDO_DEPTH         = 4,
+                     DEFAULT_BRUSH_SIZE = 16;
+
+    static const qreal IMAGE_MPIX_LIMIT       = 1.0,
+                       DEFAULT_BRUSH_HARDNESS = 1.0;
+
+    bool               IsChanged;
+    int                CurrentMode, HelperSize, BrushSize, GaussianRadius, SketchStyle;
+    qreal              BrushHardness;
+    QString            SourceFile;
+    QImage             LoadedImage, OriginalImage, EffectedImage;
+    EffectMask         CurrentMask;
+    QStack<EffectMask> UndoStack;
+    TilePyramid        DisplayPyramid;
+    RepaintCoalescer   *Repainter;
+    AutosaveWriter     *Autosaver;
 };
 
 class SketchPreviewGenerator : public QDeclarativeItem
@@ -96,6 +136,7 @@ class SketchPreviewGenerator : public QDeclarativeItem
     Q_OBJECT
 
     Q_PROPERTY(int radius READ radius WRITE setRadius)
+    Q_PROPERTY(int style  READ style  WRITE setStyle)
 
 public:
     explicit SketchPreviewGenerator(QDeclarativeItem *parent = 0);
@@ -104,12 +145,17 @@ public:
     int  radius() const;
     void setRadius(const int &radius);
 
+    int  style() const;
+    void setStyle(const int &style);
+
     Q_INVOKABLE void openImage(const QString &image_url);
 
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*);
 
 public slots:
     void sketchImageReady(const QImage &sketch_image);
+    void reloadImage();
+    void generate();
 
 signals:
     void imageOpened();
@@ -118,14 +164,18 @@ signals:
     void generationStarted();
     void generationFinished();
 
+protected:
+    virtual void geometryChanged(const QRectF &new_geometry, const QRectF &old_geometry);
+
 private:
     void StartSketchGenerator();
 
     static const qreal IMAGE_MPIX_LIMIT = 0.2;
 
-    bool   SketchGeneratorRunning, RestartSketchGenerator;
-    int    GaussianRadius;
-    QImage LoadedImage, SketchImage;
+    bool           SketchGeneratorRunning, RestartSketchGenerator;
+    int            GaussianRadius, SketchStyle;
+    QImage         LoadedImage, SketchImage;
+    PreviewSource *Source;
 };
 
 class SketchImageGenerator : public QObject
@@ -137,6 +187,7 @@ public:
     virtual ~SketchImageGenerator();
 
     void setGaussianRadius(const int &radius);
+    void setSketchStyle(const int &style);
     void setInput(const QImage &input_image);
 
 public slots:
@@ -147,7 +198,7 @@ signals:
     void finished();
 
 private:
-    int    GaussianRadius;
+    int    GaussianRadius, SketchStyle;
     QImage InputImage;
 };
 
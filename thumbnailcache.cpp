@@ -0,0 +1,360 @@
+#include <string.h>
+#include <QDir>
+#include <QUrl>
+#include <QDateTime>
+#include <QByteArray>
+#include <QMutexLocker>
+#include <QImageReader>
+#include <QDesktopServices>
+
+#include "thumbnailcache.h"
+#include "exifthumbnail.h"
+#include "imagekernels.h"
+#include "effectscheduler.h"
+#include "tracer.h"
+
+ThumbnailCache::ThumbnailCache(QObject *parent) : QObject(parent)
+{
+    IsShuttingDown = false;
+    QueuedJobs     = 0;
+    MappedData     = 0;
+
+    MapFile();
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    {
+        QMutexLocker locker(&CacheMutex);
+
+        IsShuttingDown = true;
+    }
+
+    EffectScheduler::Instance()->cancel(this);
+    EffectScheduler::Instance()->waitFor(this);
+
+    if (MappedData != 0) {
+        CacheFile.unmap(MappedData);
+    }
+}
+
+bool ThumbnailCache::isMapped() const
+{
+    return MappedData != 0;
+}
+
+QImage ThumbnailCache::thumbnail(const QString &file_name)
+{
+    TRACE_SCOPE("ThumbnailCache::thumbnail");
+
+    QFileInfo file_info(file_name);
+
+    if (!file_info.exists()) {
+        return QImage();
+    } else if (MappedData == 0) {
+        return Generate(file_name);
+    }
+
+    quint64 key = Key(file_info);
+    QImage  image;
+
+    QMutexLocker locker(&CacheMutex);
+
+    // Wait for a thumbnail another thread is already generating
+
+    while (!Read(key, &image)) {
+        if (Pending.contains(key)) {
+            JobFinished.wait(&CacheMutex);
+        } else {
+            Pending.insert(key);
+
+            locker.unlock();
+
+            image = Generate(file_name);
+
+            locker.relock();
+
+            if (!image.isNull()) {
+                Write(key, image);
+            }
+
+            Pending.remove(key);
+
+            JobFinished.wakeAll();
+
+            break;
+        }
+    }
+
+    return image;
+}
+
+void ThumbnailCache::prefetch(const QString &image_url)
+{
+    QString file_name = FileName(image_url);
+
+    QMutexLocker locker(&CacheMutex);
+
+    if (MappedData != 0 && !IsShuttingDown) {
+        // Newest requests first; past MAX_QUEUED the oldest are dropped
+
+        PrefetchQueue.removeAll(file_name);
+        PrefetchQueue.append(file_name);
+
+        if (PrefetchQueue.size() > MAX_QUEUED) {
+            PrefetchQueue.removeFirst();
+        }
+
+        // A job takes the newest request when it starts
+
+        if (QueuedJobs < PrefetchQueue.size()) {
+            QueuedJobs++;
+
+            EffectScheduler::Instance()->schedule(new PrefetchJob(this), EffectScheduler::PriorityPrefetch, this);
+        }
+    }
+}
+
+void ThumbnailCache::cancelPrefetch(const QString &image_url)
+{
+    QString file_name = FileName(image_url);
+
+    QMutexLocker locker(&CacheMutex);
+
+    PrefetchQueue.removeAll(file_name);
+}
+
+ThumbnailCache::PrefetchJob::PrefetchJob(ThumbnailCache *cache) : QRunnable()
+{
+    Cache = cache;
+}
+
+void ThumbnailCache::PrefetchJob::run()
+{
+    Cache->RunPrefetch();
+}
+
+QString ThumbnailCache::FileName(const QString &image_url)
+{
+    return image_url.startsWith("file:") ? QUrl(image_url).toLocalFile() : image_url;
+}
+
+quint64 ThumbnailCache::Key(const QFileInfo &file_info)
+{
+    // 64-bit FNV-1a over the absolute path, file size and mtime
+
+    QString path   = file_info.absoluteFilePath();
+    quint64 key    = Q_UINT64_C(14695981039346656037);
+    quint64 values[2];
+
+    for (int i = 0; i < path.size(); i++) {
+        key = (key ^ path.at(i).unicode()) * Q_UINT64_C(1099511628211);
+    }
+
+    values[0] = file_info.size();
+    values[1] = file_info.lastModified().toTime_t();
+
+    for (int i = 0; i < 2; i++) {
+        for (int shift = 0; shift < 64; shift += 8) {
+            key = (key ^ ((values[i] >> shift) & 0xff)) * Q_UINT64_C(1099511628211);
+        }
+    }
+
+    return key != 0 ? key : 1;
+}
+
+QImage ThumbnailCache::Generate(const QString &file_name)
+{
+    TRACE_SCOPE("ThumbnailCache::Generate");
+
+    QImageReader reader(file_name);
+    QSize        image_size = reader.size();
+    QSize        size       = image_size;
+    QImage       image;
+
+    if (size.isValid() && (size.width() > THUMBNAIL_SIZE || size.height() > THUMBNAIL_SIZE)) {
+        size.scale(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio);
+        size = size.expandedTo(QSize(1, 1));
+
+        // An embedded camera thumbnail avoids decoding the main image
+
+        image = ExifThumbnail::Load(file_name, image_size, size, size / 2);
+
+        if (image.isNull()) {
+            reader.setScaledSize(size);
+        }
+    }
+
+    if (image.isNull()) {
+        image = reader.read();
+    }
+
+    if (!image.isNull()) {
+        if (image.width() > THUMBNAIL_SIZE || image.height() > THUMBNAIL_SIZE) {
+            image = image.scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+
+        image = ImageKernels::ConvertToFormat(image, QImage::Format_RGB16);
+    }
+
+    return image;
+}
+
+void ThumbnailCache::MapFile()
+{
+    QString cache_dir = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+
+    if (cache_dir.isEmpty() || !QDir().mkpath(cache_dir)) {
+        return;
+    }
+
+    CacheFile.setFileName(QDir(cache_dir).filePath("magicphotos-thumbnails.cache"));
+
+    if (CacheFile.open(QIODevice::ReadWrite)) {
+        if (CacheFile.size() < DIRECTORY_BYTES) {
+            CacheFile.resize(DIRECTORY_BYTES);
+        }
+
+        MappedData = CacheFile.map(0, DIRECTORY_BYTES);
+
+        if (MappedData != 0) {
+            quint32 *header = (quint32 *)MappedData;
+
+            // A file from another layout is reset to its directory
+
+            if (header[0] != CACHE_MAGIC || header[1] != CACHE_VERSION ||
+                header[2] != (quint32)THUMBNAIL_SIZE || header[3] != (quint32)SLOT_COUNT) {
+                memset(MappedData, 0, DIRECTORY_BYTES);
+
+                header[0] = CACHE_MAGIC;
+                header[1] = CACHE_VERSION;
+                header[2] = THUMBNAIL_SIZE;
+                header[3] = SLOT_COUNT;
+
+                CacheFile.resize(DIRECTORY_BYTES);
+            }
+        } else {
+            CacheFile.close();
+        }
+    }
+}
+
+void ThumbnailCache::RunPrefetch()
+{
+    QString file_name;
+
+    {
+        QMutexLocker locker(&CacheMutex);
+
+        QueuedJobs--;
+
+        if (!IsShuttingDown && !PrefetchQueue.isEmpty()) {
+            file_name = PrefetchQueue.takeLast();
+        }
+    }
+
+    if (!file_name.isEmpty()) {
+        thumbnail(file_name);
+    }
+}
+
+uchar *ThumbnailCache::Slot(int index) const
+{
+    return MappedData + HEADER_BYTES + index * SLOT_BYTES;
+}
+
+qint64 ThumbnailCache::PageOffset(int page) const
+{
+    return DIRECTORY_BYTES + (qint64)page * PAGE_BYTES;
+}
+
+// Header layout: magic, version, thumbnail size, slot count, LRU clock and
+// pages used, as quint32. Slot layout: quint64 key, quint32 LRU stamp,
+// quint16 width, quint16 height, quint32 page number plus one (0 while the
+// slot has no page yet), with the page holding height rows of width RGB16
+// pixels. Both are called with CacheMutex held.
+
+bool ThumbnailCache::Read(quint64 key, QImage *image)
+{
+    int set = key % (SLOT_COUNT / SET_WAYS);
+
+    for (int way = 0; way < SET_WAYS; way++) {
+        uchar *slot = Slot(set * SET_WAYS + way);
+
+        if (*(quint64 *)slot == key) {
+            quint32 *header = (quint32 *)MappedData;
+            quint16  width  = *(quint16 *)(slot + 12);
+            quint16  height = *(quint16 *)(slot + 14);
+            quint32  page   = *(quint32 *)(slot + 16);
+
+            QByteArray pixels;
+
+            if (page != 0 && CacheFile.seek(PageOffset(page - 1))) {
+                pixels = CacheFile.read(width * height * 2);
+            }
+
+            // A page cut short by a crash reads as a miss
+
+            if (pixels.size() != width * height * 2) {
+                *(quint64 *)slot = 0;
+
+                return false;
+            }
+
+            *(quint32 *)(slot + 8) = ++header[4];
+
+            *image = QImage(width, height, QImage::Format_RGB16);
+
+            for (int y = 0; y < height; y++) {
+                memcpy(image->scanLine(y), pixels.constData() + y * width * 2, width * 2);
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThumbnailCache::Write(quint64 key, const QImage &image)
+{
+    int    set    = key % (SLOT_COUNT / SET_WAYS);
+    uchar *victim = 0;
+
+    for (int way = 0; way < SET_WAYS; way++) {
+        uchar *slot = Slot(set * SET_WAYS + way);
+
+        if (*(quint64 *)slot == 0) {
+            victim = slot;
+
+            break;
+        } else if (victim == 0 || *(quint32 *)(slot + 8) < *(quint32 *)(victim + 8)) {
+            victim = slot;
+        }
+    }
+
+    quint32 *header = (quint32 *)MappedData;
+    int      width  = qMin(image.width(),  (int)THUMBNAIL_SIZE);
+    int      height = qMin(image.height(), (int)THUMBNAIL_SIZE);
+
+    // The key goes in last, so a slot interrupted mid-write reads as empty
+
+    *(quint64 *)victim = 0;
+
+    if (*(quint32 *)(victim + 16) == 0) {
+        *(quint32 *)(victim + 16) = ++header[5];
+    }
+
+    QByteArray pixels(width * height * 2, 0);
+
+    for (int y = 0; y < height; y++) {
+        memcpy(pixels.data() + y * width * 2, image.constScanLine(y), width * 2);
+    }
+
+    if (CacheFile.seek(PageOffset(*(quint32 *)(victim + 16) - 1)) && CacheFile.write(pixels) == pixels.size()) {
+        *(quint32 *)(victim + 8)  = ++header[4];
+        *(quint16 *)(victim + 12) = width;
+        *(quint16 *)(victim + 14) = height;
+        *(quint64 *)victim        = key;
+    }
+}
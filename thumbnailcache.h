@@ -0,0 +1,81 @@
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QRunnable>
+#include <QImage>
+
+// Persistent cache of picker thumbnails in one file: a memory-mapped slot
+// directory followed by RGB16 pixel pages, read and written through QFile as
+// each is copied to or from a QImage anyway. Entries are keyed by path, size
+// and mtime and grouped into small LRU sets; prefetches run newest first.
+
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailCache(QObject *parent = 0);
+    virtual ~ThumbnailCache();
+
+    static const int THUMBNAIL_SIZE = 160;
+
+    bool isMapped() const;
+
+    QImage thumbnail(const QString &file_name);
+
+    Q_INVOKABLE void prefetch(const QString &image_url);
+    Q_INVOKABLE void cancelPrefetch(const QString &image_url);
+
+private:
+    class PrefetchJob : public QRunnable
+    {
+    public:
+        explicit PrefetchJob(ThumbnailCache *cache);
+
+        virtual void run();
+
+    private:
+        ThumbnailCache *Cache;
+    };
+
+    static QString FileName(const QString &image_url);
+    static quint64 Key(const QFileInfo &file_info);
+    static QImage  Generate(const QString &file_name);
+
+    void   MapFile();
+    void   RunPrefetch();
+    uchar *Slot(int index) const;
+    qint64 PageOffset(int page) const;
+    bool   Read(quint64 key, QImage *image);
+    void   Write(quint64 key, const QImage &image);
+
+    static const quint32 CACHE_MAGIC   = 0x4d505443,
+                         CACHE_VERSION = 2;
+
+    static const int SLOT_COUNT      = 512,
+                     SET_WAYS        = 4,
+                     HEADER_BYTES    = 32,
+                     SLOT_BYTES      = 24,
+                     DIRECTORY_BYTES = HEADER_BYTES + SLOT_COUNT * SLOT_BYTES,
+                     PAGE_BYTES      = THUMBNAIL_SIZE * THUMBNAIL_SIZE * 2,
+                     MAX_QUEUED      = 64;
+
+    bool           IsShuttingDown;
+    int            QueuedJobs;
+    uchar         *MappedData;
+    QFile          CacheFile;
+    QStringList    PrefetchQueue;
+    QSet<quint64>  Pending;
+    QMutex         CacheMutex;
+    QWaitCondition JobFinished;
+};
+
+#endif // THUMBNAILCACHE_H
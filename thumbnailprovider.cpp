@@ -0,0 +1,43 @@
+#include <QUrl>
+
+#include "thumbnailprovider.h"
+#include "tracer.h"
+
+ThumbnailProvider::ThumbnailProvider(ThumbnailCache *cache) : QDeclarativeImageProvider(QDeclarativeImageProvider::Image)
+{
+    Cache = cache;
+}
+
+ThumbnailProvider::~ThumbnailProvider()
+{
+}
+
+QImage ThumbnailProvider::requestImage(const QString &id, QSize *size, const QSize &requested_size)
+{
+    TRACE_SCOPE("ThumbnailProvider::requestImage");
+
+    // Only a file: URL inside the id still carries its own encoding
+
+    QString file_name = id;
+
+    if (file_name.startsWith("file:")) {
+        file_name = QUrl(file_name).toLocalFile();
+    }
+
+    QImage image = Cache->thumbnail(file_name);
+
+    if (size != 0) {
+        *size = image.size();
+    }
+
+    if (!image.isNull()) {
+        QSize bound(requested_size.width()  > 0 ? requested_size.width()  : image.width(),
+                    requested_size.height() > 0 ? requested_size.height() : image.height());
+
+        if (bound.width() < image.width() || bound.height() < image.height()) {
+            image = image.scaled(bound, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+    }
+
+    return image;
+}
@@ -0,0 +1,26 @@
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include <QString>
+#include <QSize>
+#include <QImage>
+#include <QDeclarativeImageProvider>
+
+#include "thumbnailcache.h"
+
+// Serves "image://thumbnail/<percent-encoded file url>" from the thumbnail
+// cache, scaled down to the requested source size when that is smaller.
+
+class ThumbnailProvider : public QDeclarativeImageProvider
+{
+public:
+    explicit ThumbnailProvider(ThumbnailCache *cache);
+    virtual ~ThumbnailProvider();
+
+    virtual QImage requestImage(const QString &id, QSize *size, const QSize &requested_size);
+
+private:
+    ThumbnailCache *Cache;
+};
+
+#endif // THUMBNAILPROVIDER_H
@@ -0,0 +1,220 @@
+#include <string.h>
+
+#include "tiledimage.h"
+
+TiledImage::TiledImage()
+{
+    Width  = 0;
+    Height = 0;
+    TilesX = 0;
+    TilesY = 0;
+    Format = QImage::Format_Invalid;
+}
+
+TiledImage::TiledImage(const QImage &image)
+{
+    Width  = image.width();
+    Height = image.height();
+    TilesX = (Width  + TILE_SIZE - 1) / TILE_SIZE;
+    TilesY = (Height + TILE_SIZE - 1) / TILE_SIZE;
+    Format = image.format();
+
+    Tiles.reserve(TilesX * TilesY);
+
+    for (int tile_y = 0; tile_y < TilesY; tile_y++) {
+        for (int tile_x = 0; tile_x < TilesX; tile_x++) {
+            Tiles.append(image.copy(tile_x * TILE_SIZE, tile_y * TILE_SIZE,
+                                    qMin(TILE_SIZE, Width  - tile_x * TILE_SIZE),
+                                    qMin(TILE_SIZE, Height - tile_y * TILE_SIZE)));
+        }
+    }
+}
+
+TiledImage::TiledImage(const QSize &size, QImage::Format format, uint pixel)
+{
+    Width  = size.width();
+    Height = size.height();
+    TilesX = (Width  + TILE_SIZE - 1) / TILE_SIZE;
+    TilesY = (Height + TILE_SIZE - 1) / TILE_SIZE;
+    Format = format;
+
+    // All full-size tiles share one filled tile until they are written
+
+    QImage full_tile(TILE_SIZE, TILE_SIZE, Format);
+
+    full_tile.fill(pixel);
+
+    Tiles.reserve(TilesX * TilesY);
+
+    for (int tile_y = 0; tile_y < TilesY; tile_y++) {
+        for (int tile_x = 0; tile_x < TilesX; tile_x++) {
+            int tile_width  = qMin(TILE_SIZE, Width  - tile_x * TILE_SIZE);
+            int tile_height = qMin(TILE_SIZE, Height - tile_y * TILE_SIZE);
+
+            if (tile_width == TILE_SIZE && tile_height == TILE_SIZE) {
+                Tiles.append(full_tile);
+            } else {
+                QImage tile(tile_width, tile_height, Format);
+
+                tile.fill(pixel);
+
+                Tiles.append(tile);
+            }
+        }
+    }
+}
+
+// Adopts tiles laid out row by row, as tile() returns them
+
+TiledImage::TiledImage(const QSize &size, QImage::Format format, const QVector<QImage> &tiles)
+{
+    Width  = size.width();
+    Height = size.height();
+    TilesX = (Width  + TILE_SIZE - 1) / TILE_SIZE;
+    TilesY = (Height + TILE_SIZE - 1) / TILE_SIZE;
+    Format = format;
+    Tiles  = tiles;
+
+    Q_ASSERT(Tiles.size() == TilesX * TilesY);
+}
+
+bool TiledImage::isNull() const
+{
+    return Tiles.isEmpty();
+}
+
+int TiledImage::width() const
+{
+    return Width;
+}
+
+int TiledImage::height() const
+{
+    return Height;
+}
+
+QSize TiledImage::size() const
+{
+    return QSize(Width, Height);
+}
+
+QRect TiledImage::rect() const
+{
+    return QRect(0, 0, Width, Height);
+}
+
+QImage::Format TiledImage::format() const
+{
+    return Format;
+}
+
+int TiledImage::tileCount() const
+{
+    return Tiles.size();
+}
+
+int TiledImage::tileColumns() const
+{
+    return TilesX;
+}
+
+int TiledImage::tileRows() const
+{
+    return TilesY;
+}
+
+int TiledImage::tilesSharedWith(const TiledImage &other) const
+{
+    int shared = 0;
+
+    if (other.Tiles.size() == Tiles.size()) {
+        for (int i = 0; i < Tiles.size(); i++) {
+            if (Tiles.at(i).cacheKey() == other.Tiles.at(i).cacheKey()) {
+                shared++;
+            }
+        }
+    }
+
+    return shared;
+}
+
+QRgb TiledImage::pixel(int x, int y) const
+{
+    return Tiles.at((y / TILE_SIZE) * TilesX + x / TILE_SIZE).pixel(x % TILE_SIZE, y % TILE_SIZE);
+}
+
+void TiledImage::setPixel(int x, int y, uint index_or_rgb)
+{
+    Tiles[(y / TILE_SIZE) * TilesX + x / TILE_SIZE].setPixel(x % TILE_SIZE, y % TILE_SIZE, index_or_rgb);
+}
+
+void TiledImage::fill(uint pixel)
+{
+    for (int i = 0; i < Tiles.size(); i++) {
+        Tiles[i].fill(pixel);
+    }
+}
+
+void TiledImage::paste(const QPoint &position, const QImage &image)
+{
+    QRect area = QRect(position, image.size()).intersected(rect());
+
+    if (!area.isEmpty() && image.format() == Format) {
+        int bytes_per_pixel = Tiles.at(0).depth() / 8;
+
+        for (int y = area.top(); y <= area.bottom(); y++) {
+            const uchar *src = image.constScanLine(y - position.y());
+
+            for (int tile_x = area.left() / TILE_SIZE; tile_x <= area.right() / TILE_SIZE; tile_x++) {
+                int from_x = qMax(area.left(),  tile_x * TILE_SIZE);
+                int to_x   = qMin(area.right(), tile_x * TILE_SIZE + TILE_SIZE - 1);
+
+                memcpy(scanLine(tile_x, y) + (from_x - tile_x * TILE_SIZE) * bytes_per_pixel,
+                       src + (from_x - position.x()) * bytes_per_pixel,
+                       (to_x - from_x + 1) * bytes_per_pixel);
+            }
+        }
+    }
+}
+
+QImage TiledImage::copy(const QRect &rect) const
+{
+    QImage image(rect.size(), Format);
+
+    if (image.isNull()) {
+        return image;
+    }
+
+    image.fill(0);
+
+    QRect area = rect.intersected(this->rect());
+
+    if (!area.isEmpty()) {
+        int bytes_per_pixel = Tiles.at(0).depth() / 8;
+
+        for (int y = area.top(); y <= area.bottom(); y++) {
+            uchar *dst = image.scanLine(y - rect.top());
+
+            for (int tile_x = area.left() / TILE_SIZE; tile_x <= area.right() / TILE_SIZE; tile_x++) {
+                int from_x = qMax(area.left(),  tile_x * TILE_SIZE);
+                int to_x   = qMin(area.right(), tile_x * TILE_SIZE + TILE_SIZE - 1);
+
+                memcpy(dst + (from_x - rect.left()) * bytes_per_pixel,
+                       constScanLine(tile_x, y) + (from_x - tile_x * TILE_SIZE) * bytes_per_pixel,
+                       (to_x - from_x + 1) * bytes_per_pixel);
+            }
+        }
+    }
+
+    return image;
+}
+
+QImage TiledImage::copy(int x, int y, int w, int h) const
+{
+    return copy(QRect(x, y, w, h));
+}
+
+QImage TiledImage::toImage() const
+{
+    return copy(rect());
+}
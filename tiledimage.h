@@ -0,0 +1,68 @@
+#ifndef TILEDIMAGE_H
+#define TILEDIMAGE_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QSize>
+#include <QPoint>
+#include <QRect>
+#include <QImage>
+
+// Image stored as a grid of TILE_SIZE x TILE_SIZE implicitly shared QImage
+// tiles, so copies share pixel data until a tile is written.
+
+class TiledImage
+{
+public:
+    TiledImage();
+    explicit TiledImage(const QImage &image);
+    TiledImage(const QSize &size, QImage::Format format, uint pixel);
+    TiledImage(const QSize &size, QImage::Format format, const QVector<QImage> &tiles);
+
+    static const int TILE_SIZE = 64;
+
+    bool           isNull() const;
+    int            width() const;
+    int            height() const;
+    QSize          size() const;
+    QRect          rect() const;
+    QImage::Format format() const;
+
+    int tileCount() const;
+    int tileColumns() const;
+    int tileRows() const;
+    int tilesSharedWith(const TiledImage &other) const;
+
+    inline const uchar *constScanLine(int tile_x, int y) const
+    {
+        return Tiles.at((y / TILE_SIZE) * TilesX + tile_x).constScanLine(y % TILE_SIZE);
+    }
+
+    // Detaches the tile holding row y of tile column tile_x
+    inline uchar *scanLine(int tile_x, int y)
+    {
+        return Tiles[(y / TILE_SIZE) * TilesX + tile_x].scanLine(y % TILE_SIZE);
+    }
+
+    inline const QImage &tile(int tile_x, int tile_y) const
+    {
+        return Tiles.at(tile_y * TilesX + tile_x);
+    }
+
+    QRgb pixel(int x, int y) const;
+    void setPixel(int x, int y, uint index_or_rgb);
+
+    void fill(uint pixel);
+    void paste(const QPoint &position, const QImage &image);
+
+    QImage copy(const QRect &rect) const;
+    QImage copy(int x, int y, int w, int h) const;
+    QImage toImage() const;
+
+private:
+    int             Width, Height, TilesX, TilesY;
+    QImage::Format  Format;
+    QVector<QImage> Tiles;
+};
+
+#endif // TILEDIMAGE_H
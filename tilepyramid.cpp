@@ -0,0 +1,195 @@
+#include "tilepyramid.h"
+
+TilePyramid::TilePyramid()
+{
+}
+
+void TilePyramid::setImage(const TiledImage &image)
+{
+    if (Mask.isNull() && !image.isNull() && image.size() == BaseImage.size()) {
+        for (int tile_y = 0; tile_y < image.tileRows(); tile_y++) {
+            for (int tile_x = 0; tile_x < image.tileColumns(); tile_x++) {
+                if (image.tile(tile_x, tile_y).cacheKey() != BaseImage.tile(tile_x, tile_y).cacheKey()) {
+                    Invalidate(tile_x, tile_y);
+                }
+            }
+        }
+    } else {
+        Reset(image.size());
+    }
+
+    BaseImage     = image;
+    Mask          = EffectMask();
+    OriginalImage = QImage();
+    EffectedImage = QImage();
+}
+
+void TilePyramid::setComposite(const EffectMask &mask, const QImage &original_image, const QImage &effected_image)
+{
+    // The sources are fixed, so only tiles whose mask changed are recomposited
+
+    if (!Mask.isNull() && !mask.isNull() &&
+        mask.width() == Mask.width() && mask.height() == Mask.height() &&
+        original_image.cacheKey() == OriginalImage.cacheKey() &&
+        effected_image.cacheKey() == EffectedImage.cacheKey()) {
+        const TiledImage &weights = mask.weights();
+
+        for (int tile_y = 0; tile_y < weights.tileRows(); tile_y++) {
+            for (int tile_x = 0; tile_x < weights.tileColumns(); tile_x++) {
+                if (weights.tile(tile_x, tile_y).cacheKey() != Mask.weights().tile(tile_x, tile_y).cacheKey()) {
+                    Invalidate(tile_x, tile_y);
+                }
+            }
+        }
+    } else {
+        Reset(mask.isNull() ? QSize() : QSize(mask.width(), mask.height()));
+    }
+
+    BaseImage     = TiledImage();
+    Mask          = mask;
+    OriginalImage = original_image;
+    EffectedImage = effected_image;
+}
+
+void TilePyramid::clear()
+{
+    setImage(TiledImage());
+}
+
+bool TilePyramid::isNull() const
+{
+    return LevelSizes.isEmpty();
+}
+
+int TilePyramid::levelCount() const
+{
+    return LevelSizes.size();
+}
+
+int TilePyramid::level(qreal scale) const
+{
+    int level = 0;
+
+    while (level + 1 < LevelSizes.size() && scale * (2 << level) <= 1.0) {
+        level++;
+    }
+
+    return level;
+}
+
+void TilePyramid::draw(QPainter *painter, const QRectF &exposed_rect, qreal scale)
+{
+    if (isNull() || scale <= 0.0) {
+        return;
+    }
+
+    const int tile_size = TiledImage::TILE_SIZE;
+
+    int   level      = this->level(scale);
+    qreal tile_scale = scale * (1 << level);
+    QSize size       = LevelSizes.at(level);
+
+    int from_tile_x = qMax(0, (int)(exposed_rect.left() / tile_scale) / tile_size);
+    int to_tile_x   = qMin(TilesAcross(size.width()) - 1, (int)(exposed_rect.right() / tile_scale) / tile_size);
+    int from_tile_y = qMax(0, (int)(exposed_rect.top() / tile_scale) / tile_size);
+    int to_tile_y   = qMin(TilesAcross(size.height()) - 1, (int)(exposed_rect.bottom() / tile_scale) / tile_size);
+
+    for (int tile_y = from_tile_y; tile_y <= to_tile_y; tile_y++) {
+        for (int tile_x = from_tile_x; tile_x <= to_tile_x; tile_x++) {
+            const QImage &tile = Tile(level, tile_x, tile_y);
+
+            painter->drawImage(QRectF(tile_x * tile_size * tile_scale,
+                                      tile_y * tile_size * tile_scale,
+                                      tile.width()  * tile_scale,
+                                      tile.height() * tile_scale), tile);
+        }
+    }
+}
+
+void TilePyramid::Reset(const QSize &size)
+{
+    LevelSizes.clear();
+    LevelTiles.clear();
+
+    if (!size.isEmpty()) {
+        QSize level_size = size;
+
+        LevelSizes.append(level_size);
+        LevelTiles.append(QVector<QImage>(TilesAcross(level_size.width()) * TilesAcross(level_size.height())));
+
+        while (level_size.width() > TiledImage::TILE_SIZE || level_size.height() > TiledImage::TILE_SIZE) {
+            level_size = QSize((level_size.width() + 1) / 2, (level_size.height() + 1) / 2);
+
+            LevelSizes.append(level_size);
+            LevelTiles.append(QVector<QImage>(TilesAcross(level_size.width()) * TilesAcross(level_size.height())));
+        }
+    }
+}
+
+void TilePyramid::Invalidate(int tile_x, int tile_y)
+{
+    // A tile on level n covers 2^n level 0 tiles in each direction
+
+    for (int level = 0; level < LevelSizes.size(); level++) {
+        LevelTiles[level][(tile_y >> level) * TilesAcross(LevelSizes.at(level).width()) + (tile_x >> level)] = QImage();
+    }
+}
+
+const QImage &TilePyramid::Tile(int level, int tile_x, int tile_y)
+{
+    if (level == 0 && Mask.isNull()) {
+        return BaseImage.tile(tile_x, tile_y);
+    }
+
+    const int tile_size = TiledImage::TILE_SIZE;
+    const int half_size = tile_size / 2;
+
+    QSize   size = LevelSizes.at(level);
+    QImage &tile = LevelTiles[level][tile_y * TilesAcross(size.width()) + tile_x];
+
+    if (tile.isNull() && level == 0) {
+        tile = Mask.composite(OriginalImage, EffectedImage, QRect(tile_x * tile_size, tile_y * tile_size,
+                                                                  qMin(tile_size, size.width()  - tile_x * tile_size),
+                                                                  qMin(tile_size, size.height() - tile_y * tile_size)));
+    } else if (tile.isNull()) {
+        QSize below = LevelSizes.at(level - 1);
+
+        tile = QImage(qMin(tile_size, size.width()  - tile_x * tile_size),
+                      qMin(tile_size, size.height() - tile_y * tile_size), QImage::Format_RGB16);
+
+        // 2x2 box average of the tiles below, three channels in one word
+
+        for (int quadrant_y = 0; quadrant_y < 2; quadrant_y++) {
+            for (int quadrant_x = 0; quadrant_x < 2; quadrant_x++) {
+                int child_x = tile_x * 2 + quadrant_x;
+                int child_y = tile_y * 2 + quadrant_y;
+
+                if (child_x * tile_size < below.width() && child_y * tile_size < below.height()) {
+                    const QImage &child = Tile(level - 1, child_x, child_y);
+
+                    for (int y = 0; y < (child.height() + 1) / 2; y++) {
+                        const quint16 *top    = (const quint16 *)child.constScanLine(y * 2);
+                        const quint16 *bottom = (const quint16 *)child.constScanLine(qMin(y * 2 + 1, child.height() - 1));
+                        quint16       *dst    = (quint16 *)tile.scanLine(quadrant_y * half_size + y) + quadrant_x * half_size;
+
+                        for (int x = 0; x < (child.width() + 1) / 2; x++) {
+                            int left  = x * 2;
+                            int right = qMin(x * 2 + 1, child.width() - 1);
+
+                            quint32 sum = ((top[left]     | (top[left]     << 16)) & 0x07E0F81F) +
+                                          ((top[right]    | (top[right]    << 16)) & 0x07E0F81F) +
+                                          ((bottom[left]  | (bottom[left]  << 16)) & 0x07E0F81F) +
+                                          ((bottom[right] | (bottom[right] << 16)) & 0x07E0F81F) + 0x00401002;
+
+                            sum = (sum >> 2) & 0x07E0F81F;
+
+                            dst[x] = sum | (sum >> 16);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return tile;
+}
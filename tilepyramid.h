@@ -0,0 +1,52 @@
+#ifndef TILEPYRAMID_H
+#define TILEPYRAMID_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QSize>
+#include <QRect>
+#include <QRectF>
+#include <QImage>
+#include <QPainter>
+
+#include "tiledimage.h"
+#include "effectmask.h"
+
+// Mipmap pyramid of an editor's displayed RGB16 image in TILE_SIZE tiles.
+// Level 0 is the editor's tiled image or a mask composite built per tile on
+// first paint; a new image drops only the tiles it no longer shares. Painting
+// uses the coarsest level with at least one pixel per item pixel.
+
+class TilePyramid
+{
+public:
+    TilePyramid();
+
+    void setImage(const TiledImage &image);
+    void setComposite(const EffectMask &mask, const QImage &original_image, const QImage &effected_image);
+    void clear();
+
+    bool isNull() const;
+    int  levelCount() const;
+    int  level(qreal scale) const;
+
+    void draw(QPainter *painter, const QRectF &exposed_rect, qreal scale);
+
+private:
+    void          Reset(const QSize &size);
+    void          Invalidate(int tile_x, int tile_y);
+    const QImage &Tile(int level, int tile_x, int tile_y);
+
+    static inline int TilesAcross(int length)
+    {
+        return (length + TiledImage::TILE_SIZE - 1) / TiledImage::TILE_SIZE;
+    }
+
+    TiledImage                BaseImage;
+    EffectMask                Mask;
+    QImage                    OriginalImage, EffectedImage;
+    QVector<QSize>            LevelSizes;
+    QVector<QVector<QImage> > LevelTiles;
+};
+
+#endif // TILEPYRAMID_H
@@ -0,0 +1,140 @@
+#include <QCoreApplication>
+#include <QThread>
+#include <QFile>
+#include <QTextStream>
+
+#include "tracer.h"
+
+bool          Tracer::Enabled      = false;
+int           Tracer::EventCount   = 0;
+int           Tracer::WrittenCount = 0;
+Tracer::Event Tracer::Events[Tracer::CHUNK_EVENTS];
+QFile         Tracer::TraceFile;
+QMutex        Tracer::EventsMutex;
+QElapsedTimer Tracer::Clock;
+
+void Tracer::Initialize()
+{
+    QByteArray file_name = qgetenv("MAGICPHOTOS_TRACE");
+
+    if (!file_name.isEmpty() && !Enabled) {
+        TraceFile.setFileName(QString::fromLocal8Bit(file_name.constData()));
+
+        if (TraceFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            TraceFile.write("[");
+            TraceFile.flush();
+
+            Clock.start();
+
+            Enabled = true;
+
+            qAddPostRoutine(Flush);
+        } else {
+            qWarning("Tracer: could not write %s", qPrintable(TraceFile.fileName()));
+        }
+    }
+}
+
+void Tracer::Flush()
+{
+    if (Enabled) {
+        QMutexLocker locker(&EventsMutex);
+
+        WriteEvents();
+
+        TraceFile.write("\n]\n");
+        TraceFile.close();
+
+        Enabled = false;
+    }
+}
+
+qint64 Tracer::Timestamp()
+{
+#if QT_VERSION >= 0x040800
+    return Clock.nsecsElapsed() / 1000;
+#else
+    return Clock.elapsed() * 1000;
+#endif
+}
+
+void Tracer::CompleteEvent(const char *name, qint64 start, qint64 duration)
+{
+    if (Enabled) {
+        AddEvent(name, 'X', start, duration, 0);
+    }
+}
+
+void Tracer::AsyncBegin(const char *name, const void *id)
+{
+    if (Enabled) {
+        AddEvent(name, 'b', Timestamp(), 0, (quintptr)id);
+    }
+}
+
+void Tracer::AsyncEnd(const char *name, const void *id)
+{
+    if (Enabled) {
+        AddEvent(name, 'e', Timestamp(), 0, (quintptr)id);
+    }
+}
+
+void Tracer::Counter(const char *name, qint64 value)
+{
+    if (Enabled) {
+        AddEvent(name, 'C', Timestamp(), value, 0);
+    }
+}
+
+void Tracer::AddEvent(const char *name, char phase, qint64 start, qint64 duration, quintptr id)
+{
+    Event event;
+
+    event.Name     = name;
+    event.Phase    = phase;
+    event.Start    = start;
+    event.Duration = duration;
+    event.Id       = id;
+    event.ThreadId = (quintptr)QThread::currentThreadId();
+
+    QMutexLocker locker(&EventsMutex);
+
+    if (TraceFile.isOpen()) {
+        Events[EventCount++] = event;
+
+        if (EventCount == CHUNK_EVENTS) {
+            WriteEvents();
+        }
+    }
+}
+
+void Tracer::WriteEvents()
+{
+    // Called with the events locked
+
+    QTextStream stream(&TraceFile);
+
+    for (int i = 0; i < EventCount; i++) {
+        const Event &event = Events[i];
+
+        stream << (WrittenCount++ == 0 ? "\n" : ",\n")
+               << "{\"name\":\"" << event.Name << "\",\"cat\":\"magicphotos\",\"ph\":\"" << event.Phase
+               << "\",\"ts\":" << event.Start << ",\"pid\":1,\"tid\":" << (qulonglong)event.ThreadId;
+
+        if (event.Phase == 'X') {
+            stream << ",\"dur\":" << event.Duration;
+        } else if (event.Phase == 'b' || event.Phase == 'e') {
+            stream << ",\"id\":\"0x" << QString::number((qulonglong)event.Id, 16) << "\"";
+        } else if (event.Phase == 'C') {
+            stream << ",\"args\":{\"value\":" << event.Duration << "}";
+        }
+
+        stream << "}";
+    }
+
+    stream.flush();
+
+    TraceFile.flush();
+
+    EventCount = 0;
+}
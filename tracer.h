@@ -0,0 +1,78 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QtGlobal>
+#include <QFile>
+#include <QMutex>
+#include <QElapsedTimer>
+
+// Lightweight Chrome trace_event recorder, enabled by setting MAGICPHOTOS_TRACE
+// to the output JSON file name; otherwise every call is a single flag check.
+// Events are appended as a buffer fills, so a killed process keeps its trace.
+
+class Tracer
+{
+public:
+    static void Initialize();
+    static void Flush();
+
+    static inline bool IsEnabled()
+    {
+        return Enabled;
+    }
+
+    static qint64 Timestamp();
+
+    static void CompleteEvent(const char *name, qint64 start, qint64 duration);
+    static void AsyncBegin(const char *name, const void *id);
+    static void AsyncEnd(const char *name, const void *id);
+    static void Counter(const char *name, qint64 value);
+
+private:
+    struct Event {
+        const char *Name;
+        char        Phase;
+        qint64      Start, Duration;
+        quintptr    Id, ThreadId;
+    };
+
+    static void AddEvent(const char *name, char phase, qint64 start, qint64 duration, quintptr id);
+    static void WriteEvents();
+
+    static const int CHUNK_EVENTS = 4096;
+
+    static bool          Enabled;
+    static int           EventCount, WrittenCount;
+    static Event         Events[CHUNK_EVENTS];
+    static QFile         TraceFile;
+    static QMutex        EventsMutex;
+    static QElapsedTimer Clock;
+};
+
+class TraceScope
+{
+public:
+    explicit inline TraceScope(const char *name)
+    {
+        Name  = name;
+        Start = Tracer::IsEnabled() ? Tracer::Timestamp() : 0;
+    }
+
+    inline ~TraceScope()
+    {
+        if (Tracer::IsEnabled()) {
+            Tracer::CompleteEvent(Name, Start, Tracer::Timestamp() - Start);
+        }
+    }
+
+private:
+    const char *Name;
+    qint64      Start;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b)      TRACE_CONCAT_IMPL(a, b)
+
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif // TRACER_H